@@ -1,4 +1,9 @@
 local _G = _G
+-- rawset is removed from the global table by the sandbox
+local rawset = rawset
+local setmetatable = setmetatable
+local next = next
+local type = type
 
 Ext._LoadedFiles = {}
 Mods = {}
@@ -8,6 +13,43 @@ Ext._WarnDeprecated = function (msg)
 	Ext.PrintError("See https://github.com/Norbyte/ositools/blob/master/LuaAPIDocs.md#migrating-from-v41-to-v42 for more info.")
 end
 
+-- Engine events are only passed to Lua if the extender knows that they have listeners.
+-- The listener tables notify it whenever a listener is added, so listeners that are added to
+-- Ext._Listeners directly (instead of using Ext.RegisterListener) are called as well.
+local function TrackEventListeners(event, listeners)
+	if next(listeners) ~= nil then
+		Ext._OnListenerAdded(event)
+	end
+
+	return setmetatable(listeners, {
+		__newindex = function (t, k, v)
+			rawset(t, k, v)
+			Ext._OnListenerAdded(event)
+		end
+	})
+end
+
+Ext._TrackListeners = function (listeners)
+	local events = {}
+	for event, eventListeners in pairs(listeners) do
+		events[event] = TrackEventListeners(event, eventListeners)
+	end
+
+	-- Proxy, so replacing the listener table of an event is tracked too
+	return setmetatable({}, {
+		__index = events,
+		__newindex = function (t, k, v)
+			if type(v) == "table" then
+				v = TrackEventListeners(k, v)
+			end
+			events[k] = v
+		end,
+		__pairs = function (t)
+			return next, events, nil
+		end
+	})
+end
+
 Ext._Notify = function (event)
     for i,callback in pairs(Ext._Listeners[event]) do
         local status, err = xpcall(callback, debug.traceback)
@@ -55,6 +97,10 @@ Ext._NetListeners = {}
 Ext.RegisterNetListener = function (channel, fn)
 	if Ext._NetListeners[channel] == nil then
 		Ext._NetListeners[channel] = {}
+		-- Let the server know that we're interested in broadcasts on this channel
+		if Ext._SubscribeNetChannel ~= nil then
+			Ext._SubscribeNetChannel(channel)
+		end
 	end
 
 	table.insert(Ext._NetListeners[channel], fn)
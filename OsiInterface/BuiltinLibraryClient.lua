@@ -1,4 +1,4 @@
-Ext._Listeners = {
+Ext._Listeners = Ext._TrackListeners({
 	SessionLoading = {},
 	SessionLoaded = {},
 	ModuleLoading = {},
@@ -7,7 +7,7 @@ Ext._Listeners = {
 	StatusGetDescriptionParam = {},
 	GetSkillDamage = {},
 	GetHitChance = {}
-}
+})
 
 Ext._SkillGetDescriptionParam = function (...)
     return Ext._EngineCallback1("SkillGetDescriptionParam", ...)
@@ -1,4 +1,4 @@
-Ext._Listeners = {
+Ext._Listeners = Ext._TrackListeners({
 	SessionLoading = {},
 	SessionLoaded = {},
 	ModuleLoading = {},
@@ -8,7 +8,7 @@ Ext._Listeners = {
 	CalculateTurnOrder = {},
 	GetHitChance = {},
 	StatusGetEnterChance = {}
-}
+})
 
 Ext._GetSkillDamage = function (...)
     for i,callback in pairs(Ext._Listeners.GetSkillDamage) do
@@ -521,11 +521,57 @@ void OsiFunctionToSymbolInfo(Function & func, OsiSymbolInfo & symbol)
 	}
 }
 
+static STDString OsiFunctionIndexName(char const * name)
+{
+	// Osiris function names are case insensitive
+	STDString lowercase(name);
+	for (auto & c : lowercase) {
+		c = (char)tolower((unsigned char)c);
+	}
+
+	return lowercase;
+}
+
+void CustomFunctionInjector::AddToFunctionIndex(Function const * func)
+{
+	// Skip DBs and PROCs that were declared but never defined
+	if (func->Node.Id == 0
+		&& func->Type != FunctionType::Call
+		&& func->Type != FunctionType::Query) {
+		return;
+	}
+
+	auto numParams = (uint32_t)func->Signature->Params->Params.Size;
+	auto numOutParams = (uint32_t)func->Signature->OutParamList.numOutParams();
+	FunctionNameAndArity sig{ OsiFunctionIndexName(func->Signature->Name), numParams - numOutParams };
+
+	// If there are multiple overloads with the same number of IN params,
+	// prefer the one with the least OUT params
+	auto it = osiFunctionIndex_.find(sig);
+	if (it == osiFunctionIndex_.end()) {
+		osiFunctionIndex_.insert(std::make_pair(std::move(sig), func));
+	} else if (it->second->Signature->Params->Params.Size > numParams) {
+		it->second = func;
+	}
+}
+
+Function const * CustomFunctionInjector::LookupOsiFunction(STDString const & name, uint32_t numInParams) const
+{
+	auto it = osiFunctionIndex_.find(FunctionNameAndArity{ OsiFunctionIndexName(name.c_str()), numInParams });
+	if (it != osiFunctionIndex_.end()) {
+		return it->second;
+	} else {
+		return nullptr;
+	}
+}
+
 void CustomFunctionInjector::CreateOsirisSymbolMap(MappingInfo ** Mappings, uint32_t * MappingCount)
 {
 	// Create a map of Osiris symbols
 	osiSymbols_.clear();
 	osiSymbols_.reserve(10000);
+	osiFunctionIndex_.clear();
+	osiFunctionIndex_.reserve(10000);
 
 	std::unordered_map<FunctionNameAndArity, uint32_t> symbolMap;
 	auto funcs = *gOsirisProxy->GetGlobals().Functions;
@@ -537,6 +583,7 @@ void CustomFunctionInjector::CreateOsirisSymbolMap(MappingInfo ** Mappings, uint
 		symbolMap.insert(std::make_pair(sig, (uint32_t)osiSymbols_.size()));
 
 		osiSymbols_.push_back(std::move(symbol));
+		AddToFunctionIndex(func);
 	};
 
 	for (auto i = 0; i < 0x3ff; i++) {
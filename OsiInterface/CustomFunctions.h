@@ -306,6 +306,9 @@ namespace dse
 			return osiSymbols_;
 		}
 
+		// Looks up a story function by name (case insensitive) and number of IN parameters
+		Function const * LookupOsiFunction(STDString const & name, uint32_t numInParams) const;
+
 	private:
 		OsirisWrappers & wrappers_;
 		CustomFunctionManager & functions_;
@@ -315,8 +318,11 @@ namespace dse
 		std::unordered_map<uint32_t, FunctionHandle> osiToDivMappings_;
 		std::unordered_map<FunctionHandle, uint32_t> divToOsiMappings_;
 		std::vector<OsiSymbolInfo> osiSymbols_;
+		// Story functions indexed by lowercase name and number of IN parameters
+		std::unordered_map<FunctionNameAndArity, Function const *> osiFunctionIndex_;
 
 		void CreateOsirisSymbolMap(MappingInfo ** Mappings, uint32_t * MappingCount);
+		void AddToFunctionIndex(Function const * func);
 		void OnAfterGetFunctionMappings(void * Osiris, MappingInfo ** Mappings, uint32_t * MappingCount);
 		bool CallWrapper(std::function<bool(uint32_t, OsiArgumentDesc *)> const & next, uint32_t handle, OsiArgumentDesc * params);
 		bool QueryWrapper(std::function<bool(uint32_t, OsiArgumentDesc *)> const & next, uint32_t handle, OsiArgumentDesc * params);
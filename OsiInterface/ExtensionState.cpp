@@ -278,6 +278,24 @@ namespace dse
 		}
 	}
 
+	void ExtensionState::OnIdle()
+	{
+		LuaVirtualPin lua(*this);
+		if (lua) {
+			lua->RunIdleGC();
+		}
+	}
+
+	void ExtensionState::OnUpdate()
+	{
+		LuaVirtualPin lua(*this);
+		if (lua) {
+			lua->RunScheduledTasks();
+			lua->ProcessCompletedJobs();
+			lua->RunIdleGC(true);
+		}
+	}
+
 
 	void ExtensionState::IncLuaRefs()
 	{
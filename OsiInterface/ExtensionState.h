@@ -41,6 +41,10 @@ namespace dse
 		void OnGameSessionLoaded();
 		void OnModuleLoading();
 		void OnModuleResume();
+		// Called at points where the game isn't waiting on the Lua state
+		void OnIdle();
+		// Called once per game tick
+		void OnUpdate();
 
 		void IncLuaRefs();
 		void DecLuaRefs();
@@ -6,6 +6,38 @@ namespace dse
 {
 	namespace func
 	{
+		// Osiris scripts query the same few attributes over and over, so attributes are only
+		// resolved by name once per stats type
+		std::optional<StatAttributeHandle> ResolveCachedAttribute(CRPGStatsManager * stats, CRPGStats_Object * object, char const * attributeName)
+		{
+			static std::vector<std::unordered_map<STDString, StatAttributeHandle>> resolvedAttributes;
+
+			auto modifierListIndex = (int32_t)object->ModifierListIndex;
+			if ((int32_t)resolvedAttributes.size() <= modifierListIndex) {
+				resolvedAttributes.resize(modifierListIndex + 1);
+			}
+
+			auto & attributes = resolvedAttributes[modifierListIndex];
+			auto it = attributes.find(attributeName);
+			if (it != attributes.end()) {
+				// Make sure that the handle is still valid if the stats were reloaded
+				auto modifiers = stats->modifierList.Find(modifierListIndex);
+				auto modifier = modifiers ? modifiers->Attributes.Find(it->second.AttributeIndex) : nullptr;
+				if (modifier != nullptr && strcmp(modifier->Name.Str, attributeName) == 0) {
+					return it->second;
+				}
+
+				attributes.erase(it);
+			}
+
+			auto attribute = stats->ResolveAttribute(modifierListIndex, attributeName);
+			if (attribute) {
+				attributes.insert(std::make_pair(STDString(attributeName), *attribute));
+			}
+
+			return attribute;
+		}
+
 		bool StatExists(OsiArgumentDesc & args)
 		{
 			auto statName = args[0].String;
@@ -34,9 +66,8 @@ namespace dse
 				return false;
 			}
 
-			int attributeIndex;
-			auto attrInfo = stats->GetAttributeInfo(object, attributeName, attributeIndex);
-			return attrInfo != nullptr;
+			auto attribute = ResolveCachedAttribute(stats, object, attributeName);
+			return (bool)attribute;
 		}
 
 		bool StatGetInt(OsiArgumentDesc & args)
@@ -55,7 +86,12 @@ namespace dse
 				return false;
 			}
 
-			auto value = stats->GetAttributeInt(object, attributeName);
+			auto attribute = ResolveCachedAttribute(stats, object, attributeName);
+			std::optional<int> value;
+			if (attribute) {
+				value = stats->GetAttributeInt(object, *attribute);
+			}
+
 			if (!value) {
 				OsiError("Attribute '" << attributeName << "' not found on object '" << statName << "'");
 				return false;
@@ -93,7 +129,12 @@ namespace dse
 				return false;
 			}
 
-			auto value = stats->GetAttributeString(object, attributeName);
+			auto attribute = ResolveCachedAttribute(stats, object, attributeName);
+			std::optional<char const *> value;
+			if (attribute) {
+				value = stats->GetAttributeString(object, *attribute);
+			}
+
 			if (!value) {
 				OsiError("Attribute '" << attributeName << "' not found on object '" << statName << "'");
 				return false;
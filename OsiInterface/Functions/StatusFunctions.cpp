@@ -540,7 +540,7 @@ namespace dse
 		esv::Status * status, bool useCharacterStats)
 	{
 		LuaServerPin lua(ExtensionStateServer::Get());
-		if (lua) {
+		if (lua && lua->HasListeners(lua::EngineEvent::StatusGetEnterChance)) {
 			auto enterChance = lua->StatusGetEnterChance(status, useCharacterStats);
 			if (enterChance) {
 				return *enterChance;
@@ -554,7 +554,7 @@ namespace dse
 		CDivinityStats_Character * attacker, CDivinityStats_Character * target)
 	{
 		LuaVirtualPin lua(gOsirisProxy->GetCurrentExtensionState());
-		if (lua) {
+		if (lua && lua->HasListeners(lua::EngineEvent::GetHitChance)) {
 			auto hitChance = lua->GetHitChance(attacker, target);
 			if (hitChance) {
 				return *hitChance;
@@ -690,7 +690,7 @@ namespace dse
 		HighGroundBonus highGroundFlag, CriticalRoll criticalRoll)
 	{
 		LuaServerPin lua(ExtensionStateServer::Get());
-		if (lua) {
+		if (lua && lua->HasListeners(lua::EngineEvent::ComputeCharacterHit)) {
 			if (lua->ComputeCharacterHit(self, attackerStats, item, damageList, hitType, noHitRoll, forceReduceDurability, damageInfo,
 				skillProperties, highGroundFlag, criticalRoll)) {
 				return;
@@ -797,7 +797,7 @@ namespace dse
 		// We won't post these to Lua since the Lua scripts already processed the original (unwrapped) query
 		if (paramTexts != nullptr) {
 			LuaClientPin lua(ExtensionStateClient::Get());
-			if (lua) {
+			if (lua && lua->HasListeners(lua::EngineEvent::SkillGetDescriptionParam)) {
 				auto replacement = lua->SkillGetDescriptionParam(skillPrototype, tgtCharStats, *paramTexts);
 				if (replacement) {
 					eocText->ReplaceParam(paramIndex, *replacement);
@@ -814,7 +814,7 @@ namespace dse
 		float * targetPosition, DeathType * pDeathType, int level, bool noRandomization)
 	{
 		LuaVirtualPin lua(gOsirisProxy->GetCurrentExtensionState());
-		if (lua) {
+		if (lua && lua->HasListeners(lua::EngineEvent::GetSkillDamage)) {
 			if (lua->GetSkillDamage(self, damageList, attackerStats, isFromItem, stealthed, attackerPosition, targetPosition, pDeathType, level, noRandomization)) {
 				return;
 			}
@@ -828,7 +828,7 @@ namespace dse
 		eoc::Text * text, int paramIndex, FixedString * param, ObjectSet<STDString> * paramSet)
 	{
 		LuaClientPin lua(ExtensionStateClient::Get());
-		if (lua) {
+		if (lua && lua->HasListeners(lua::EngineEvent::StatusGetDescriptionParam)) {
 			auto replacement = lua->StatusGetDescriptionParam(prototype, statusSource, targetCharacter, *paramSet);
 			if (replacement) {
 				text->ReplaceParam(paramIndex, *replacement);
@@ -842,7 +842,7 @@ namespace dse
 	void CustomFunctionLibrary::OnUpdateTurnOrder(esv::TurnManager * self, uint8_t combatId)
 	{
 		LuaServerPin lua(ExtensionStateServer::Get());
-		if (lua) {
+		if (lua && lua->HasListeners(lua::EngineEvent::CalculateTurnOrder)) {
 			lua->OnUpdateTurnOrder(self, combatId);
 		}
 	}
@@ -2,13 +2,17 @@ local math = math
 local table = table
 local error = error
 local pairs = pairs
+local next = next
+local setmetatable = setmetatable
 local Ext = Ext
 
 Game = {
     Math = {}
 }
 
-_ENV = Game.Math
+local Game = Game
+local Math = Game.Math
+_ENV = Math
 
 DamageTypeToDeathTypeMap = {
     Physical = "Physical",
@@ -276,7 +280,7 @@ function GetWeaponScalingRequirement(weapon)
     local largestRequirement = -1
 
     for i, requirement in pairs(weapon.Requirements) do
-        local reqName = requirement.Name
+        local reqName = requirement.Requirement
         if not requirement.Not and requirement.Param > largestRequirement and
             (reqName == "Strength" or reqName == "Finesse" or reqName == "Constitution" or
             reqName == "Memory" or reqName == "Wits") then
@@ -742,7 +746,7 @@ function ApplyLifeSteal(hit, target, attacker, hitType)
     end
 
     if lifesteal > 0 then
-        hit.LifeSteal = math.max(math.ceil(lifesteal * attacker.Lifesteal / 100), 0)
+        hit.LifeSteal = math.max(math.ceil(lifesteal * attacker.LifeSteal / 100), 0)
     end
 end
 
@@ -825,7 +829,7 @@ function DoHit(hit, damageList, statusBonusDmgTypes, hitType, target, attacker)
     hit.DamageList = Ext.NewDamageList()
 
     for i,damageType in pairs(statusBonusDmgTypes) do
-        damageList.Add(damageType, math.ceil(totalDamage * 0.1))
+        damageList:Add(damageType, math.ceil(totalDamage * 0.1))
     end
 
     ApplyDamagesToHitInfo(damageList, hit)
@@ -903,7 +907,8 @@ function CalculateHitChance(attacker, target)
         return 100
     end
 
-    local ranged = IsRangedWeapon(attacker.MainWeapon.WeaponType)
+    local mainWeapon = attacker.MainWeapon
+    local ranged = mainWeapon ~= nil and IsRangedWeapon(mainWeapon)
     local accuracy = attacker.Accuracy
     local dodge = 0
     if (not attacker.Invisible or ranged) and target.IsIncapacitatedRefCount == 0 then
@@ -924,7 +929,7 @@ function IsInFlankingPosition(target, attacker)
     local distanceSq = 1.0 / math.sqrt(dx^2 + dy^2 + dz^2)
     local nx, ny, nz = dx * distanceSq, dy * distanceSq, dz * distanceSq
 
-    local ang = -rotation[6] * normDX - rotation[7] * normDY - rotation[8] * normDZ
+    local ang = -rot[7] * nx - rot[8] * ny - rot[9] * nz
     return ang > math.cos(0.52359879)
 end
 
@@ -1112,3 +1117,56 @@ function GetSkillDamageRange(character, skill)
         return damageRanges
     end
 end
+
+
+-- The hit chance, skill damage and character hit calculations above also have a native
+-- implementation (Ext._NativeMath) that is used as long as no mod replaces anything in Game.Math.
+-- Once a function or lookup table is replaced, the Lua implementation is used instead so the
+-- override takes effect.
+local NativeMath = Ext._NativeMath
+local Overridden = false
+
+local function TrackOverrides(tbl)
+    return setmetatable({}, {
+        __index = tbl,
+        __newindex = function (t, k, v)
+            Overridden = true
+            tbl[k] = v
+        end,
+        __pairs = function (t)
+            return next, tbl, nil
+        end
+    })
+end
+
+local LuaCalculateHitChance = CalculateHitChance
+local LuaGetSkillDamage = GetSkillDamage
+local LuaComputeCharacterHit = ComputeCharacterHit
+
+function CalculateHitChance(attacker, target)
+    if Overridden then
+        return LuaCalculateHitChance(attacker, target)
+    end
+
+    return NativeMath.CalculateHitChance(LuaCalculateHitChance, attacker, target)
+end
+
+function GetSkillDamage(skill, attacker, isFromItem, stealthed, attackerPos, targetPos, level, noRandomization)
+    if Overridden then
+        return LuaGetSkillDamage(skill, attacker, isFromItem, stealthed, attackerPos, targetPos, level, noRandomization)
+    end
+
+    return NativeMath.GetSkillDamage(LuaGetSkillDamage, skill, attacker, isFromItem, stealthed, attackerPos, targetPos, level, noRandomization)
+end
+
+function ComputeCharacterHit(target, attacker, weapon, damageList, hitType, noHitRoll, forceReduceDurability, hit, alwaysBackstab, highGroundFlag, criticalRoll)
+    if Overridden then
+        return LuaComputeCharacterHit(target, attacker, weapon, damageList, hitType, noHitRoll, forceReduceDurability, hit, alwaysBackstab, highGroundFlag, criticalRoll)
+    end
+
+    return NativeMath.ComputeCharacterHit(LuaComputeCharacterHit, target, attacker, weapon, damageList, hitType, noHitRoll, forceReduceDurability, hit, alwaysBackstab, highGroundFlag, criticalRoll)
+end
+
+DamageTypeToDeathTypeMap = TrackOverrides(DamageTypeToDeathTypeMap)
+DamageBoostTable = TrackOverrides(DamageBoostTable)
+Game.Math = TrackOverrides(Math)
@@ -1,6 +1,11 @@
 #pragma once
 
 #include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace dse
 {
@@ -15,10 +20,10 @@ namespace dse
 
 		static std::optional<T> Find(char const * name)
 		{
-			for (auto i = 0; i < std::size(L::Values); i++) {
-				if (strcmp(name, L::Values[i].Name) == 0) {
-					return L::Values[i].Val;
-				}
+			auto const & index = GetIndex();
+			auto it = index.ByName.find(std::string_view(name));
+			if (it != index.ByName.end()) {
+				return it->second;
 			}
 
 			return {};
@@ -26,14 +31,92 @@ namespace dse
 
 		static std::optional<char const *> Find(T val)
 		{
-			for (auto i = 0; i < std::size(L::Values); i++) {
-				if (val == L::Values[i].Val) {
-					return L::Values[i].Name;
+			auto const & index = GetIndex();
+			auto key = ToKey(val);
+
+			if (!index.DenseNames.empty()) {
+				auto slot = key - index.MinKey;
+				if (slot < index.DenseNames.size() && index.DenseNames[slot] != nullptr) {
+					return index.DenseNames[slot];
 				}
+
+				return {};
+			}
+
+			auto it = std::lower_bound(index.SortedValues.begin(), index.SortedValues.end(), key,
+				[](auto const & entry, uint64_t key) { return entry.first < key; });
+			if (it != index.SortedValues.end() && it->first == key) {
+				return it->second;
 			}
 
 			return {};
 		}
+
+	private:
+		// Lookup tables built once from L::Values on first use.
+		// Names are hashed; values use a direct-indexed table when the value range
+		// is compact (plain enums) and a sorted table otherwise (bitmask enums).
+		struct Index
+		{
+			std::unordered_map<std::string_view, T> ByName;
+			std::vector<char const *> DenseNames;
+			std::vector<std::pair<uint64_t, char const *>> SortedValues;
+			uint64_t MinKey{ 0 };
+		};
+
+		static constexpr std::size_t MaxDenseSlotsPerValue = 4;
+
+		static inline uint64_t ToKey(T val)
+		{
+			return (uint64_t)static_cast<std::underlying_type_t<T>>(val);
+		}
+
+		static Index BuildIndex()
+		{
+			Index index;
+			auto numValues = std::size(L::Values);
+			index.ByName.reserve(numValues);
+
+			uint64_t minKey = std::numeric_limits<uint64_t>::max(), maxKey = 0;
+			for (auto const & label : L::Values) {
+				if (label.Name == nullptr) continue;
+				// Keep the first label when several map to the same name or value,
+				// consistent with the old linear scan
+				index.ByName.insert(std::make_pair(std::string_view(label.Name), label.Val));
+				auto key = ToKey(label.Val);
+				minKey = std::min(minKey, key);
+				maxKey = std::max(maxKey, key);
+			}
+
+			if (numValues > 0 && maxKey - minKey < numValues * MaxDenseSlotsPerValue) {
+				index.MinKey = minKey;
+				index.DenseNames.resize((std::size_t)(maxKey - minKey + 1), nullptr);
+				for (auto const & label : L::Values) {
+					if (label.Name == nullptr) continue;
+					auto & slot = index.DenseNames[(std::size_t)(ToKey(label.Val) - minKey)];
+					if (slot == nullptr) {
+						slot = label.Name;
+					}
+				}
+			} else {
+				index.SortedValues.reserve(numValues);
+				for (auto const & label : L::Values) {
+					if (label.Name == nullptr) continue;
+					index.SortedValues.push_back(std::make_pair(ToKey(label.Val), label.Name));
+				}
+
+				std::stable_sort(index.SortedValues.begin(), index.SortedValues.end(),
+					[](auto const & a, auto const & b) { return a.first < b.first; });
+			}
+
+			return index;
+		}
+
+		static Index const & GetIndex()
+		{
+			static Index const index = BuildIndex();
+			return index;
+		}
 	};
 
 	template<typename T> struct EnumInfoFakeDep : public std::false_type {};
@@ -6,6 +6,8 @@
 #include "OsirisProxy.h"
 #include <PropertyMaps.h>
 
+#include <mutex>
+
 namespace dse
 {
 	StaticSymbols & GetStaticSymbols()
@@ -228,18 +230,78 @@ namespace dse
 		return typeInfo;
 	}
 
-	std::optional<char const *> CRPGStatsManager::GetAttributeString(CRPGStats_Object * object, const char * attributeName)
+	std::optional<StatAttributeHandle> CRPGStatsManager::ResolveAttribute(int32_t modifierListIndex, const char * attributeName)
 	{
+		auto objModifiers = modifierList.Find(modifierListIndex);
+		if (objModifiers == nullptr) {
+			return {};
+		}
+
 		int attributeIndex;
-		auto typeInfo = GetAttributeInfo(object, attributeName, attributeIndex);
+		auto modifierInfo = objModifiers->GetAttributeInfo(attributeName, &attributeIndex);
+		if (modifierInfo == nullptr) {
+			return {};
+		}
+
+		auto typeInfo = modifierValueList.Find(modifierInfo->RPGEnumerationIndex);
 		if (typeInfo == nullptr) {
 			return {};
 		}
 
-		auto index = object->IndexedProperties[attributeIndex];
+		StatAttributeHandle attribute;
+		attribute.ModifierListIndex = modifierListIndex;
+		attribute.AttributeIndex = attributeIndex;
+		attribute.EnumerationIndex = modifierInfo->RPGEnumerationIndex;
+		attribute.LevelMapIndex = modifierInfo->LevelMapIndex;
+		attribute.Name = modifierInfo->Name;
+
 		if (strcmp(typeInfo->Name.Str, "FixedString") == 0) {
-			return ModifierFSSet[index].Str;
+			attribute.Type = StatAttributeHandle::ValueType::FixedString;
 		} else if (strcmp(typeInfo->Name.Str, "AttributeFlags") == 0) {
+			attribute.Type = StatAttributeHandle::ValueType::AttributeFlags;
+		} else if (strcmp(typeInfo->Name.Str, "ConstantInt") == 0) {
+			attribute.Type = StatAttributeHandle::ValueType::ConstantInt;
+		} else if (typeInfo->Values.ItemCount > 0) {
+			attribute.Type = StatAttributeHandle::ValueType::Enumeration;
+		} else {
+			attribute.Type = StatAttributeHandle::ValueType::Unsupported;
+		}
+
+		return attribute;
+	}
+
+	std::optional<StatAttributeHandle> CRPGStatsManager::ResolveAttribute(const char * modifierListName, const char * attributeName)
+	{
+		auto modifierListIndex = modifierList.FindIndex(modifierListName);
+		if (modifierListIndex == -1) {
+			return {};
+		}
+
+		return ResolveAttribute(modifierListIndex, attributeName);
+	}
+
+	std::optional<char const *> CRPGStatsManager::GetAttributeString(CRPGStats_Object * object, const char * attributeName)
+	{
+		auto attribute = ResolveAttribute(object->ModifierListIndex, attributeName);
+		if (!attribute) {
+			return {};
+		}
+
+		return GetAttributeString(object, *attribute);
+	}
+
+	std::optional<char const *> CRPGStatsManager::GetAttributeString(CRPGStats_Object * object, StatAttributeHandle const & attribute)
+	{
+		if ((int32_t)object->ModifierListIndex != attribute.ModifierListIndex) {
+			return {};
+		}
+
+		auto index = object->IndexedProperties[attribute.AttributeIndex];
+		switch (attribute.Type) {
+		case StatAttributeHandle::ValueType::FixedString:
+			return ModifierFSSet[index].Str;
+
+		case StatAttributeHandle::ValueType::AttributeFlags:
 			if (index != -1) {
 				auto attrFlags = AttributeFlags[index];
 				STDString flagsStr;
@@ -260,53 +322,65 @@ namespace dse
 			} else {
 				return "";
 			}
-		} else if (typeInfo->Values.ItemCount > 0) {
+
+		case StatAttributeHandle::ValueType::Enumeration:
+		{
+			auto typeInfo = modifierValueList.Find(attribute.EnumerationIndex);
 			auto enumLabel = typeInfo->Values.FindByValue(index);
 			if (enumLabel) {
 				return enumLabel->Str;
-			}
-			else {
+			} else {
 				return {};
 			}
 		}
-		else {
+
+		default:
 			return {};
 		}
 	}
 
 	std::optional<int> CRPGStatsManager::GetAttributeInt(CRPGStats_Object * object, const char * attributeName)
 	{
-		int attributeIndex;
-		auto typeInfo = GetAttributeInfo(object, attributeName, attributeIndex);
-		if (typeInfo == nullptr) {
+		auto attribute = ResolveAttribute(object->ModifierListIndex, attributeName);
+		if (!attribute) {
 			return {};
 		}
 
-		auto index = object->IndexedProperties[attributeIndex];
-		if (strcmp(typeInfo->Name.Str, "ConstantInt") == 0
-			|| typeInfo->Values.ItemCount > 0) {
-			return index;
+		return GetAttributeInt(object, *attribute);
+	}
+
+	std::optional<int> CRPGStatsManager::GetAttributeInt(CRPGStats_Object * object, StatAttributeHandle const & attribute)
+	{
+		if ((int32_t)object->ModifierListIndex != attribute.ModifierListIndex) {
+			return {};
 		}
-		else {
+
+		if (attribute.Type == StatAttributeHandle::ValueType::ConstantInt
+			|| attribute.Type == StatAttributeHandle::ValueType::Enumeration) {
+			return object->IndexedProperties[attribute.AttributeIndex];
+		} else {
 			return {};
 		}
 	}
 
 	std::optional<int> CRPGStatsManager::GetAttributeIntScaled(CRPGStats_Object * object, const char * attributeName, int level)
 	{
-		auto objModifiers = modifierList.Find(object->ModifierListIndex);
-		if (objModifiers == nullptr) {
+		auto attribute = ResolveAttribute(object->ModifierListIndex, attributeName);
+		if (!attribute) {
 			return {};
 		}
 
-		int attributeIndex;
-		auto modifierInfo = objModifiers->GetAttributeInfo(attributeName, &attributeIndex);
-		if (modifierInfo == nullptr) {
+		return GetAttributeIntScaled(object, *attribute, level);
+	}
+
+	std::optional<int> CRPGStatsManager::GetAttributeIntScaled(CRPGStats_Object * object, StatAttributeHandle const & attribute, int level)
+	{
+		if ((int32_t)object->ModifierListIndex != attribute.ModifierListIndex) {
 			return {};
 		}
 
-		auto levelMap = LevelMaps.Find(modifierInfo->LevelMapIndex);
-		auto value = object->IndexedProperties[attributeIndex];
+		auto levelMap = LevelMaps.Find(attribute.LevelMapIndex);
+		auto value = object->IndexedProperties[attribute.AttributeIndex];
 		if (levelMap) {
 			return (int32_t)levelMap->GetScaledValue(value, level);
 		} else {
@@ -314,23 +388,72 @@ namespace dse
 		}
 	}
 
+	// Extender-side index of CRPGStatsManager::ModifierFSSet, as the game only stores it as an array.
+	// The set is only ever appended to, so the index is extended with new strings on each lookup.
+	// It is cleared by ResetModifierFSSetIndex() when the stats are (re)loaded.
+	struct ModifierFSSetIndex
+	{
+		// Number of strings at the start of the set that were added to Indices
+		uint32_t IndexedSize{ 0 };
+		std::unordered_map<FixedString, int> Indices;
+		std::mutex Mutex;
+
+		void Update(ObjectSet<FixedString, GameMemoryAllocator, true> const & strings)
+		{
+			// Only keeps stale indices from pointing past the end of the set if a reload was missed
+			if (IndexedSize > strings.Set.Size) {
+				Reset();
+			}
+
+			for (; IndexedSize < strings.Set.Size; IndexedSize++) {
+				// Keep the first index of duplicate strings, like a linear search would
+				Indices.insert(std::make_pair(strings.Set[IndexedSize], (int)IndexedSize));
+			}
+		}
+
+		void Reset()
+		{
+			IndexedSize = 0;
+			Indices.clear();
+		}
+	};
+
+	ModifierFSSetIndex gModifierFSSetIndex;
+
+	void ResetModifierFSSetIndex()
+	{
+		std::lock_guard<std::mutex> lock(gModifierFSSetIndex.Mutex);
+		gModifierFSSetIndex.Reset();
+	}
+
 	int CRPGStatsManager::GetOrCreateFixedString(const char * value)
 	{
 		auto fs = MakeFixedString(value);
 		if (!fs) return -1;
 
 		auto & strings = ModifierFSSet.Set;
-		for (uint32_t i = 0; i < strings.Size; i++) {
-			if (strings[i] == fs) {
-				return i;
-			}
+		auto & index = gModifierFSSetIndex;
+		std::lock_guard<std::mutex> lock(index.Mutex);
+
+		index.Update(ModifierFSSet);
+		auto it = index.Indices.find(fs);
+		if (it != index.Indices.end() && strings[it->second] != fs) {
+			// The set was modified in place without changing its size; reindex it
+			index.Reset();
+			index.Update(ModifierFSSet);
+			it = index.Indices.find(fs);
+		}
+
+		if (it != index.Indices.end()) {
+			return it->second;
 		}
 
 		strings.Add(fs);
+		index.Update(ModifierFSSet);
 		return strings.Size - 1;
 	}
 
-	std::optional<uint64_t> CRPGStatsManager::StringToAttributeFlags(const char * value)
+	std::optional<uint64_t> CRPGStatsManager::StringToAttributeFlags(const char * value, STDString * invalidLabel)
 	{
 		uint64_t flags{ 0 };
 		STDString token;
@@ -339,6 +462,9 @@ namespace dse
 			auto label = EnumInfo<StatAttributeFlags>::Find(token.c_str());
 			if (label) {
 				flags |= *label;
+			} else if (invalidLabel != nullptr) {
+				*invalidLabel = token;
+				return {};
 			} else {
 				OsiError("Invalid AttributeFlag: " << token);
 			}
@@ -349,21 +475,38 @@ namespace dse
 
 	bool CRPGStatsManager::SetAttributeString(CRPGStats_Object * object, const char * attributeName, const char * value)
 	{
-		int attributeIndex;
-		auto typeInfo = GetAttributeInfo(object, attributeName, attributeIndex);
-		if (typeInfo == nullptr) {
+		auto attribute = ResolveAttribute(object->ModifierListIndex, attributeName);
+		if (!attribute) {
 			OsiError("Couldn't fetch type info for " << object->Name << "." << attributeName);
 			return false;
 		}
 
-		if (strcmp(typeInfo->Name.Str, "FixedString") == 0) {
+		return SetAttributeString(object, *attribute, value);
+	}
+
+	bool CRPGStatsManager::SetAttributeString(CRPGStats_Object * object, StatAttributeHandle const & attribute, const char * value)
+	{
+		auto attributeName = attribute.Name.Str;
+		if ((int32_t)object->ModifierListIndex != attribute.ModifierListIndex) {
+			OsiError("Couldn't set " << object->Name << "." << attributeName << ": Attribute handle belongs to a different stats type");
+			return false;
+		}
+
+		auto attributeIndex = attribute.AttributeIndex;
+		switch (attribute.Type) {
+		case StatAttributeHandle::ValueType::FixedString:
+		{
 			auto fs = GetOrCreateFixedString(value);
 			if (fs != -1) {
 				object->IndexedProperties[attributeIndex] = fs;
 			} else {
 				OsiError("Couldn't set " << object->Name << "." << attributeName << ": Unable to allocate pooled string");
 			}
-		} else if (strcmp(typeInfo->Name.Str, "AttributeFlags") == 0) {
+			break;
+		}
+
+		case StatAttributeHandle::ValueType::AttributeFlags:
+		{
 			auto attrFlagsIndex = object->IndexedProperties[attributeIndex];
 			if (attrFlagsIndex != -1) {
 				auto & attrFlags = AttributeFlags[attrFlagsIndex];
@@ -374,48 +517,96 @@ namespace dse
 			} else {
 				OsiError("Couldn't set " << object->Name << "." << attributeName << ": Stats entry has no AttributeFlags");
 			}
-		} else if (typeInfo->Values.ItemCount > 0) {
-			auto enumIndex = typeInfo->Values.Find(value);
-			if (enumIndex != nullptr) {
+			break;
+		}
+
+		case StatAttributeHandle::ValueType::Enumeration:
+		{
+			auto enumIndex = EnumLabelToIndex(attribute, value);
+			if (enumIndex) {
 				object->IndexedProperties[attributeIndex] = *enumIndex;
 			} else {
 				OsiError("Couldn't set " << object->Name << "." << attributeName << ": Value (\"" << value << "\") is not a valid enum label");
 				return false;
 			}
-		} else {
+			break;
+		}
+
+		default:
+		{
+			auto typeInfo = modifierValueList.Find(attribute.EnumerationIndex);
 			OsiError("Couldn't set " << object->Name << "." << attributeName << ": Inappropriate type: " << typeInfo->Name.Str);
 			return false;
 		}
+		}
 
 		return true;
 	}
 
 	bool CRPGStatsManager::SetAttributeInt(CRPGStats_Object * object, const char * attributeName, int32_t value)
 	{
-		int attributeIndex;
-		auto typeInfo = GetAttributeInfo(object, attributeName, attributeIndex);
-		if (typeInfo == nullptr) {
+		auto attribute = ResolveAttribute(object->ModifierListIndex, attributeName);
+		if (!attribute) {
 			OsiError("Couldn't fetch type info for " << object->Name << "." << attributeName);
 			return false;
 		}
 
-		if (strcmp(typeInfo->Name.Str, "ConstantInt") == 0) {
+		return SetAttributeInt(object, *attribute, value);
+	}
+
+	bool CRPGStatsManager::SetAttributeInt(CRPGStats_Object * object, StatAttributeHandle const & attribute, int32_t value)
+	{
+		auto attributeName = attribute.Name.Str;
+		if ((int32_t)object->ModifierListIndex != attribute.ModifierListIndex) {
+			OsiError("Couldn't set " << object->Name << "." << attributeName << ": Attribute handle belongs to a different stats type");
+			return false;
+		}
+
+		auto attributeIndex = attribute.AttributeIndex;
+		switch (attribute.Type) {
+		case StatAttributeHandle::ValueType::ConstantInt:
 			object->IndexedProperties[attributeIndex] = value;
-		} else if (typeInfo->Values.ItemCount > 0) {
-			if (value > 0 && value < (int)typeInfo->Values.ItemCount) {
+			break;
+
+		case StatAttributeHandle::ValueType::Enumeration:
+		{
+			if (IsValidEnumIndex(attribute, value)) {
 				object->IndexedProperties[attributeIndex] = value;
 			} else {
 				OsiError("Couldn't set " << object->Name << "." << attributeName << ": Enum index (\"" << value << "\") out of range");
 				return false;
 			}
-		} else {
+			break;
+		}
+
+		default:
+		{
+			auto typeInfo = modifierValueList.Find(attribute.EnumerationIndex);
 			OsiError("Couldn't set " << object->Name << "." << attributeName << ": Inappropriate type: " << typeInfo->Name.Str);
 			return false;
 		}
+		}
 
 		return true;
 	}
 
+	std::optional<int32_t> CRPGStatsManager::EnumLabelToIndex(StatAttributeHandle const & attribute, const char * enumLabel)
+	{
+		auto typeInfo = modifierValueList.Find(attribute.EnumerationIndex);
+		auto enumIndex = typeInfo->Values.Find(enumLabel);
+		if (enumIndex != nullptr) {
+			return *enumIndex;
+		} else {
+			return {};
+		}
+	}
+
+	bool CRPGStatsManager::IsValidEnumIndex(StatAttributeHandle const & attribute, int32_t index)
+	{
+		auto typeInfo = modifierValueList.Find(attribute.EnumerationIndex);
+		return index > 0 && index < (int)typeInfo->Values.ItemCount;
+	}
+
 	CRPGStats_Object * StatFindObject(char const * name)
 	{
 		auto stats = GetStaticSymbols().GetStats();
@@ -1168,6 +1359,58 @@ namespace dse
 		}
 	}
 
+	int32_t DamagePairList::GetByType(DamageType damageType) const
+	{
+		int32_t amount = 0;
+		for (uint32_t i = 0; i < Size; i++) {
+			if (Buf[i].DamageType == damageType) {
+				amount += Buf[i].Amount;
+			}
+		}
+
+		return amount;
+	}
+
+	void DamagePairList::Multiply(double multiplier)
+	{
+		for (uint32_t i = 0; i < Size; i++) {
+			Buf[i].Amount = (int32_t)round(Buf[i].Amount * multiplier);
+		}
+	}
+
+	void DamagePairList::Merge(DamagePairList const & other)
+	{
+		for (uint32_t i = 0; i < other.Size; i++) {
+			AddDamage(other.Buf[i].DamageType, other.Buf[i].Amount);
+		}
+	}
+
+	void DamagePairList::ConvertDamageType(DamageType damageType)
+	{
+		int32_t totalDamage = 0;
+		for (uint32_t i = 0; i < Size; i++) {
+			totalDamage += Buf[i].Amount;
+		}
+
+		Clear();
+		AddDamage(damageType, totalDamage);
+	}
+
+	void DamagePairList::AggregateSameTypeDamages()
+	{
+		for (uint32_t i = Size; i > 0; i--) {
+			auto & src = Buf[i - 1];
+			for (uint32_t j = i - 1; j > 0; j--) {
+				auto & dest = Buf[j - 1];
+				if (src.DamageType == dest.DamageType) {
+					dest.Amount += src.Amount;
+					Remove(i - 1);
+					break;
+				}
+			}
+		}
+	}
+
 
 	namespace esv
 	{
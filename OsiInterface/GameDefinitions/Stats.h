@@ -771,6 +771,28 @@ namespace dse
 	};
 
 
+	// Attribute of a stats type (modifier list) with the name and type lookups already done;
+	// can be used to access the attribute on any stats object of that type
+	struct StatAttributeHandle
+	{
+		enum class ValueType : uint8_t
+		{
+			FixedString,
+			AttributeFlags,
+			ConstantInt,
+			Enumeration,
+			Unsupported
+		};
+
+		int32_t ModifierListIndex{ -1 };
+		int32_t AttributeIndex{ -1 };
+		int32_t EnumerationIndex{ -1 };
+		int32_t LevelMapIndex{ -1 };
+		ValueType Type{ ValueType::Unsupported };
+		FixedString Name;
+	};
+
+
 	struct CRPGStatsManager : public ProtectedGameObject<CRPGStatsManager>
 	{
 		CNamedElementManager<RPGEnumeration> modifierValueList;
@@ -825,15 +847,32 @@ namespace dse
 		std::optional<int> GetAttributeIntScaled(CRPGStats_Object * object, const char * attributeName, int level);
 		bool SetAttributeString(CRPGStats_Object * object, const char * attributeName, const char * value);
 		bool SetAttributeInt(CRPGStats_Object * object, const char * attributeName, int32_t value);
+
+		std::optional<StatAttributeHandle> ResolveAttribute(int32_t modifierListIndex, const char * attributeName);
+		std::optional<StatAttributeHandle> ResolveAttribute(const char * modifierListName, const char * attributeName);
+		// Handle-based accessors; the object must be of the type the handle was resolved for
+		std::optional<char const *> GetAttributeString(CRPGStats_Object * object, StatAttributeHandle const & attribute);
+		std::optional<int> GetAttributeInt(CRPGStats_Object * object, StatAttributeHandle const & attribute);
+		std::optional<int> GetAttributeIntScaled(CRPGStats_Object * object, StatAttributeHandle const & attribute, int level);
+		bool SetAttributeString(CRPGStats_Object * object, StatAttributeHandle const & attribute, const char * value);
+		bool SetAttributeInt(CRPGStats_Object * object, StatAttributeHandle const & attribute, int32_t value);
+		// Value lookups used by the handle-based setters; can be used to validate values before setting them
+		std::optional<int32_t> EnumLabelToIndex(StatAttributeHandle const & attribute, const char * enumLabel);
+		bool IsValidEnumIndex(StatAttributeHandle const & attribute, int32_t index);
+
 		bool ObjectExists(FixedString statsId, FixedString type);
 
 		std::optional<int> EnumLabelToIndex(const char * enumName, const char * enumLabel);
 		int GetOrCreateFixedString(const char * value);
-		std::optional<uint64_t> StringToAttributeFlags(const char * value);
+		// If invalidLabel is specified, parsing fails on the first unknown flag (which is returned in invalidLabel);
+		// otherwise unknown flags are logged and skipped
+		std::optional<uint64_t> StringToAttributeFlags(const char * value, STDString * invalidLabel = nullptr);
 	};
 
 	CRPGStats_Object * StatFindObject(char const * name);
 	CRPGStats_Object * StatFindObject(int index);
+	// Clears the string index used by CRPGStatsManager::GetOrCreateFixedString(); called when the stats are loaded
+	void ResetModifierFSSetIndex();
 #pragma pack(pop)
 
 	template <class TTag>
@@ -17,6 +17,11 @@ namespace dse
 	{
 		void AddDamage(DamageType damageType, int32_t amount);
 		void ClearDamage(DamageType damageType);
+		int32_t GetByType(DamageType damageType) const;
+		void Multiply(double multiplier);
+		void Merge(DamagePairList const & other);
+		void ConvertDamageType(DamageType damageType);
+		void AggregateSameTypeDamages();
 	};
 
 	struct HitDamageInfo : public Noncopyable<CRPGStatsManager>
@@ -0,0 +1,158 @@
+#include <stdafx.h>
+#include <Lua/LuaAllocator.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace dse::lua
+{
+	static constexpr std::size_t SizeClassBlockSizes[PoolAllocator::NumSizeClasses] = {
+		16, 32, 48, 64, 96, 128, 192, 256
+	};
+
+	// Maps (size + 15) / 16 to the smallest size class that can hold the block
+	static constexpr uint8_t SizeClassLookup[PoolAllocator::MaxPooledSize / 16 + 1] = {
+		0, 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7
+	};
+
+	PoolAllocator::PoolAllocator()
+	{
+		for (std::size_t i = 0; i < NumSizeClasses; i++) {
+			sizeClasses_[i].Stats.BlockSize = SizeClassBlockSizes[i];
+		}
+	}
+
+	PoolAllocator::~PoolAllocator()
+	{
+		for (auto chunk : chunks_) {
+			free(chunk);
+		}
+	}
+
+	std::size_t PoolAllocator::GetSizeClass(std::size_t size)
+	{
+		return SizeClassLookup[(size + 15) / 16];
+	}
+
+	void * PoolAllocator::Reallocate(void * ptr, std::size_t osize, std::size_t nsize)
+	{
+		if (ptr == nullptr) {
+			if (nsize == 0) return nullptr;
+			osize = 0;
+		}
+
+		if (nsize == 0) {
+			if (osize <= MaxPooledSize) {
+				ReleaseBlock(ptr, GetSizeClass(osize));
+			} else {
+				free(ptr);
+				largeAllocations_--;
+			}
+
+			liveBytes_ -= osize;
+			return nullptr;
+		}
+
+		// Lua expects shrinking a block to always succeed
+		void * newPtr;
+		if (osize > MaxPooledSize && nsize > MaxPooledSize) {
+			newPtr = realloc(ptr, nsize);
+			if (newPtr == nullptr) {
+				if (nsize > osize) return nullptr;
+				// The block stays at its old size; free() doesn't need the size
+				newPtr = ptr;
+			}
+		} else if (ptr != nullptr && osize <= MaxPooledSize && nsize <= MaxPooledSize
+			&& GetSizeClass(osize) == GetSizeClass(nsize)) {
+			newPtr = ptr;
+		} else {
+			if (nsize <= MaxPooledSize) {
+				newPtr = AllocateBlock(GetSizeClass(nsize));
+				if (newPtr == nullptr && osize > MaxPooledSize) {
+					AdoptLargeBlock(ptr, GetSizeClass(nsize));
+					liveBytes_ = liveBytes_ - osize + nsize;
+					return ptr;
+				}
+			} else {
+				newPtr = malloc(nsize);
+				if (newPtr != nullptr) largeAllocations_++;
+			}
+
+			if (newPtr == nullptr) return nullptr;
+
+			if (ptr != nullptr) {
+				memcpy(newPtr, ptr, std::min(osize, nsize));
+				if (osize <= MaxPooledSize) {
+					ReleaseBlock(ptr, GetSizeClass(osize));
+				} else {
+					free(ptr);
+					largeAllocations_--;
+				}
+			}
+		}
+
+		liveBytes_ = liveBytes_ - osize + nsize;
+		peakBytes_ = std::max(peakBytes_, liveBytes_);
+		return newPtr;
+	}
+
+	void * PoolAllocator::AllocateBlock(std::size_t sizeClassIndex)
+	{
+		auto & sizeClass = sizeClasses_[sizeClassIndex];
+		if (sizeClass.FreeList == nullptr) {
+			Refill(sizeClass);
+			if (sizeClass.FreeList == nullptr) return nullptr;
+		}
+
+		auto block = sizeClass.FreeList;
+		sizeClass.FreeList = block->Next;
+		sizeClass.Stats.LiveBlocks++;
+		sizeClass.Stats.TotalAllocations++;
+		return block;
+	}
+
+	void PoolAllocator::ReleaseBlock(void * ptr, std::size_t sizeClassIndex)
+	{
+		auto & sizeClass = sizeClasses_[sizeClassIndex];
+		auto block = reinterpret_cast<FreeBlock *>(ptr);
+		block->Next = sizeClass.FreeList;
+		sizeClass.FreeList = block;
+		sizeClass.Stats.LiveBlocks--;
+	}
+
+	void PoolAllocator::AdoptLargeBlock(void * ptr, std::size_t sizeClassIndex)
+	{
+		// The large block is at least as big as the blocks of the size class, so it can be used as one of
+		// them; when Lua frees it, it goes to the free list of the size class like the other blocks
+		auto & sizeClass = sizeClasses_[sizeClassIndex];
+		sizeClass.Stats.LiveBlocks++;
+		sizeClass.Stats.TotalAllocations++;
+		sizeClass.Stats.ReservedBlocks++;
+		largeAllocations_--;
+
+		// Released with the chunks; we're out of memory at this point, so if this fails the block is leaked
+		try {
+			chunks_.push_back(ptr);
+		} catch (std::bad_alloc &) {}
+	}
+
+	void PoolAllocator::Refill(SizeClass & sizeClass)
+	{
+		auto chunk = reinterpret_cast<uint8_t *>(malloc(ChunkSize));
+		if (chunk == nullptr) return;
+
+		chunks_.push_back(chunk);
+
+		auto blockSize = sizeClass.Stats.BlockSize;
+		auto numBlocks = ChunkSize / blockSize;
+		for (std::size_t i = numBlocks; i > 0; i--) {
+			auto block = reinterpret_cast<FreeBlock *>(chunk + (i - 1) * blockSize);
+			block->Next = sizeClass.FreeList;
+			sizeClass.FreeList = block;
+		}
+
+		sizeClass.Stats.ReservedBlocks += numBlocks;
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace dse::lua
+{
+	// Lua allocator that serves small blocks from per-size-class free lists.
+	// Lua reports the size of the block on every realloc/free call, so blocks don't need a header.
+	// An allocator is owned by a single lua::State; access is serialized by the state lock.
+	class PoolAllocator
+	{
+	public:
+		static constexpr std::size_t NumSizeClasses = 8;
+		static constexpr std::size_t MaxPooledSize = 256;
+		static constexpr std::size_t ChunkSize = 64 * 1024;
+
+		struct SizeClassStats
+		{
+			std::size_t BlockSize{ 0 };
+			std::size_t LiveBlocks{ 0 };
+			std::size_t TotalAllocations{ 0 };
+			std::size_t ReservedBlocks{ 0 };
+		};
+
+		PoolAllocator();
+		~PoolAllocator();
+
+		PoolAllocator(PoolAllocator const &) = delete;
+		PoolAllocator & operator = (PoolAllocator const &) = delete;
+
+		// lua_Alloc semantics; when ptr is null, osize is the type of the object being allocated
+		void * Reallocate(void * ptr, std::size_t osize, std::size_t nsize);
+
+		inline std::size_t GetLiveBytes() const
+		{
+			return liveBytes_;
+		}
+
+		inline std::size_t GetPeakBytes() const
+		{
+			return peakBytes_;
+		}
+
+		inline std::size_t GetLargeAllocations() const
+		{
+			return largeAllocations_;
+		}
+
+		inline SizeClassStats const & GetSizeClassStats(std::size_t sizeClass) const
+		{
+			return sizeClasses_[sizeClass].Stats;
+		}
+
+	private:
+		struct FreeBlock
+		{
+			FreeBlock * Next;
+		};
+
+		struct SizeClass
+		{
+			FreeBlock * FreeList{ nullptr };
+			SizeClassStats Stats;
+		};
+
+		SizeClass sizeClasses_[NumSizeClasses];
+		std::vector<void *> chunks_;
+		std::size_t liveBytes_{ 0 };
+		std::size_t peakBytes_{ 0 };
+		std::size_t largeAllocations_{ 0 };
+
+		static std::size_t GetSizeClass(std::size_t size);
+		void * AllocateBlock(std::size_t sizeClass);
+		void ReleaseBlock(void * ptr, std::size_t sizeClass);
+		// Turns a large block into a pooled block when it can't be moved to the pool on shrink
+		void AdoptLargeBlock(void * ptr, std::size_t sizeClass);
+		void Refill(SizeClass & sizeClass);
+	};
+}
@@ -2,7 +2,10 @@
 #include <OsirisProxy.h>
 #include <PropertyMaps.h>
 #include "LuaBinding.h"
+#include "LuaBytecodeCache.h"
+#include "LuaSerializer.h"
 #include "resource.h"
+#include <algorithm>
 #include <fstream>
 
 namespace dse::lua
@@ -46,6 +49,54 @@ namespace dse::lua
 	}
 
 
+	void TablePool::Push(lua_State * L, uint32_t & slot)
+	{
+		if (idle_.empty()) {
+			lua_newtable(L); // stack: tab
+			slot = (uint32_t)tables_.size();
+			tables_.push_back(RegistryEntry(L, -1));
+			return;
+		}
+
+		slot = idle_.back();
+		idle_.pop_back();
+		tables_[slot].Push(); // stack: tab
+
+		// Remove everything the previous callback left in the table
+		lua_pushnil(L); // stack: tab, nil
+		lua_setmetatable(L, -2); // stack: tab
+		lua_pushnil(L); // stack: tab, nil
+		while (lua_next(L, -2) != 0) { // stack: tab, key, value
+			lua_pop(L, 1); // stack: tab, key
+			lua_pushvalue(L, -1); // stack: tab, key, key
+			lua_pushnil(L); // stack: tab, key, key, nil
+			lua_rawset(L, -4); // stack: tab, key
+		}
+	}
+
+	void TablePool::Release(uint32_t slot)
+	{
+		idle_.push_back(slot);
+	}
+
+	void TablePool::Clear()
+	{
+		tables_.clear();
+		idle_.clear();
+	}
+
+
+	void CallbackArgumentPools::Clear()
+	{
+		CharacterStats.Clear();
+		ItemStats.Clear();
+		Stats.Clear();
+		SkillPrototypes.Clear();
+		DamageLists.Clear();
+		Tables.Clear();
+	}
+
+
 	int TracebackHandler(lua_State * L)
 	{
 		const char *msg = lua_tostring(L, 1);
@@ -66,8 +117,16 @@ namespace dse::lua
 		int base = lua_gettop(L) - narg;  /* function index */
 		lua_pushcfunction(L, &TracebackHandler);  /* push message handler */
 		lua_insert(L, base);  /* put it under function and args */
+		// Frames unwound by an error don't receive a return hook, so the profiler has to be reset manually
+		void * ud;
+		lua_getallocf(L, &ud);
+		auto & profiler = reinterpret_cast<State *>(ud)->GetProfiler();
+		auto depth = profiler.GetCallDepth();
 		int status = lua_pcall(L, narg, nres, base);
 		lua_remove(L, base);  /* remove message handler from the stack */
+		if (status != LUA_OK && profiler.IsEnabled()) {
+			profiler.UnwindTo(depth);
+		}
 		return status;
 	}
 
@@ -108,6 +167,114 @@ namespace dse::lua
 	}
 
 
+	char const * const StatAttributeHandleProxy::MetatableName = "StatAttributeHandle";
+
+	void StatAttributeHandleProxy::PopulateMetatable(lua_State * L)
+	{
+		lua_newtable(L);
+
+		lua_pushcfunction(L, &Get);
+		lua_setfield(L, -2, "Get");
+
+		lua_pushcfunction(L, &Set);
+		lua_setfield(L, -2, "Set");
+
+		lua_setfield(L, -2, "__index");
+	}
+
+	CRPGStats_Object * StatAttributeHandleProxy::FindObject(StatAttributeHandle const & attribute, char const * statName)
+	{
+		auto object = StatFindObject(statName);
+		if (object == nullptr) return nullptr;
+
+		if ((int32_t)object->ModifierListIndex != attribute.ModifierListIndex) {
+			OsiError("Stat object '" << statName << "' is not of the type that attribute '" << attribute.Name.Str << "' was resolved for");
+			return nullptr;
+		}
+
+		return object;
+	}
+
+	int StatAttributeHandleProxy::Get(lua_State * L)
+	{
+		auto const & attribute = CheckUserData(L, 1)->attribute_;
+		auto statName = luaL_checkstring(L, 2);
+
+		auto object = FindObject(attribute, statName);
+		if (!object) return 0;
+
+		auto stats = GetStaticSymbols().GetStats();
+		switch (attribute.Type) {
+		case StatAttributeHandle::ValueType::FixedString:
+		case StatAttributeHandle::ValueType::AttributeFlags:
+		case StatAttributeHandle::ValueType::Enumeration:
+		{
+			auto value = stats->GetAttributeString(object, attribute);
+			if (!value) return 0;
+			push(L, *value);
+			return 1;
+		}
+
+		case StatAttributeHandle::ValueType::ConstantInt:
+		{
+			std::optional<int> value;
+			if (lua_isnoneornil(L, 3)) {
+				value = stats->GetAttributeInt(object, attribute);
+			} else {
+				auto level = (int)luaL_checkinteger(L, 3);
+				if (level == -1) {
+					level = object->Level;
+				}
+
+				value = stats->GetAttributeIntScaled(object, attribute, level);
+			}
+
+			if (!value) return 0;
+			push(L, *value);
+			return 1;
+		}
+
+		default:
+			OsiError("Attribute '" << attribute.Name.Str << "' has an unsupported type");
+			return 0;
+		}
+	}
+
+	int StatAttributeHandleProxy::Set(lua_State * L)
+	{
+		auto const & attribute = CheckUserData(L, 1)->attribute_;
+		auto statName = luaL_checkstring(L, 2);
+
+		LuaVirtualPin lua(gOsirisProxy->GetCurrentExtensionState());
+		if (!(lua->RestrictionFlags & State::ScopeModuleLoad)) {
+			return luaL_error(L, "StatAttributeHandle:Set() can only be called during module load");
+		}
+
+		DescriptionParamCache::InvalidateAll();
+
+		auto object = FindObject(attribute, statName);
+		if (!object) return 0;
+
+		auto stats = GetStaticSymbols().GetStats();
+		bool ok{ false };
+		switch (lua_type(L, 3)) {
+		case LUA_TSTRING:
+			ok = stats->SetAttributeString(object, attribute, lua_tostring(L, 3));
+			break;
+
+		case LUA_TNUMBER:
+			ok = stats->SetAttributeInt(object, attribute, (int32_t)luaL_checkinteger(L, 3));
+			break;
+
+		default:
+			return luaL_error(L, "Expected a string or integer attribute value.");
+		}
+
+		push(L, ok);
+		return 1;
+	}
+
+
 	char const * const SkillPrototypeProxy::MetatableName = "eoc::SkillPrototype";
 
 	SkillPrototypeProxy::SkillPrototypeProxy(SkillPrototype * obj, std::optional<int> level)
@@ -116,6 +283,13 @@ namespace dse::lua
 		stats_ = StatFindObject(obj->RPGStatsObjectIndex);
 	}
 
+	void SkillPrototypeProxy::Rebind(SkillPrototype * obj, std::optional<int> level)
+	{
+		obj_ = obj;
+		level_ = level;
+		stats_ = StatFindObject(obj->RPGStatsObjectIndex);
+	}
+
 	int SkillPrototypeProxy::Index(lua_State * L)
 	{
 		if (stats_ == nullptr) return luaL_error(L, "Attempted to read property of null SkillPrototype object");
@@ -426,29 +600,25 @@ namespace dse::lua
 	}
 
 
-	ItemOrCharacterPushPin::ItemOrCharacterPushPin(lua_State * L, CRPGStats_Object * obj)
+	ItemOrCharacterPushPin::ItemOrCharacterPushPin(lua_State * L, CallbackArgumentPools & pools, CRPGStats_Object * obj)
 	{
 		if (obj == nullptr) {
 			lua_pushnil(L);
 		} else if (obj->ModifierListIndex == GetStaticSymbols().GetStats()->modifierList.FindIndex(ToFixedString("Character"))) {
 			auto ch = reinterpret_cast<CDivinityStats_Character *>(obj);
-			character_ = ObjectProxy<CDivinityStats_Character>::New(L, ch);
+			ObjectProxy<CDivinityStats_Character> * proxy;
+			character_ = PushPooled(L, pools.CharacterStats, proxy, ch);
 		} else if (obj->ModifierListIndex == GetStaticSymbols().GetStats()->modifierList.FindIndex(ToFixedString("Item"))) {
 			auto item = reinterpret_cast<CDivinityStats_Item *>(obj);
-			item_ = ObjectProxy<CDivinityStats_Item>::New(L, item);
+			ObjectProxy<CDivinityStats_Item> * proxy;
+			item_ = PushPooled(L, pools.ItemStats, proxy, item);
 		} else {
-			object_ = StatsProxy::New(L, obj, -1);
+			StatsProxy * proxy;
+			object_ = PushPooled(L, pools.Stats, proxy, obj, std::optional<int>(-1));
 			OsiWarnS("Could not determine stats type of object");
 		}
 	}
 
-	ItemOrCharacterPushPin::~ItemOrCharacterPushPin()
-	{
-		if (character_) character_->Unbind();
-		if (item_) item_->Unbind();
-		if (object_) object_->Unbind();
-	}
-
 
 	char const * const StatsExtraDataProxy::MetatableName = "CRPGStats_ExtraData";
 
@@ -507,15 +677,7 @@ namespace dse::lua
 		auto self = DamageList::CheckUserData(L, 1);
 		auto damageType = checked_get<DamageType>(L, 2);
 
-		int32_t amount = 0;
-		for (uint32_t i = 0; i < self->damages_.Size; i++) {
-			auto const & dmg = self->damages_.Buf[i];
-			if (dmg.DamageType == damageType) {
-				amount += dmg.Amount;
-			}
-		}
-
-		push(L, amount);
+		push(L, self->damages_.GetByType(damageType));
 		return 1;
 	}
 
@@ -548,11 +710,7 @@ namespace dse::lua
 		auto self = DamageList::CheckUserData(L, 1);
 		auto multiplier = luaL_checknumber(L, 2);
 
-		for (uint32_t i = 0; i < self->damages_.Size; i++) {
-			auto & item = self->damages_[i];
-			item.Amount = (int32_t)round(item.Amount * multiplier);
-		}
-
+		self->damages_.Multiply(multiplier);
 		return 0;
 	}
 
@@ -561,11 +719,7 @@ namespace dse::lua
 		auto self = DamageList::CheckUserData(L, 1);
 		auto other = DamageList::CheckUserData(L, 2);
 
-		for (uint32_t i = 0; i < other->damages_.Size; i++) {
-			auto & item = other->damages_[i];
-			self->damages_.AddDamage(item.DamageType, item.Amount);
-		}
-
+		self->damages_.Merge(other->damages_);
 		return 0;
 	}
 
@@ -574,14 +728,7 @@ namespace dse::lua
 		auto self = DamageList::CheckUserData(L, 1);
 		auto damageType = checked_get<DamageType>(L, 2);
 
-		int32_t totalDamage = 0;
-		for (uint32_t i = 0; i < self->damages_.Size; i++) {
-			totalDamage += self->damages_[i].Amount;
-		}
-
-		self->damages_.Clear();
-		self->damages_.AddDamage(damageType, totalDamage);
-
+		self->damages_.ConvertDamageType(damageType);
 		return 0;
 	}
 
@@ -589,18 +736,7 @@ namespace dse::lua
 	{
 		auto self = DamageList::CheckUserData(L, 1);
 
-		for (uint32_t i = self->damages_.Size; i > 0; i--) {
-			auto & src = self->damages_[i - 1];
-			for (uint32_t j = i - 1; j > 0; j--) {
-				auto & dest = self->damages_[j - 1];
-				if (src.DamageType == dest.DamageType) {
-					dest.Amount += src.Amount;
-					self->damages_.Remove(i - 1);
-					break;
-				}
-			}
-		}
-
+		self->damages_.AggregateSameTypeDamages();
 		return 0;
 	}
 
@@ -629,12 +765,14 @@ namespace dse::lua
 	void ExtensionLibrary::Register(lua_State * L)
 	{
 		RegisterLib(L);
+		RegisterGameMathLib(L);
 		ObjectProxy<CDivinityStats_Character>::RegisterMetatable(L);
 		ObjectProxy<CharacterDynamicStat>::RegisterMetatable(L);
 		ObjectProxy<CDivinityStats_Item>::RegisterMetatable(L);
 		ObjectProxy<CDivinityStats_Equipment_Attributes>::RegisterMetatable(L);
 		StatsExtraDataProxy::RegisterMetatable(L);
 		StatsProxy::RegisterMetatable(L);
+		StatAttributeHandleProxy::RegisterMetatable(L);
 		SkillPrototypeProxy::RegisterMetatable(L);
 		DamageList::RegisterMetatable(L);
 	}
@@ -674,6 +812,8 @@ namespace dse::lua
 	static const luaL_Reg loadedlibs[] = {
 	  {"_G", luaopen_base},
 	  {LUA_TABLIBNAME, luaopen_table},
+	  // Needed for yielding from scheduled tasks
+	  {LUA_COLIBNAME, luaopen_coroutine},
 	  {LUA_STRLIBNAME, luaopen_string},
 	  {LUA_MATHLIBNAME, luaopen_math},
 	  // debug table is stripped in the sandbox startup script
@@ -686,11 +826,68 @@ namespace dse::lua
 		throw Exception();
 	}
 
+	void * State::LuaAlloc(void * ud, void * ptr, size_t osize, size_t nsize)
+	{
+		auto self = reinterpret_cast<State *>(ud);
+		if (ptr != nullptr && nsize < osize) {
+			if (self->inIdleGC_) {
+				self->gcStats_.IdleFreedBytes += osize - nsize;
+			} else {
+				self->gcStats_.NonIdleFrees++;
+				self->gcStats_.NonIdleFreedBytes += osize - nsize;
+			}
+		}
+
+		if (nsize != 0 && self->profiler_.IsEnabled()) {
+			// When ptr is null, osize contains the type of the object being allocated
+			if (ptr == nullptr) {
+				self->profiler_.OnAllocation(nsize);
+			} else if (nsize > osize) {
+				self->profiler_.OnAllocation(nsize - osize);
+			}
+		}
+
+		return self->allocator_.Reallocate(ptr, osize, nsize);
+	}
+
+	State * State::FromLua(lua_State * L)
+	{
+		void * ud{ nullptr };
+		lua_getallocf(L, &ud);
+		return reinterpret_cast<State *>(ud);
+	}
+
+	// Lua runs the finalizer at the end of the cycle that collected the sentinel, so it
+	// sees the post-collection heap size of every cycle, including allocation-driven ones
+	int State::GCSentinelFinalizer(lua_State * L)
+	{
+		auto self = FromLua(L);
+		self->gcBaseKB_ = lua_gc(L, LUA_GCCOUNT, 0);
+		if (!self->closing_) {
+			self->CreateGCSentinel();
+		}
+
+		return 0;
+	}
+
+	void State::CreateGCSentinel()
+	{
+		lua_newtable(L); // stack: sentinel
+		lua_newtable(L); // stack: sentinel, mt
+		lua_pushcfunction(L, &GCSentinelFinalizer); // stack: sentinel, mt, fn
+		lua_setfield(L, -2, "__gc"); // stack: sentinel, mt
+		lua_setmetatable(L, -2); // stack: sentinel
+		lua_pop(L, 1);
+	}
+
 	State::State()
 	{
-		L = luaL_newstate();
+		std::fill(std::begin(extCallbackRefs_), std::end(extCallbackRefs_), LUA_NOREF);
+		L = lua_newstate(&LuaAlloc, this);
 		lua_atpanic(L, &LuaPanic);
 		OpenLibs();
+		CreateGCSentinel();
+		gcBaseKB_ = lua_gc(L, LUA_GCCOUNT, 0);
 	}
 
 	void RestoreLevelMaps(std::unordered_set<int32_t> const &);
@@ -698,20 +895,214 @@ namespace dse::lua
 	State::~State()
 	{
 		RestoreLevelMaps(OverriddenLevelMaps);
+		callbackPools_.Clear();
+		profiler_.Stop();
+		closing_ = true;
 		lua_close(L);
 	}
 
 	void State::LoadBootstrap(STDString const& path, STDString const& modTable)
 	{
-		CallExt("_LoadBootstrap", RestrictAll, ReturnType<>{}, path, modTable);
+		CallExt(ExtCallback::LoadBootstrap, RestrictAll, ReturnType<>{}, path, modTable);
 	}
 
 	void State::FinishStartup()
 	{
 		assert(!startupDone_);
 		startupDone_ = true;
+		// Bootstrap scripts allocate most of the long-lived data; measure the base after them,
+		// so idle collection doesn't start right away
+		gcBaseKB_ = lua_gc(L, LUA_GCCOUNT, 0);
 	}
 		
+	static char const * const EngineEventNames[] = {
+		"GetHitChance",
+		"GetSkillDamage",
+		"ComputeCharacterHit",
+		"CalculateTurnOrder",
+		"StatusGetEnterChance",
+		"SkillGetDescriptionParam",
+		"StatusGetDescriptionParam"
+	};
+
+	static_assert(std::size(EngineEventNames) == (std::size_t)EngineEvent::Count, "Engine event name list out of sync");
+	static_assert((std::size_t)EngineEvent::Count <= 32, "Engine event listener mask is too small");
+
+	void State::OnListenerRegistered(char const * event)
+	{
+		for (uint32_t i = 0; i < std::size(EngineEventNames); i++) {
+			if (strcmp(event, EngineEventNames[i]) == 0) {
+				engineListeners_ |= 1u << i;
+				break;
+			}
+		}
+	}
+
+	void State::SetGCParameters(GCParameters const & params)
+	{
+		std::lock_guard lock(mutex_);
+		gcParams_ = params;
+		lua_gc(L, LUA_GCSETPAUSE, gcParams_.Pause);
+		lua_gc(L, LUA_GCSETSTEPMUL, gcParams_.StepMultiplier);
+	}
+
+	void State::RunIdleGC(bool perTick)
+	{
+		if (gcParams_.IdleStepBudget.count() <= 0) return;
+
+		std::unique_lock lock(mutex_, std::try_to_lock);
+		if (!lock) return;
+
+		auto heapKB = lua_gc(L, LUA_GCCOUNT, 0);
+		if (perTick) {
+			auto triggerKB = gcBaseKB_ + (int)((int64_t)gcBaseKB_ * (gcParams_.Pause - 100) / 200);
+			if (heapKB < triggerKB) return;
+		}
+
+		inIdleGC_ = true;
+		auto start = std::chrono::high_resolution_clock::now();
+		auto deadline = start + gcParams_.IdleStepBudget;
+		auto now = start;
+		do {
+			gcStats_.IdleSteps++;
+			// Returns 1 when the step finished a collection cycle
+			if (lua_gc(L, LUA_GCSTEP, 0)) {
+				gcStats_.CompletedCycles++;
+				gcBaseKB_ = lua_gc(L, LUA_GCCOUNT, 0);
+				now = std::chrono::high_resolution_clock::now();
+				break;
+			}
+
+			now = std::chrono::high_resolution_clock::now();
+		} while (now < deadline);
+
+		inIdleGC_ = false;
+		auto sliceTime = std::chrono::duration_cast<std::chrono::nanoseconds>(now - start);
+		if (perTick) {
+			gcStats_.TickSlices++;
+		} else {
+			gcStats_.IdleSlices++;
+		}
+		gcStats_.IdleTime += sliceTime;
+		gcStats_.MaxIdleSliceTime = std::max(gcStats_.MaxIdleSliceTime, sliceTime);
+	}
+
+	static char const * const ExtCallbackNames[] = {
+		"_LoadBootstrap",
+		"_NetMessageReceived",
+		"_OnGameSessionLoading",
+		"_OnGameSessionLoaded",
+		"_OnModuleLoading",
+		"_OnModuleResume",
+		"_GetHitChance",
+		"_GetSkillDamage",
+		"_ComputeCharacterHit",
+		"_CalculateTurnOrder",
+		"_StatusGetEnterChance",
+		"_UICall",
+		"_SkillGetDescriptionParam",
+		"_StatusGetDescriptionParam"
+	};
+
+	static_assert(std::size(ExtCallbackNames) == (std::size_t)ExtCallback::Count, "Ext callback name list out of sync");
+
+	char const * State::GetExtCallbackName(ExtCallback callback)
+	{
+		return ExtCallbackNames[(uint32_t)callback];
+	}
+
+	void State::ResolveExtCallbacks()
+	{
+		lua_getglobal(L, "Ext"); // stack: Ext
+		for (uint32_t i = 0; i < (uint32_t)ExtCallback::Count; i++) {
+			luaL_unref(L, LUA_REGISTRYINDEX, extCallbackRefs_[i]);
+			lua_getfield(L, -1, ExtCallbackNames[i]); // stack: Ext, fn
+			if (lua_type(L, -1) == LUA_TFUNCTION) {
+				extCallbackRefs_[i] = luaL_ref(L, LUA_REGISTRYINDEX); // stack: Ext
+			} else {
+				// Callbacks that only exist in the client or server context
+				extCallbackRefs_[i] = LUA_NOREF;
+				lua_pop(L, 1); // stack: Ext
+			}
+		}
+
+		lua_pop(L, 1); // stack: -
+	}
+
+	void State::PushExtCallback(ExtCallback callback)
+	{
+		auto ref = extCallbackRefs_[(uint32_t)callback];
+		if (ref != LUA_NOREF) {
+			lua_rawgeti(L, LUA_REGISTRYINDEX, ref); // stack: fn
+		} else {
+			lua_pushnil(L); // stack: nil
+		}
+	}
+
+	void State::RunScheduledTasks()
+	{
+		std::unique_lock lock(mutex_, std::try_to_lock);
+		if (!lock) return;
+
+		auto budget = std::chrono::milliseconds(gOsirisProxy->GetConfig().LuaTaskBudget);
+		taskScheduler_.Update(L, budget);
+	}
+
+	int CallJobCallback(lua_State * L)
+	{
+		auto job = reinterpret_cast<WorkerPool::Job *>(lua_touserdata(L, 1));
+		lua_settop(L, 0);
+
+		lua_rawgeti(L, LUA_REGISTRYINDEX, job->CallbackRef); // stack: fn
+		push(L, job->Succeeded); // stack: fn, succeeded
+		if (!job->Succeeded) {
+			push(L, job->Error.c_str()); // stack: fn, succeeded, error
+			lua_call(L, 2, 0); // stack: -
+			return 0;
+		}
+
+		DeserializeValue(L, job->Results.data(), job->Results.size()); // stack: fn, succeeded, results
+		lua_getfield(L, 3, "n"); // stack: fn, succeeded, results, n
+		auto numResults = (int)lua_tointeger(L, -1);
+		lua_pop(L, 1); // stack: fn, succeeded, results
+		luaL_checkstack(L, numResults, "Too many job results");
+		for (int i = 1; i <= numResults; i++) {
+			lua_rawgeti(L, 3, i); // stack: fn, succeeded, results, ret1 ... retn
+		}
+
+		lua_remove(L, 3); // stack: fn, succeeded, ret1 ... retn
+		lua_call(L, 1 + numResults, 0); // stack: -
+		return 0;
+	}
+
+	void State::ProcessCompletedJobs()
+	{
+		if (!workerPool_.IsStarted()) return;
+
+		std::unique_lock lock(mutex_, std::try_to_lock);
+		if (!lock) return;
+
+		std::vector<WorkerPool::Job> jobs;
+		workerPool_.TakeCompletedJobs(jobs);
+		for (auto & job : jobs) {
+			if (job.CallbackRef == LUA_NOREF) {
+				if (!job.Succeeded) {
+					OsiError("Worker job '" << job.Function << "' failed: " << job.Error);
+				}
+				continue;
+			}
+
+			lua_pushcfunction(L, &CallJobCallback); // stack: fn
+			lua_pushlightuserdata(L, &job); // stack: fn, job
+			if (CallWithTraceback(L, 1, 0) != LUA_OK) { // stack: -
+				OsiError("Completion callback of worker job '" << job.Function << "' failed: " << lua_tostring(L, -1));
+				lua_pop(L, 1);
+			}
+
+			luaL_unref(L, LUA_REGISTRYINDEX, job.CallbackRef);
+		}
+	}
+
 	void State::OpenLibs()
 	{
 		const luaL_Reg *lib;
@@ -728,7 +1119,7 @@ namespace dse::lua
 		int top = lua_gettop(L);
 
 		/* Load the file containing the script we are going to run */
-		int status = luaL_loadbufferx(L, script.c_str(), script.size(), name.c_str(), "text");
+		int status = LoadBufferCached(L, script, name);
 		if (status != LUA_OK) {
 			OsiError("Failed to parse script: " << lua_tostring(L, -1));
 			lua_pop(L, 1);  /* pop error message from the stack */
@@ -751,10 +1142,10 @@ namespace dse::lua
 		std::lock_guard lock(mutex_);
 		Restriction restriction(*this, RestrictAll);
 
-		PushExtFunction(L, "_GetHitChance"); // stack: fn
-		auto _{ PushArguments(L,
-			std::tuple{Push<ObjectProxy<CDivinityStats_Character>>(attacker),
-			Push<ObjectProxy<CDivinityStats_Character>>(target)}) };
+		PushExtCallback(ExtCallback::GetHitChance); // stack: fn
+		ObjectProxy<CDivinityStats_Character> * luaAttacker, * luaTarget;
+		auto _{ PushPooled(L, callbackPools_.CharacterStats, luaAttacker, attacker) };
+		auto _2{ PushPooled(L, callbackPools_.CharacterStats, luaTarget, target) };
 
 		auto result = CheckedCall<std::optional<int32_t>>(L, 2, "Ext.GetHitChance");
 		if (result) {
@@ -771,23 +1162,23 @@ namespace dse::lua
 		std::lock_guard lock(mutex_);
 		Restriction restriction(*this, RestrictAll);
 
-		PushExtFunction(L, "_GetSkillDamage"); // stack: fn
+		PushExtCallback(ExtCallback::GetSkillDamage); // stack: fn
 
-		auto luaSkill = SkillPrototypeProxy::New(L, skill, -1); // stack: fn, skill
-		UnbindablePin _(luaSkill);
-		ItemOrCharacterPushPin _a(L, attacker);
+		SkillPrototypeProxy * luaSkill;
+		auto _{ PushPooled(L, callbackPools_.SkillPrototypes, luaSkill, skill, std::optional<int>(-1)) }; // stack: fn, skill
+		ItemOrCharacterPushPin _a(L, callbackPools_, attacker);
 
 		push(L, isFromItem);
 		push(L, stealthed);
 		
 		// Push attacker position
-		lua_newtable(L);
+		auto _ap{ PushPooledTable(L, callbackPools_.Tables) };
 		settable(L, 1, attackerPosition[0]);
 		settable(L, 2, attackerPosition[1]);
 		settable(L, 3, attackerPosition[2]);
 
 		// Push target position
-		lua_newtable(L);
+		auto _tp{ PushPooledTable(L, callbackPools_.Tables) };
 		settable(L, 1, targetPosition[0]);
 		settable(L, 2, targetPosition[1]);
 		settable(L, 3, targetPosition[2]);
@@ -820,27 +1211,27 @@ namespace dse::lua
 
 	void State::OnNetMessageReceived(STDString const & channel, STDString const & payload)
 	{
-		CallExt("_NetMessageReceived", 0, ReturnType<>{}, channel, payload);
+		CallExt(ExtCallback::NetMessageReceived, 0, ReturnType<>{}, channel, payload);
 	}
 
 	void State::OnGameSessionLoading()
 	{
-		CallExt("_OnGameSessionLoading", RestrictAll | ScopeSessionLoad, ReturnType<>{});
+		CallExt(ExtCallback::OnGameSessionLoading, RestrictAll | ScopeSessionLoad, ReturnType<>{});
 	}
 
 	void State::OnGameSessionLoaded()
 	{
-		CallExt("_OnGameSessionLoaded", RestrictAll, ReturnType<>{});
+		CallExt(ExtCallback::OnGameSessionLoaded, RestrictAll, ReturnType<>{});
 	}
 
 	void State::OnModuleLoading()
 	{
-		CallExt("_OnModuleLoading", RestrictAll | ScopeModuleLoad, ReturnType<>{});
+		CallExt(ExtCallback::OnModuleLoading, RestrictAll | ScopeModuleLoad, ReturnType<>{});
 	}
 
 	void State::OnModuleResume()
 	{
-		CallExt("_OnModuleResume", RestrictAll | ScopeModuleResume, ReturnType<>{});
+		CallExt(ExtCallback::OnModuleResume, RestrictAll | ScopeModuleResume, ReturnType<>{});
 	}
 
 	STDString State::GetBuiltinLibrary(int resourceId)
@@ -3,7 +3,11 @@
 #include <GameDefinitions/Character.h>
 #include <GameDefinitions/Item.h>
 #include <GameDefinitions/Status.h>
+#include <Lua/LuaAllocator.h>
 #include <Lua/LuaHelpers.h>
+#include <Lua/LuaProfiler.h>
+#include <Lua/LuaTaskScheduler.h>
+#include <Lua/LuaWorkerPool.h>
 
 #include <mutex>
 #include <unordered_set>
@@ -13,6 +17,8 @@
 namespace dse::lua
 {
 	void PushExtFunction(lua_State * L, char const * func);
+	// Registers the native Game.Math implementation as Ext._NativeMath
+	void RegisterGameMathLib(lua_State * L);
 
 	template <class T>
 	class ObjectProxy : public Userdata<ObjectProxy<T>>, public Indexable, public NewIndexable, public Pushable<PushPolicy::Unbind>
@@ -28,6 +34,12 @@ namespace dse::lua
 			: obj_(nullptr), handle_(handle)
 		{}
 
+		void Rebind(T * obj)
+		{
+			obj_ = obj;
+			handle_ = ObjectHandle();
+		}
+
 		void Unbind()
 		{
 			obj_ = nullptr;
@@ -52,6 +64,12 @@ namespace dse::lua
 			: obj_(obj), level_(level)
 		{}
 
+		void Rebind(CRPGStats_Object * obj, std::optional<int> level)
+		{
+			obj_ = obj;
+			level_ = level;
+		}
+
 		void Unbind()
 		{
 			obj_ = nullptr;
@@ -66,6 +84,26 @@ namespace dse::lua
 	};
 
 
+	class StatAttributeHandleProxy : public Userdata<StatAttributeHandleProxy>, public Pushable<PushPolicy::None>
+	{
+	public:
+		static char const * const MetatableName;
+
+		static void PopulateMetatable(lua_State * L);
+
+		inline StatAttributeHandleProxy(StatAttributeHandle const & attribute)
+			: attribute_(attribute)
+		{}
+
+	private:
+		StatAttributeHandle attribute_;
+
+		static int Get(lua_State * L);
+		static int Set(lua_State * L);
+		static CRPGStats_Object * FindObject(StatAttributeHandle const & attribute, char const * statName);
+	};
+
+
 	class SkillPrototypeProxy : public Userdata<SkillPrototypeProxy>, public Indexable, public Pushable<PushPolicy::Unbind>
 	{
 	public:
@@ -73,11 +111,28 @@ namespace dse::lua
 
 		SkillPrototypeProxy(SkillPrototype * obj, std::optional<int> level);
 
+		void Rebind(SkillPrototype * obj, std::optional<int> level);
+
 		void Unbind()
 		{
 			obj_ = nullptr;
 		}
 
+		inline SkillPrototype * Get() const
+		{
+			return obj_;
+		}
+
+		inline CRPGStats_Object * GetStats() const
+		{
+			return stats_;
+		}
+
+		inline std::optional<int> GetLevel() const
+		{
+			return level_;
+		}
+
 		int Index(lua_State * L);
 
 	private:
@@ -87,19 +142,6 @@ namespace dse::lua
 	};
 
 
-	class ItemOrCharacterPushPin
-	{
-	public:
-		ItemOrCharacterPushPin(lua_State * L, CRPGStats_Object * obj);
-		~ItemOrCharacterPushPin();
-
-	private:
-		ObjectProxy<CDivinityStats_Character> * character_{ nullptr };
-		ObjectProxy<CDivinityStats_Item> * item_{ nullptr };
-		StatsProxy * object_{ nullptr };
-	};
-
-
 	class StatsExtraDataProxy : public Userdata<StatsExtraDataProxy>, public Indexable, public Pushable<PushPolicy::None>
 	{
 	public:
@@ -121,6 +163,11 @@ namespace dse::lua
 			return damages_;
 		}
 
+		inline void Rebind()
+		{
+			damages_.Clear();
+		}
+
 	private:
 		DamagePairList damages_;
 
@@ -135,6 +182,32 @@ namespace dse::lua
 	};
 
 
+	// Reusable argument objects for engine callbacks
+	struct CallbackArgumentPools
+	{
+		UserdataPool<ObjectProxy<CDivinityStats_Character>> CharacterStats;
+		UserdataPool<ObjectProxy<CDivinityStats_Item>> ItemStats;
+		UserdataPool<StatsProxy> Stats;
+		UserdataPool<SkillPrototypeProxy> SkillPrototypes;
+		UserdataPool<DamageList> DamageLists;
+		TablePool Tables;
+
+		void Clear();
+	};
+
+
+	class ItemOrCharacterPushPin
+	{
+	public:
+		ItemOrCharacterPushPin(lua_State * L, CallbackArgumentPools & pools, CRPGStats_Object * obj);
+
+	private:
+		PooledPin<UserdataPool<ObjectProxy<CDivinityStats_Character>>> character_;
+		PooledPin<UserdataPool<ObjectProxy<CDivinityStats_Item>>> item_;
+		PooledPin<UserdataPool<StatsProxy>> object_;
+	};
+
+
 	class ExtensionLibrary
 	{
 	public:
@@ -145,6 +218,39 @@ namespace dse::lua
 		static int Include(lua_State * L);
 	};
 
+	// Engine callbacks that are only forwarded to Lua when a listener is registered for them
+	enum class EngineEvent : uint32_t
+	{
+		GetHitChance,
+		GetSkillDamage,
+		ComputeCharacterHit,
+		CalculateTurnOrder,
+		StatusGetEnterChance,
+		SkillGetDescriptionParam,
+		StatusGetDescriptionParam,
+		Count
+	};
+
+	// Internal Ext.* functions that are called from native code
+	enum class ExtCallback : uint32_t
+	{
+		LoadBootstrap,
+		NetMessageReceived,
+		OnGameSessionLoading,
+		OnGameSessionLoaded,
+		OnModuleLoading,
+		OnModuleResume,
+		GetHitChance,
+		GetSkillDamage,
+		ComputeCharacterHit,
+		CalculateTurnOrder,
+		StatusGetEnterChance,
+		UICall,
+		SkillGetDescriptionParam,
+		StatusGetDescriptionParam,
+		Count
+	};
+
 	class Exception : public std::exception
 	{
 	public:
@@ -173,6 +279,30 @@ namespace dse::lua
 			RestrictAll = 0x0000ffff,
 		};
 
+		struct GCParameters
+		{
+			// Lua collector pause and step multiplier (see lua_gc())
+			int Pause{ 200 };
+			int StepMultiplier{ 200 };
+			// Maximum time spent collecting garbage at each idle point
+			std::chrono::microseconds IdleStepBudget{ 2000 };
+		};
+
+		struct GCStats
+		{
+			uint64_t IdleSlices{ 0 };
+			uint64_t TickSlices{ 0 };
+			uint64_t IdleSteps{ 0 };
+			uint64_t CompletedCycles{ 0 };
+			std::chrono::nanoseconds IdleTime{ 0 };
+			std::chrono::nanoseconds MaxIdleSliceTime{ 0 };
+			// Memory released outside of idle slices; this is mostly released by collector steps that Lua
+			// triggered during allocations, but also includes memory Lua frees on its own (eg. table resizes)
+			uint64_t NonIdleFrees{ 0 };
+			uint64_t NonIdleFreedBytes{ 0 };
+			uint64_t IdleFreedBytes{ 0 };
+		};
+
 		uint32_t RestrictionFlags{ 0 };
 		std::unordered_set<int32_t> OverriddenLevelMaps;
 
@@ -189,6 +319,9 @@ namespace dse::lua
 			return L;
 		}
 
+		// Returns the state that owns the Lua state or thread
+		static State * FromLua(lua_State * L);
+
 		inline bool StartupDone() const
 		{
 			return startupDone_;
@@ -199,21 +332,77 @@ namespace dse::lua
 			return mutex_;
 		}
 
+		inline CallbackArgumentPools & GetCallbackPools()
+		{
+			return callbackPools_;
+		}
+
+		inline Profiler & GetProfiler()
+		{
+			return profiler_;
+		}
+
+		inline TaskScheduler & GetTaskScheduler()
+		{
+			return taskScheduler_;
+		}
+
+		inline WorkerPool & GetWorkerPool()
+		{
+			return workerPool_;
+		}
+
+		inline PoolAllocator const & GetAllocator() const
+		{
+			return allocator_;
+		}
+
+		inline bool HasListeners(EngineEvent event) const
+		{
+			return (engineListeners_ & (1u << (uint32_t)event)) != 0;
+		}
+
+		inline GCParameters const & GetGCParameters() const
+		{
+			return gcParams_;
+		}
+
+		inline GCStats const & GetGCStats() const
+		{
+			return gcStats_;
+		}
+
 		void FinishStartup();
+		void OnListenerRegistered(char const * event);
+		void SetGCParameters(GCParameters const & params);
+		// Runs incremental GC steps until the idle budget is used up or the current cycle completes.
+		// On per-tick calls, steps are only taken once the heap has grown halfway to the point where
+		// the allocation-driven collector would start the next cycle.
+		// Does nothing if another thread is using the state.
+		void RunIdleGC(bool perTick = false);
+		// Resumes scheduled tasks until the configured per-tick budget is used up.
+		// Does nothing if another thread is using the state.
+		void RunScheduledTasks();
+		// Calls the completion callbacks of worker jobs that finished since the last call
+		void ProcessCompletedJobs();
 		void LoadBootstrap(STDString const& path, STDString const& modTable);
 		virtual void OnGameSessionLoading();
 		void OnGameSessionLoaded();
 		void OnModuleLoading();
 		void OnModuleResume();
 
+		// Pushes an internal Ext callback function (or nil if it doesn't exist) to the stack
+		void PushExtCallback(ExtCallback callback);
+		static char const * GetExtCallbackName(ExtCallback callback);
+
 		template <class... Ret, class... Args>
-		auto CallExt(char const * func, uint32_t restrictions, ReturnType<Ret...>, Args... args)
+		auto CallExt(ExtCallback callback, uint32_t restrictions, ReturnType<Ret...>, Args... args)
 		{
 			std::lock_guard lock(mutex_);
 			Restriction restriction(*this, restrictions);
-			PushExtFunction(L, func);
+			PushExtCallback(callback);
 			auto _{ PushArguments(L, std::tuple{args...}) };
-			return CheckedCall<Ret...>(L, sizeof...(args), func);
+			return CheckedCall<Ret...>(L, sizeof...(args), GetExtCallbackName(callback));
 		}
 
 		std::optional<int> LoadScript(STDString const & script, STDString const & name = "");
@@ -228,8 +417,30 @@ namespace dse::lua
 		lua_State * L;
 		std::recursive_mutex mutex_;
 		bool startupDone_{ false };
+		CallbackArgumentPools callbackPools_;
+		// Bitmask of EngineEvent values that have at least one listener
+		uint32_t engineListeners_{ 0 };
+		Profiler profiler_;
+		TaskScheduler taskScheduler_;
+		WorkerPool workerPool_;
+		PoolAllocator allocator_;
+		GCParameters gcParams_;
+		GCStats gcStats_;
+		// Heap size (KB) after the last completed collection cycle
+		int gcBaseKB_{ 0 };
+		bool inIdleGC_{ false };
+		bool closing_{ false };
+		// Registry references to the internal Ext callbacks
+		int extCallbackRefs_[(uint32_t)ExtCallback::Count];
+
+		static void * LuaAlloc(void * ud, void * ptr, size_t osize, size_t nsize);
+		static int GCSentinelFinalizer(lua_State * L);
+		void CreateGCSentinel();
 
 		void OpenLibs();
+		// Looks up the internal Ext callbacks once the builtin libraries are loaded,
+		// so engine hooks don't need to do a name lookup on each call
+		void ResolveExtCallbacks();
 
 		static STDString GetBuiltinLibrary(int resourceId);
 	};
@@ -2,6 +2,10 @@
 
 #include <Lua/LuaBinding.h>
 
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+
 namespace dse
 {
 	struct InvokeDataValue;
@@ -50,6 +54,66 @@ namespace dse::lua
 	};
 
 
+	// Caches the results of the SkillGetDescriptionParam/StatusGetDescriptionParam listeners.
+	// The game formats tooltips every frame while they're visible, so the same parameters are
+	// requested repeatedly with the same inputs. Entries are keyed on the prototype, the
+	// characters involved, a fingerprint of their stats and the parameter texts, so stat, level
+	// or equipment changes produce a new key. The cache is cleared when stats are modified by the
+	// extender or a level is loaded; entries also expire after MaxAge as a backstop for changes
+	// that are not covered by either.
+	class DescriptionParamCache
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+		static constexpr std::size_t MaxEntries = 1024;
+		static constexpr Clock::duration MaxAge = std::chrono::seconds(1);
+
+		struct Stats
+		{
+			uint64_t Hits{ 0 };
+			uint64_t Misses{ 0 };
+			// Number of times the cache was emptied because it was full
+			uint64_t Flushes{ 0 };
+		};
+
+		static STDString MakeKey(void const * prototype, CDivinityStats_Character * source,
+			CDivinityStats_Character * target, ObjectSet<STDString> const & paramTexts);
+		// Returns nullptr on a miss; a cached nullopt means that the listener returned nil
+		std::optional<STDWString> const * Find(STDString const & key);
+		void Add(STDString && key, std::optional<STDWString> const & value);
+		void Clear();
+		// Clears every cache on its next use; stats can be changed from the server thread,
+		// so the caches are not cleared directly
+		static void InvalidateAll();
+
+		inline Stats const & GetStats() const
+		{
+			return stats_;
+		}
+
+		inline std::size_t Size() const
+		{
+			return entries_.size();
+		}
+
+	private:
+		struct Entry
+		{
+			std::optional<STDWString> Value;
+			Clock::time_point Created;
+		};
+
+		std::unordered_map<STDString, Entry> entries_;
+		Stats stats_;
+		// Value of generation_ when the cache was last cleared
+		uint32_t clearedGeneration_{ 0 };
+		static std::atomic<uint32_t> generation_;
+
+		static uint64_t GetCharacterRevision(CDivinityStats_Character * character);
+		void ClearIfInvalidated();
+	};
+
+
 	class ClientState : public State
 	{
 	public:
@@ -65,8 +129,20 @@ namespace dse::lua
 		void OnClientUIObjectCreated(char const * name, ObjectHandle handle);
 		UIObject * GetUIObject(char const * name);
 
+		inline DescriptionParamCache & GetDescriptionParamCache()
+		{
+			return descriptionParamCache_;
+		}
+
 	private:
 		ExtensionLibraryClient library_;
 		std::unordered_map<STDString, ObjectHandle> clientUI_;
+		DescriptionParamCache descriptionParamCache_;
+
+		std::optional<STDWString> CallSkillGetDescriptionParam(CRPGStats_Object * skill,
+			CDivinityStats_Character * character, ObjectSet<STDString> const & paramTexts);
+		std::optional<STDWString> CallStatusGetDescriptionParam(CRPGStats_Object * status,
+			CDivinityStats_Character * statusSource, CDivinityStats_Character * character,
+			ObjectSet<STDString> const & paramTexts);
 	};
 }
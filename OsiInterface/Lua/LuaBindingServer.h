@@ -10,8 +10,12 @@
 
 namespace dse::lua
 {
-	void LuaToOsi(lua_State * L, int i, TypedValue & tv, ValueType osiType, bool allowNil = false);
-	TypedValue * LuaToOsi(lua_State * L, int i, ValueType osiType, bool allowNil = false);
+	class OsiScratchArena;
+
+	// String values are copied to the arena if one is passed, as the TypedValue may outlive the Lua stack slot.
+	// Without an arena, strings are interned in the OsiStringPool; use this for values
+	// that Osiris may retain after the call (eg. DB inserts).
+	void LuaToOsi(lua_State * L, int i, TypedValue & tv, ValueType osiType, OsiScratchArena * arena, bool allowNil = false);
 	void LuaToOsi(lua_State * L, int i, OsiArgumentValue & arg, ValueType osiType, bool allowNil = false);
 	void OsiToLua(lua_State * L, OsiArgumentValue const & arg);
 	void OsiToLua(lua_State * L, TypedValue const & tv);
@@ -54,9 +58,6 @@ namespace dse::lua
 	{
 	public:
 		static char const * const MetatableName;
-		// Maximum number of OUT params that a query can return.
-		// (This setting determines how many function arities we'll check during name lookup)
-		static constexpr uint32_t MaxQueryOutParams = 6;
 
 		static void PopulateMetatable(lua_State * L);
 
@@ -76,7 +77,6 @@ namespace dse::lua
 		bool BeforeCall(lua_State * L);
 		OsiFunction * TryGetFunction(uint32_t arity);
 		OsiFunction * CreateFunctionMapping(uint32_t arity, Function const * func);
-		Function const * LookupOsiFunction(uint32_t arity);
 	};
 
 
@@ -139,6 +139,11 @@ namespace dse::lua
 			: combatId_(combatId)
 		{}
 
+		inline void Rebind(uint8_t combatId)
+		{
+			combatId_ = combatId;
+		}
+
 		inline esv::TurnManager::Combat * Get()
 		{
 			return GetTurnManager()->Combats.Find(combatId_);
@@ -212,84 +217,87 @@ namespace dse::lua
 		static int NewEvent(lua_State * L);
 	};
 
-	inline void OsiReleaseArgument(OsiArgumentDesc & arg)
-	{
-		arg.NextParam = nullptr;
-	}
-
-	inline void OsiReleaseArgument(TypedValue & arg) {}
-	inline void OsiReleaseArgument(ListNode<TypedValue *> & arg) {}
-	inline void OsiReleaseArgument(ListNode<TupleLL::Item> & arg) {}
-
-	template <class T>
-	class OsiArgumentPool
+	// Segmented bump allocator for the temporary arguments of Lua -> Osiris calls.
+	// Memory is released in bulk when the OsiScratchScope that allocated it unwinds;
+	// segments are kept for reuse, so steady-state calls don't allocate.
+	class OsiScratchArena : public Noncopyable<OsiScratchArena>
 	{
 	public:
-		OsiArgumentPool()
-		{
-			argumentPool_.resize(1024);
-			usedArguments_ = 0;
-		}
+		static constexpr std::size_t SegmentSize = 0x10000;
 
-		T * AllocateArguments(uint32_t num, uint32_t & tail)
+		struct Marker
 		{
-			if (usedArguments_ + num > argumentPool_.size()) {
-				throw std::runtime_error("Ran out of argument descriptors");
-			}
+			std::size_t Segment;
+			std::size_t Offset;
+		};
 
-			tail = usedArguments_;
-			auto ptr = argumentPool_.data() + usedArguments_;
+		void * Allocate(std::size_t size, std::size_t alignment);
+		char * CopyString(char const * str, std::size_t length);
+
+		template <class T>
+		T * AllocateArray(uint32_t num)
+		{
+			auto ptr = reinterpret_cast<T *>(Allocate(sizeof(T) * num, alignof(T)));
 			for (uint32_t i = 0; i < num; i++) {
 				new (ptr + i) T();
 			}
 
-			usedArguments_ += num;
 			return ptr;
 		}
 
-		void ReleaseArguments(uint32_t tail, uint32_t num)
+		inline Marker GetMarker() const
 		{
-			if (tail + num != usedArguments_) {
-				throw std::runtime_error("Attempted to release arguments out of order");
-			}
-
-			for (uint32_t i = 0; i < num; i++) {
-				OsiReleaseArgument(argumentPool_[tail + i]);
-			}
+			return Marker{ currentSegment_, offset_ };
+		}
 
-			usedArguments_ -= num;
+		inline void Release(Marker const & marker)
+		{
+			currentSegment_ = marker.Segment;
+			offset_ = marker.Offset;
 		}
 
 	private:
-		std::vector<T> argumentPool_;
-		uint32_t usedArguments_;
+		struct Segment
+		{
+			std::unique_ptr<uint8_t[]> Data;
+			std::size_t Size;
+		};
+
+		std::vector<Segment> segments_;
+		std::size_t currentSegment_{ 0 };
+		std::size_t offset_{ 0 };
 	};
 
-	template <class T>
-	class OsiArgumentListPin
+	// Strings of values inserted into Osiris databases.
+	// It's not known whether Osiris copies the string of an inserted TypedValue or keeps the pointer,
+	// so the strings are kept until Osiris deletes all of its data (story reload or unload).
+	// Each distinct string is only stored once.
+	class OsiStringPool : public Noncopyable<OsiStringPool>
 	{
 	public:
-		inline OsiArgumentListPin(OsiArgumentPool<T> & pool, uint32_t numArgs)
-			: pool_(pool), numArgs_(numArgs)
-		{
-			args_ = pool.AllocateArguments(numArgs_, tail_);
-		}
+		char const * Intern(char const * str, std::size_t length);
+		void Clear();
 
-		inline ~OsiArgumentListPin()
-		{
-			pool_.ReleaseArguments(tail_, numArgs_);
-		}
+	private:
+		std::mutex mutex_;
+		std::unordered_set<STDString> strings_;
+	};
+
+	class OsiScratchScope : public Noncopyable<OsiScratchScope>
+	{
+	public:
+		inline OsiScratchScope(OsiScratchArena & arena)
+			: arena_(arena), marker_(arena.GetMarker())
+		{}
 
-		inline T * Args() const
+		inline ~OsiScratchScope()
 		{
-			return args_;
+			arena_.Release(marker_);
 		}
 
 	private:
-		OsiArgumentPool<T> & pool_;
-		uint32_t numArgs_;
-		uint32_t tail_;
-		T * args_;
+		OsiScratchArena & arena_;
+		OsiScratchArena::Marker marker_;
 	};
 
 
@@ -314,24 +322,9 @@ namespace dse::lua
 			return identityAdapters_;
 		}
 
-		inline OsiArgumentPool<OsiArgumentDesc> & GetArgumentDescPool()
-		{
-			return argDescPool_;
-		}
-
-		inline OsiArgumentPool<TypedValue> & GetTypedValuePool()
-		{
-			return tvPool_;
-		}
-
-		inline OsiArgumentPool<ListNode<TypedValue *>> & GetTypedValueNodePool()
-		{
-			return tvNodePool_;
-		}
-
-		inline OsiArgumentPool<ListNode<TupleLL::Item>> & GetTupleNodePool()
+		inline OsiScratchArena & GetOsiScratchArena()
 		{
-			return tupleNodePool_;
+			return osiScratchArena_;
 		}
 
 		void OnGameSessionLoading() override;
@@ -383,11 +376,10 @@ namespace dse::lua
 
 	private:
 		ExtensionLibraryServer library_;
-		OsiArgumentPool<OsiArgumentDesc> argDescPool_;
-		OsiArgumentPool<TypedValue> tvPool_;
-		OsiArgumentPool<ListNode<TypedValue *>> tvNodePool_;
-		OsiArgumentPool<ListNode<TupleLL::Item>> tupleNodePool_;
+		OsiScratchArena osiScratchArena_;
 		IdentityAdapterMap identityAdapters_;
+		UserdataPool<ObjectProxy<esv::Status>> statusPool_;
+		UserdataPool<TurnManagerCombatProxy> combatPool_;
 		// ID of current story instance.
 		// Used to invalidate function/node pointers in Lua userdata objects
 		uint32_t generationId_{ 0 };
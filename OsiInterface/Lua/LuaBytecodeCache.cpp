@@ -0,0 +1,301 @@
+#include <stdafx.h>
+#include <Lua/LuaBytecodeCache.h>
+#include <OsirisProxy.h>
+#include <Version.h>
+
+#include <bcrypt.h>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+
+namespace dse::lua
+{
+	static constexpr uint32_t BytecodeCacheMagic = 0x42435344; // "DSCB"
+	static constexpr uint32_t BytecodeCacheFormatVersion = 2;
+	// Entries that weren't used for this long are deleted
+	static constexpr uint64_t BytecodeCacheMaxEntryAgeDays = 30;
+	// Oldest entries are deleted when the cache grows larger than this
+	static constexpr uint64_t BytecodeCacheMaxSize = 64 * 1024 * 1024;
+
+	using Sha256Digest = std::array<uint8_t, 32>;
+
+	struct BytecodeCacheHeader
+	{
+		uint32_t Magic;
+		uint32_t FormatVersion;
+		uint32_t ExtenderVersion;
+		uint32_t LuaVersion;
+		uint64_t ScriptSize;
+		Sha256Digest ScriptHash;
+	};
+
+	// Describes the bytecode that follows the header. The Lua undumper doesn't validate
+	// bytecode, so truncated or corrupted chunks must never reach luaL_loadbufferx().
+	struct BytecodeCachePayloadHeader
+	{
+		uint64_t BytecodeSize;
+		Sha256Digest BytecodeHash;
+	};
+
+	static bool Sha256(void const * data, std::size_t size, Sha256Digest & digest)
+	{
+		BCRYPT_ALG_HANDLE algorithm{ NULL };
+		BCRYPT_HASH_HANDLE hash{ NULL };
+		bool ok = BCRYPT_SUCCESS(BCryptOpenAlgorithmProvider(&algorithm, BCRYPT_SHA256_ALGORITHM, NULL, 0))
+			&& BCRYPT_SUCCESS(BCryptCreateHash(algorithm, &hash, NULL, 0, NULL, 0, 0))
+			&& BCRYPT_SUCCESS(BCryptHashData(hash, (PUCHAR)data, (ULONG)size, 0))
+			&& BCRYPT_SUCCESS(BCryptFinishHash(hash, digest.data(), (ULONG)digest.size(), 0));
+
+		if (hash != NULL) BCryptDestroyHash(hash);
+		if (algorithm != NULL) BCryptCloseAlgorithmProvider(algorithm, 0);
+		return ok;
+	}
+
+	static uint64_t HashBytes(uint64_t hash, void const * data, std::size_t size)
+	{
+		// 64-bit FNV-1a
+		auto bytes = reinterpret_cast<uint8_t const *>(data);
+		for (std::size_t i = 0; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= 0x100000001b3ull;
+		}
+
+		return hash;
+	}
+
+	static uint64_t FileTimeToUInt64(FILETIME const & time)
+	{
+		return ((uint64_t)time.dwHighDateTime << 32) | time.dwLowDateTime;
+	}
+
+	// Deletes stale entries and leftover temporary files, and trims the cache to BytecodeCacheMaxSize.
+	// Entries are touched whenever they're loaded, so their write time is the time of their last use.
+	static void PruneCacheDirectory(STDString const & dir)
+	{
+		struct CacheFile
+		{
+			std::wstring Path;
+			uint64_t Size;
+			uint64_t LastUsed;
+		};
+
+		FILETIME nowFt;
+		GetSystemTimeAsFileTime(&nowFt);
+		auto now = FileTimeToUInt64(nowFt);
+		// FILETIME is in 100ns units
+		auto maxAge = BytecodeCacheMaxEntryAgeDays * 24 * 3600 * 10000000ull;
+
+		auto wideDir = FromUTF8(dir);
+		std::vector<CacheFile> files;
+		uint64_t totalSize{ 0 };
+
+		WIN32_FIND_DATAW findData;
+		auto findHandle = FindFirstFileW((wideDir + L"/*").c_str(), &findData);
+		if (findHandle == INVALID_HANDLE_VALUE) {
+			return;
+		}
+
+		do {
+			if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+
+			std::wstring fileName = findData.cFileName;
+			auto path = wideDir + L"/" + fileName;
+			auto lastUsed = FileTimeToUInt64(findData.ftLastWriteTime);
+			auto size = ((uint64_t)findData.nFileSizeHigh << 32) | findData.nFileSizeLow;
+			bool isEntry = fileName.size() > 5 && fileName.compare(fileName.size() - 5, 5, L".luac") == 0;
+
+			// Temporary files are only left behind if the game crashed while saving an entry
+			if (!isEntry || now - lastUsed > maxAge) {
+				DeleteFileW(path.c_str());
+			} else {
+				files.push_back(CacheFile{ path, size, lastUsed });
+				totalSize += size;
+			}
+		} while (FindNextFileW(findHandle, &findData));
+
+		FindClose(findHandle);
+
+		if (totalSize > BytecodeCacheMaxSize) {
+			std::sort(files.begin(), files.end(), [](CacheFile const & a, CacheFile const & b) {
+				return a.LastUsed < b.LastUsed;
+			});
+
+			for (auto const & file : files) {
+				if (totalSize <= BytecodeCacheMaxSize) break;
+				if (DeleteFileW(file.Path.c_str())) {
+					totalSize -= file.Size;
+				}
+			}
+		}
+	}
+
+	static void TouchCacheFile(STDString const & path)
+	{
+		auto handle = CreateFileW(FromUTF8(path).c_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (handle == INVALID_HANDLE_VALUE) {
+			return;
+		}
+
+		FILETIME now;
+		GetSystemTimeAsFileTime(&now);
+		SetFileTime(handle, NULL, NULL, &now);
+		CloseHandle(handle);
+	}
+
+	static std::optional<STDString> GetCacheDirectory()
+	{
+		auto storageRoot = GetStaticSymbols().ToPath("/Osiris Data", PathRootType::GameStorage);
+		if (storageRoot.empty()) {
+			return {};
+		}
+
+		auto dir = storageRoot + "/LuaBytecodeCache";
+		CreateDirectory(FromUTF8(storageRoot).c_str(), NULL);
+		if (CreateDirectory(FromUTF8(dir).c_str(), NULL) == FALSE && GetLastError() != ERROR_ALREADY_EXISTS) {
+			OsiError("Could not create Lua bytecode cache directory: " << dir);
+			return {};
+		}
+
+		static std::once_flag pruned;
+		std::call_once(pruned, [&dir]() {
+			PruneCacheDirectory(dir);
+		});
+
+		return dir;
+	}
+
+	static int BytecodeWriter(lua_State * L, void const * p, size_t sz, void * ud)
+	{
+		auto buf = reinterpret_cast<STDString *>(ud);
+		buf->append(reinterpret_cast<char const *>(p), sz);
+		return 0;
+	}
+
+	static bool LoadFromCache(lua_State * L, STDString const & path, BytecodeCacheHeader const & expectedHeader,
+		STDString const & name)
+	{
+		std::ifstream f(path.c_str(), std::ios::in | std::ios::binary);
+		if (!f.good()) {
+			return false;
+		}
+
+		f.seekg(0, std::ios::end);
+		auto size = (std::size_t)f.tellg();
+		f.seekg(0, std::ios::beg);
+		if (size <= sizeof(BytecodeCacheHeader) + sizeof(BytecodeCachePayloadHeader)) {
+			return false;
+		}
+
+		BytecodeCacheHeader header;
+		f.read(reinterpret_cast<char *>(&header), sizeof(header));
+		if (!f.good() || memcmp(&header, &expectedHeader, sizeof(header)) != 0) {
+			return false;
+		}
+
+		BytecodeCachePayloadHeader payloadHeader;
+		f.read(reinterpret_cast<char *>(&payloadHeader), sizeof(payloadHeader));
+		if (!f.good() || payloadHeader.BytecodeSize != size - sizeof(header) - sizeof(payloadHeader)) {
+			return false;
+		}
+
+		STDString bytecode;
+		bytecode.resize(payloadHeader.BytecodeSize);
+		f.read(bytecode.data(), bytecode.size());
+		if (!f.good()) {
+			return false;
+		}
+
+		Sha256Digest bytecodeHash;
+		if (!Sha256(bytecode.data(), bytecode.size(), bytecodeHash) || bytecodeHash != payloadHeader.BytecodeHash) {
+			WARN("Discarding corrupted bytecode cache entry for '%s'", name.c_str());
+			return false;
+		}
+
+		if (luaL_loadbufferx(L, bytecode.c_str(), bytecode.size(), name.c_str(), "b") != LUA_OK) {
+			WARN("Discarding invalid bytecode cache entry for '%s': %s", name.c_str(), lua_tostring(L, -1));
+			lua_pop(L, 1);
+			return false;
+		}
+
+		TouchCacheFile(path);
+		return true;
+	}
+
+	static void SaveToCache(lua_State * L, STDString const & path, BytecodeCacheHeader const & header)
+	{
+		STDString bytecode;
+		// Keep debug info so error messages and tracebacks still have line numbers
+		if (lua_dump(L, &BytecodeWriter, &bytecode, 0) != 0) {
+			return;
+		}
+
+		BytecodeCachePayloadHeader payloadHeader;
+		payloadHeader.BytecodeSize = bytecode.size();
+		if (!Sha256(bytecode.data(), bytecode.size(), payloadHeader.BytecodeHash)) {
+			return;
+		}
+
+		// Write to a temporary file first, as the client and server may be compiling the same script concurrently
+		std::stringstream tempPath;
+		tempPath << path << "." << GetCurrentThreadId() << ".tmp";
+		auto tempPathStr = tempPath.str();
+
+		{
+			std::ofstream f(tempPathStr.c_str(), std::ios::out | std::ios::binary);
+			if (!f.good()) {
+				return;
+			}
+
+			f.write(reinterpret_cast<char const *>(&header), sizeof(header));
+			f.write(reinterpret_cast<char const *>(&payloadHeader), sizeof(payloadHeader));
+			f.write(bytecode.data(), bytecode.size());
+			if (!f.good()) {
+				f.close();
+				DeleteFileW(FromUTF8(tempPathStr.c_str()).c_str());
+				return;
+			}
+		}
+
+		if (MoveFileExW(FromUTF8(tempPathStr.c_str()).c_str(), FromUTF8(path).c_str(), MOVEFILE_REPLACE_EXISTING) == FALSE) {
+			DeleteFileW(FromUTF8(tempPathStr.c_str()).c_str());
+		}
+	}
+
+	int LoadBufferCached(lua_State * L, STDString const & script, STDString const & name)
+	{
+		auto cacheDir = GetCacheDirectory();
+		if (!cacheDir) {
+			return luaL_loadbufferx(L, script.c_str(), script.size(), name.c_str(), "text");
+		}
+
+		BytecodeCacheHeader header;
+		header.Magic = BytecodeCacheMagic;
+		header.FormatVersion = BytecodeCacheFormatVersion;
+		header.ExtenderVersion = CurrentVersion;
+		header.LuaVersion = LUA_VERSION_NUM;
+		header.ScriptSize = script.size();
+		if (!Sha256(script.data(), script.size(), header.ScriptHash)) {
+			return luaL_loadbufferx(L, script.c_str(), script.size(), name.c_str(), "text");
+		}
+
+		// The chunk name is embedded in the bytecode, so it's part of the cache key
+		auto key = HashBytes(0xcbf29ce484222325ull, header.ScriptHash.data(), header.ScriptHash.size());
+		key = HashBytes(key, name.data(), name.size());
+		std::stringstream path;
+		path << *cacheDir << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".luac";
+		STDString cachePath = path.str().c_str();
+
+		if (LoadFromCache(L, cachePath, header, name)) {
+			return LUA_OK;
+		}
+
+		int status = luaL_loadbufferx(L, script.c_str(), script.size(), name.c_str(), "text");
+		if (status == LUA_OK) {
+			SaveToCache(L, cachePath, header);
+		}
+
+		return status;
+	}
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <GameDefinitions/BaseTypes.h>
+#include <Lua/LuaHelpers.h>
+
+namespace dse::lua
+{
+	// Compiles a Lua script, reusing the bytecode cached in "Osiris Data/LuaBytecodeCache" when available.
+	// Cache entries are keyed by the script contents, chunk name, Lua version and extender version,
+	// and the bytecode is checked against its SHA-256 hash before it's loaded. Entries not used for
+	// 30 days are deleted, and the cache is trimmed to 64 MB on the first load.
+	// Same return value and stack effect as luaL_loadbufferx().
+	int LoadBufferCached(lua_State * L, STDString const & script, STDString const & name);
+}
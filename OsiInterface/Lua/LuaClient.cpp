@@ -21,6 +21,8 @@ namespace dse::lua
 	int LoadFile(lua_State* L);
 	int JsonParse(lua_State * L);
 	int JsonStringify(lua_State * L);
+	int Serialize(lua_State * L);
+	int Deserialize(lua_State * L);
 	int IsModLoaded(lua_State* L);
 	int GetModLoadOrder(lua_State* L);
 	int GetModInfo(lua_State* L);
@@ -29,6 +31,8 @@ namespace dse::lua
 	int GetEquipmentSet(lua_State * L);
 	int StatGetAttribute(lua_State * L);
 	int StatSetAttribute(lua_State * L);
+	int GetStatAttributeHandle(lua_State * L);
+	int StatApplyPatch(lua_State * L);
 	int StatAddCustomDescription(lua_State * L);
 	int StatSetLevelScaling(lua_State * L);
 	int GetStat(lua_State * L);
@@ -39,24 +43,51 @@ namespace dse::lua
 	int LuaRandom(lua_State * L);
 	int LuaRound(lua_State * L);
 	int AddVoiceMetaData(lua_State * L);
+	int OnListenerAdded(lua_State * L);
+	int StartProfiler(lua_State * L);
+	int StopProfiler(lua_State * L);
+	int GetProfilerReport(lua_State * L);
+	int GetMemoryStats(lua_State * L);
+	int SetGCParameters(lua_State * L);
+	int GetGCStats(lua_State * L);
+	int Schedule(lua_State * L);
+	int CancelTask(lua_State * L);
+	int GetTaskStats(lua_State * L);
+	int AddWorkerScript(lua_State * L);
+	int SubmitJob(lua_State * L);
+	int GetNetStats(lua_State * L);
+
+
+	int SubscribeNetChannel(lua_State * L)
+	{
+		size_t length;
+		auto channel = luaL_checklstring(L, 1, &length);
+		gOsirisProxy->GetNetworkManager().ClientSubscribe(std::string_view(channel, length));
+		return 0;
+	}
 
+	int GetDescriptionParamCacheStats(lua_State * L)
+	{
+		LuaClientPin lua(ExtensionStateClient::Get());
+		auto const & cache = lua->GetDescriptionParamCache();
+		auto const & stats = cache.GetStats();
+
+		lua_newtable(L); // stack: stats
+		settable(L, "Hits", stats.Hits);
+		settable(L, "Misses", stats.Misses);
+		settable(L, "Flushes", stats.Flushes);
+		settable(L, "Entries", (uint64_t)cache.Size());
+		return 1;
+	}
 
 	int PostMessageToServer(lua_State * L)
 	{
 		auto channel = luaL_checkstring(L, 1);
-		auto payload = luaL_checkstring(L, 2);
+		size_t payloadLength;
+		auto payload = luaL_checklstring(L, 2, &payloadLength);
 
 		auto & networkMgr = gOsirisProxy->GetNetworkManager();
-		auto msg = networkMgr.GetFreeClientMessage();
-		if (msg != nullptr) {
-			auto postMsg = msg->GetMessage().mutable_post_lua();
-			postMsg->set_channel_name(channel);
-			postMsg->set_payload(payload);
-			networkMgr.ClientSend(msg);
-		} else {
-			OsiErrorS("Could not get free message!");
-		}
-
+		networkMgr.ClientPostLuaMessage(channel, std::string_view(payload, payloadLength));
 		return 0;
 	}
 
@@ -592,6 +623,8 @@ namespace dse::lua
 
 			{"JsonParse", JsonParse},
 			{"JsonStringify", JsonStringify},
+			{"Serialize", Serialize},
+			{"Deserialize", Deserialize},
 
 			{"IsModLoaded", IsModLoaded},
 			{"GetModLoadOrder", GetModLoadOrder},
@@ -602,6 +635,8 @@ namespace dse::lua
 			{"GetEquipmentSet", GetEquipmentSet},
 			{"StatGetAttribute", StatGetAttribute},
 			{"StatSetAttribute", StatSetAttribute},
+			{"StatAttributeHandle", GetStatAttributeHandle},
+			{"StatApplyPatch", StatApplyPatch},
 			{"StatAddCustomDescription", StatAddCustomDescription},
 			{"StatSetLevelScaling", StatSetLevelScaling},
 			{"GetStat", GetStat},
@@ -611,11 +646,28 @@ namespace dse::lua
 			{"IsDeveloperMode", IsDeveloperMode},
 			{"Random", LuaRandom},
 			{"Round", LuaRound},
+			{"_OnListenerAdded", OnListenerAdded},
 
 			{"AddPathOverride", AddPathOverride},
 			{"AddVoiceMetaData", AddVoiceMetaData},
 
+			{"StartProfiler", StartProfiler},
+			{"StopProfiler", StopProfiler},
+			{"GetProfilerReport", GetProfilerReport},
+			{"GetMemoryStats", GetMemoryStats},
+			{"SetGCParameters", SetGCParameters},
+			{"GetGCStats", GetGCStats},
+			{"Schedule", Schedule},
+			{"CancelTask", CancelTask},
+			{"GetTaskStats", GetTaskStats},
+			{"AddWorkerScript", AddWorkerScript},
+			{"SubmitJob", SubmitJob},
+			{"GetNetStats", GetNetStats},
+
+			{"GetDescriptionParamCacheStats", GetDescriptionParamCacheStats},
+
 			{"PostMessageToServer", PostMessageToServer},
+			{"_SubscribeNetChannel", SubscribeNetChannel},
 			{"CreateUI", CreateUI},
 			{"GetUI", GetUI},
 			{"GetBuiltinUI", GetBuiltinUI},
@@ -648,6 +700,7 @@ namespace dse::lua
 		// Ext is not writeable after loading SandboxStartup!
 		auto sandbox = GetBuiltinLibrary(IDR_LUA_SANDBOX_STARTUP);
 		LoadScript(sandbox, "SandboxStartup.lua");
+		ResolveExtCallbacks();
 	}
 
 	ClientState::~ClientState()
@@ -664,7 +717,7 @@ namespace dse::lua
 		std::lock_guard lock(mutex_);
 		Restriction restriction(*this, RestrictAll);
 
-		PushExtFunction(L, "_UICall"); // stack: fn
+		PushExtCallback(ExtCallback::UICall); // stack: fn
 
 		UIObjectProxy::New(L, uiObjectHandle);
 		push(L, func);
@@ -675,18 +728,136 @@ namespace dse::lua
 		CheckedCall<>(L, 2 + numArgs, "Ext.UICall");
 	}
 
+	STDString DescriptionParamCache::MakeKey(void const * prototype, CDivinityStats_Character * source,
+		CDivinityStats_Character * target, ObjectSet<STDString> const & paramTexts)
+	{
+		uint64_t const header[] = {
+			(uint64_t)prototype,
+			(uint64_t)source, GetCharacterRevision(source),
+			(uint64_t)target, GetCharacterRevision(target)
+		};
+
+		STDString key(reinterpret_cast<char const *>(header), sizeof(header));
+		for (uint32_t i = 0; i < paramTexts.Set.Size; i++) {
+			key += paramTexts[i];
+			key.push_back('\0');
+		}
+
+		return key;
+	}
+
+	uint64_t DescriptionParamCache::GetCharacterRevision(CDivinityStats_Character * character)
+	{
+		if (character == nullptr) return 0;
+
+		// 64-bit FNV-1a over the stats that tooltip calculations depend on
+		uint64_t hash = 0xcbf29ce484222325ull;
+		auto hashBytes = [&hash](void const * data, std::size_t size) {
+			auto bytes = reinterpret_cast<uint8_t const *>(data);
+			for (std::size_t i = 0; i < size; i++) {
+				hash ^= bytes[i];
+				hash *= 0x100000001b3ull;
+			}
+		};
+
+		hashBytes(&character->Level, sizeof(character->Level));
+		hashBytes(&character->Experience, sizeof(character->Experience));
+		hashBytes(&character->AttributeFlags, sizeof(character->AttributeFlags));
+		hashBytes(character->ActiveBoostConditions, sizeof(character->ActiveBoostConditions));
+
+		// Base stats, permanent boosts and item/status boosts are all stored as dynamic stats
+		for (auto stat = character->DynamicStats; stat < character->DynamicStatsEnd; stat++) {
+			if (*stat == nullptr) continue;
+			auto begin = reinterpret_cast<uint8_t const *>(&(*stat)->SummonLifelinkModifier);
+			auto end = reinterpret_cast<uint8_t const *>(&(*stat)->BoostConditionsMask + 1);
+			hashBytes(begin, end - begin);
+		}
+
+		for (auto item = character->ItemStats; item < character->ItemStatsEnd; item++) {
+			if (*item == nullptr) continue;
+			hashBytes(&(*item)->ItemStatsHandle, sizeof((*item)->ItemStatsHandle));
+			hashBytes(&(*item)->ItemSlot, sizeof((*item)->ItemSlot));
+			hashBytes(&(*item)->IsEquipped, sizeof((*item)->IsEquipped));
+		}
+
+		return hash;
+	}
+
+	std::atomic<uint32_t> DescriptionParamCache::generation_{ 0 };
+
+	void DescriptionParamCache::InvalidateAll()
+	{
+		generation_++;
+	}
+
+	void DescriptionParamCache::ClearIfInvalidated()
+	{
+		auto generation = generation_.load();
+		if (generation != clearedGeneration_) {
+			Clear();
+			clearedGeneration_ = generation;
+		}
+	}
+
+	std::optional<STDWString> const * DescriptionParamCache::Find(STDString const & key)
+	{
+		ClearIfInvalidated();
+		auto it = entries_.find(key);
+		if (it != entries_.end() && Clock::now() - it->second.Created < MaxAge) {
+			stats_.Hits++;
+			return &it->second.Value;
+		}
+
+		stats_.Misses++;
+		return nullptr;
+	}
+
+	void DescriptionParamCache::Add(STDString && key, std::optional<STDWString> const & value)
+	{
+		// The listener may have been called with stats that were changed since
+		ClearIfInvalidated();
+		if (entries_.size() >= MaxEntries) {
+			// Dropping everything is cheaper than tracking LRU order; visible tooltips
+			// repopulate the cache within a few frames
+			entries_.clear();
+			stats_.Flushes++;
+		}
+
+		entries_.insert_or_assign(std::move(key), Entry{ value, Clock::now() });
+	}
+
+	void DescriptionParamCache::Clear()
+	{
+		entries_.clear();
+	}
+
 	std::optional<STDWString> ClientState::SkillGetDescriptionParam(SkillPrototype * prototype,
 		CDivinityStats_Character * character, ObjectSet<STDString> const & paramTexts)
 	{
 		std::lock_guard lock(mutex_);
-		Restriction restriction(*this, RestrictAll);
 
 		auto skill = prototype->GetStats();
 		if (skill == nullptr) {
 			return {};
 		}
 
-		PushExtFunction(L, "_SkillGetDescriptionParam"); // stack: fn
+		auto cacheKey = DescriptionParamCache::MakeKey(prototype, character, nullptr, paramTexts);
+		auto cached = descriptionParamCache_.Find(cacheKey);
+		if (cached) {
+			return *cached;
+		}
+
+		auto description = CallSkillGetDescriptionParam(skill, character, paramTexts);
+		descriptionParamCache_.Add(std::move(cacheKey), description);
+		return description;
+	}
+
+	std::optional<STDWString> ClientState::CallSkillGetDescriptionParam(CRPGStats_Object * skill,
+		CDivinityStats_Character * character, ObjectSet<STDString> const & paramTexts)
+	{
+		Restriction restriction(*this, RestrictAll);
+
+		PushExtCallback(ExtCallback::SkillGetDescriptionParam); // stack: fn
 
 		auto _{ PushArguments(L,
 			std::tuple{Push<StatsProxy>(skill, std::optional<int32_t>()),
@@ -714,7 +885,6 @@ namespace dse::lua
 		CDivinityStats_Character * character, ObjectSet<STDString> const & paramTexts)
 	{
 		std::lock_guard lock(mutex_);
-		Restriction restriction(*this, RestrictAll);
 
 		auto status = prototype->GetStats();
 		if (status == nullptr) {
@@ -725,7 +895,23 @@ namespace dse::lua
 			character = statusSource;
 		}
 
-		PushExtFunction(L, "_StatusGetDescriptionParam"); // stack: fn
+		auto cacheKey = DescriptionParamCache::MakeKey(prototype, statusSource, character, paramTexts);
+		auto cached = descriptionParamCache_.Find(cacheKey);
+		if (cached) {
+			return *cached;
+		}
+
+		auto description = CallStatusGetDescriptionParam(status, statusSource, character, paramTexts);
+		descriptionParamCache_.Add(std::move(cacheKey), description);
+		return description;
+	}
+
+	std::optional<STDWString> ClientState::CallStatusGetDescriptionParam(CRPGStats_Object * status,
+		CDivinityStats_Character * statusSource, CDivinityStats_Character * character, ObjectSet<STDString> const & paramTexts)
+	{
+		Restriction restriction(*this, RestrictAll);
+
+		PushExtCallback(ExtCallback::StatusGetDescriptionParam); // stack: fn
 
 		auto _{ PushArguments(L,
 			std::tuple{Push<StatsProxy>(status, std::optional<int32_t>()),
@@ -795,6 +981,10 @@ namespace dse
 
 	void ExtensionStateClient::DoLuaReset()
 	{
+		// Listeners of the previous Lua state are gone
+		gOsirisProxy->GetNetworkManager().ClientResetSubscriptions();
+		// Partially received messages were meant for the previous Lua state
+		gOsirisProxy->GetNetworkManager().GetClientReassembler().Reset();
 		Lua.reset();
 		Lua = std::make_unique<lua::ClientState>();
 	}
@@ -3,243 +3,13 @@
 #include <PropertyMaps.h>
 #include <Version.h>
 #include <Lua/LuaBinding.h>
+#include <Lua/LuaSerializer.h>
 #include <ScriptHelpers.h>
 
 #include <fstream>
-#include <json/json.h>
 
 namespace dse::lua
 {
-	void JsonParse(lua_State * L, Json::Value & val);
-
-	void JsonParseArray(lua_State * L, Json::Value & val)
-	{
-		lua_newtable(L);
-		int idx = 1;
-		for (auto it = val.begin(), end = val.end(); it != end; ++it) {
-			lua_pushinteger(L, idx++);
-			JsonParse(L, *it);
-			lua_settable(L, -3);
-		}
-	}
-
-	void JsonParseObject(lua_State * L, Json::Value & val)
-	{
-		lua_newtable(L);
-		for (auto it = val.begin(), end = val.end(); it != end; ++it) {
-			JsonParse(L, it.key());
-			JsonParse(L, *it);
-			lua_settable(L, -3);
-		}
-	}
-
-	void JsonParse(lua_State * L, Json::Value & val)
-	{
-		switch (val.type()) {
-		case Json::nullValue:
-			lua_pushnil(L);
-			break;
-
-		case Json::intValue:
-			lua_pushinteger(L, val.asInt64());
-			break;
-
-		case Json::uintValue:
-			lua_pushinteger(L, (int64_t)val.asUInt64());
-			break;
-
-		case Json::realValue:
-			lua_pushnumber(L, val.asDouble());
-			break;
-
-		case Json::stringValue:
-			lua_pushstring(L, val.asCString());
-			break;
-
-		case Json::booleanValue:
-			lua_pushboolean(L, val.asBool() ? 1 : 0);
-			break;
-
-		case Json::arrayValue:
-			JsonParseArray(L, val);
-			break;
-
-		case Json::objectValue:
-			JsonParseObject(L, val);
-			break;
-
-		default:
-			luaL_error(L, "Attempted to parse unknown Json value");
-		}
-	}
-
-
-	int JsonParse(lua_State * L)
-	{
-		size_t length;
-		auto json = luaL_checklstring(L, 1, &length);
-
-		Json::CharReaderBuilder factory;
-		std::unique_ptr<Json::CharReader> reader(factory.newCharReader());
-
-		Json::Value root;
-		std::string errs;
-		if (!reader->parse(json, json + length, &root, &errs)) {
-			return luaL_error(L, "Unable to parse JSON: %s", errs.c_str());
-		}
-
-		JsonParse(L, root);
-		return 1;
-	}
-
-	Json::Value JsonStringify(lua_State * L, int index, int depth);
-
-	Json::Value JsonStringifyObject(lua_State * L, int index, int depth)
-	{
-		Json::Value arr(Json::objectValue);
-		lua_pushnil(L);
-
-		if (index < 0) index--;
-
-		while (lua_next(L, index) != 0) {
-			Json::Value val(JsonStringify(L, -1, depth + 1));
-
-			if (lua_type(L, -2) == LUA_TSTRING) {
-				auto key = lua_tostring(L, -2);
-				arr[key] = val;
-			} else if (lua_type(L, -2) == LUA_TNUMBER) {
-				lua_pushvalue(L, -2);
-				auto key = lua_tostring(L, -1);
-				arr[key] = val;
-				lua_pop(L, 1);
-			} else {
-				throw std::runtime_error("Can only stringify string or number table keys");
-			}
-
-			lua_pop(L, 1);
-		}
-
-		return arr;
-	}
-
-	Json::Value JsonStringifyArray(lua_State * L, int index, int depth)
-	{
-		Json::Value arr(Json::arrayValue);
-		lua_pushnil(L);
-
-		if (index < 0) index--;
-
-		while (lua_next(L, index) != 0) {
-			arr.append(JsonStringify(L, -1, depth + 1));
-			lua_pop(L, 1);
-		}
-
-		return arr;
-	}
-
-	bool JsonCanStringifyAsArray(lua_State * L, int index)
-	{
-		Json::Value arr(Json::objectValue);
-		lua_pushnil(L);
-
-		if (index < 0) index--;
-
-		int next = 1;
-		bool isArray = true;
-		while (lua_next(L, index) != 0) {
-			if (lua_isinteger(L, -2)) {
-				auto key = lua_tointeger(L, -2);
-				if (key != next++) {
-					isArray = false;
-				}
-			} else {
-				isArray = false;
-			}
-
-			lua_pop(L, 1);
-		}
-
-		return isArray;
-	}
-
-	Json::Value JsonStringifyTable(lua_State * L, int index, int depth)
-	{
-		if (JsonCanStringifyAsArray(L, index)) {
-			return JsonStringifyArray(L, index, depth);
-		} else {
-			return JsonStringifyObject(L, index, depth);
-		}
-	}
-
-
-	Json::Value JsonStringify(lua_State * L, int index, int depth)
-	{
-		if (depth > 64) {
-			throw std::runtime_error("Recursion depth exceeded while stringifying JSON");
-		}
-
-		switch (lua_type(L, index)) {
-		case LUA_TNIL:
-			return Json::Value(Json::nullValue);
-
-		case LUA_TBOOLEAN:
-			return Json::Value(lua_toboolean(L, index) == 1);
-
-		case LUA_TNUMBER:
-			if (lua_isinteger(L, index)) {
-				return Json::Value(lua_tointeger(L, index));
-			} else {
-				return Json::Value(lua_tonumber(L, index));
-			}
-
-		case LUA_TSTRING:
-			return Json::Value(lua_tostring(L, index));
-
-		case LUA_TTABLE:
-			return JsonStringifyTable(L, index, depth);
-
-		case LUA_TLIGHTUSERDATA:
-		case LUA_TFUNCTION:
-		case LUA_TUSERDATA:
-		case LUA_TTHREAD:
-		default:
-			throw std::runtime_error("Attempted to stringify a lightuserdata, userdata, function or thread value");
-		}
-	}
-
-
-	int JsonStringify(lua_State * L)
-	{
-		int nargs = lua_gettop(L);
-		if (nargs < 1 || nargs > 2) {
-			return luaL_error(L, "JsonStringify expects at most two parameters.");
-		}
-
-		bool beautify{ true };
-		if (nargs >= 2) {
-			beautify = lua_toboolean(L, 2) == 1;
-		}
-
-		Json::Value root;
-		try {
-			root = JsonStringify(L, 1, 0);
-		} catch (std::runtime_error & e) {
-			return luaL_error(L, "%s", e.what());
-		}
-
-		Json::StreamWriterBuilder builder;
-		if (beautify) {
-			builder["indentation"] = "\t";
-		}
-		std::stringstream ss;
-		std::unique_ptr<Json::StreamWriter> writer(builder.newStreamWriter());
-		writer->write(root, &ss);
-
-		lua_pushstring(L, ss.str().c_str());
-		return 1;
-	}
-
-
 	void OsiArgsToStream(lua_State * L, std::stringstream & ss)
 	{
 		int nargs = lua_gettop(L);  /* number of arguments */
@@ -304,9 +74,10 @@ namespace dse::lua
 	int SaveFile(lua_State* L)
 	{
 		auto path = checked_get<char const*>(L, 1);
-		auto contents = checked_get<char const*>(L, 2);
+		size_t length;
+		auto contents = luaL_checklstring(L, 2, &length);
 
-		push(L, script::SaveExternalFile(path, contents));
+		push(L, script::SaveExternalFile(path, std::string_view(contents, length)));
 		return 1;
 	}
 
@@ -526,25 +297,70 @@ namespace dse::lua
 		}
 	}
 
-	void LuaToRequirement(lua_State * L, CRPGStats_Requirement & requirement)
+	// Reads the requirement table at the top of the stack; returns false with an error message instead of
+	// raising a Lua error, so StatApplyPatch() can reject a malformed patch before anything is applied
+	bool ParseRequirement(lua_State * L, CRPGStats_Requirement & requirement, STDString & error)
 	{
-		auto requirementLabel = gettable<char const *, char const *>(L, "Requirement");
-		auto requirementId = EnumInfo<RequirementType>::Find(requirementLabel);
+		if (lua_type(L, -1) != LUA_TTABLE) {
+			error = "Requirements must be tables";
+			return false;
+		}
+
+		lua_getfield(L, -1, "Requirement"); // stack: requirement, label
+		auto requirementLabel = lua_type(L, -1) == LUA_TSTRING ? lua_tostring(L, -1) : nullptr;
+		auto requirementId = requirementLabel ? EnumInfo<RequirementType>::Find(requirementLabel) : std::optional<RequirementType>();
+		lua_pop(L, 1); // stack: requirement
 		if (!requirementId) {
-			luaL_error(L, "Unknown requirement type: %s", requirementLabel);
+			error = "Unknown requirement type: ";
+			error += requirementLabel ? requirementLabel : "(not a string)";
+			return false;
 		}
 
 		requirement.RequirementId = *requirementId;
+		lua_getfield(L, -1, "Param"); // stack: requirement, param
 		if (*requirementId == RequirementType::Tag) {
-			auto param = gettable<char const *, char const *>(L, "Param");
-			requirement.StringParam = MakeFixedString(param);
+			if (lua_type(L, -1) != LUA_TSTRING) {
+				lua_pop(L, 1); // stack: requirement
+				error = "Tag requirement parameter must be a string";
+				return false;
+			}
+
+			requirement.StringParam = MakeFixedString(lua_tostring(L, -1));
 			requirement.IntParam = -1;
 		} else {
-			auto param = gettable<char const *, int32_t>(L, "Param");
-			requirement.IntParam = param;
+			int isnum{ 0 };
+			auto param = lua_tointegerx(L, -1, &isnum);
+			if (!isnum && !lua_isnil(L, -1)) {
+				lua_pop(L, 1); // stack: requirement
+				error = "Requirement parameter must be an integer";
+				return false;
+			}
+
+			requirement.IntParam = (int32_t)param;
 		}
+		lua_pop(L, 1); // stack: requirement
 
-		requirement.Negate = gettable<char const *, bool>(L, "Not");
+		lua_getfield(L, -1, "Not"); // stack: requirement, negate
+		requirement.Negate = lua_toboolean(L, -1) != 0;
+		lua_pop(L, 1); // stack: requirement
+		return true;
+	}
+
+	void LuaToRequirement(lua_State * L, CRPGStats_Requirement & requirement)
+	{
+		bool ok;
+		{
+			STDString error;
+			ok = ParseRequirement(L, requirement, error);
+			if (!ok) {
+				push(L, error.c_str());
+			}
+		}
+
+		// Raised outside the scope of the error string, as lua_error() doesn't unwind the C++ stack
+		if (!ok) {
+			lua_error(L);
+		}
 	}
 
 	void LuaToRequirements(lua_State * L, ObjectSet<CRPGStats_Requirement, GameMemoryAllocator, true> & requirements)
@@ -644,6 +460,7 @@ namespace dse::lua
 			return luaL_error(L, "StatSetAttribute() can only be called during module load");
 		}
 
+		DescriptionParamCache::InvalidateAll();
 		if (strcmp(attributeName, "Requirements") == 0) {
 			LuaToRequirements(L, object->Requirements);
 			return 0;
@@ -691,6 +508,318 @@ namespace dse::lua
 		return LuaStatSetAttribute(L, object, attributeName, 3);
 	}
 
+	struct StatPatchEntry
+	{
+		enum class EntryType
+		{
+			Attribute,
+			Requirements,
+			MemorizationRequirements,
+			AIFlags
+		};
+
+		EntryType Type{ EntryType::Attribute };
+		CRPGStats_Object * Object{ nullptr };
+		StatAttributeHandle const * Attribute{ nullptr };
+		char const * StringValue{ nullptr };
+		int32_t IntValue{ 0 };
+		uint64_t AIFlags{ 0 };
+		std::vector<CRPGStats_Requirement> Requirements;
+	};
+
+	bool ValidateStatPatchRequirements(lua_State * L, StatPatchEntry & entry, STDString & error)
+	{
+		if (lua_type(L, -1) != LUA_TTABLE) {
+			error = "Expected a table of requirements";
+			return false;
+		}
+
+		auto len = luaL_len(L, -1);
+		entry.Requirements.resize((size_t)len);
+		for (lua_Integer i = 0; i < len; i++) {
+			lua_rawgeti(L, -1, i + 1); // stack: requirements, requirement
+			auto ok = ParseRequirement(L, entry.Requirements[(size_t)i], error);
+			lua_pop(L, 1); // stack: requirements
+			if (!ok) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Checks the value using the same lookups as the setters, so that applying a validated value can't fail
+	bool ValidateStatPatchValue(lua_State * L, CRPGStatsManager * stats, StatAttributeHandle const & attribute,
+		StatPatchEntry & entry, STDString & error)
+	{
+		auto valueType = lua_type(L, -1);
+		switch (attribute.Type) {
+		case StatAttributeHandle::ValueType::FixedString:
+		case StatAttributeHandle::ValueType::AttributeFlags:
+			if (valueType != LUA_TSTRING) {
+				error = "Expected a string value";
+				return false;
+			}
+			break;
+
+		case StatAttributeHandle::ValueType::ConstantInt:
+			if (valueType != LUA_TNUMBER) {
+				error = "Expected an integer value";
+				return false;
+			}
+			break;
+
+		case StatAttributeHandle::ValueType::Enumeration:
+			if (valueType != LUA_TSTRING && valueType != LUA_TNUMBER) {
+				error = "Expected an enumeration label or index";
+				return false;
+			}
+			break;
+
+		default:
+			error = "Attribute type is not supported";
+			return false;
+		}
+
+		if (valueType == LUA_TSTRING) {
+			// The string is owned by the patch table, which stays on the stack until the patch is applied
+			entry.StringValue = lua_tostring(L, -1);
+			if (attribute.Type == StatAttributeHandle::ValueType::Enumeration
+				&& !stats->EnumLabelToIndex(attribute, entry.StringValue)) {
+				error = "Value is not a valid enum label: ";
+				error += entry.StringValue;
+				return false;
+			}
+
+			if (attribute.Type == StatAttributeHandle::ValueType::AttributeFlags) {
+				STDString invalidLabel;
+				if (entry.Object->IndexedProperties[attribute.AttributeIndex] == -1) {
+					error = "Stats entry has no AttributeFlags";
+					return false;
+				} else if (!stats->StringToAttributeFlags(entry.StringValue, &invalidLabel)) {
+					error = "Invalid AttributeFlag: ";
+					error += invalidLabel;
+					return false;
+				}
+			}
+		} else {
+			int isnum{ 0 };
+			auto value = lua_tointegerx(L, -1, &isnum);
+			if (!isnum) {
+				error = "Expected an integer value";
+				return false;
+			}
+
+			if (attribute.Type == StatAttributeHandle::ValueType::Enumeration
+				&& !stats->IsValidEnumIndex(attribute, (int32_t)value)) {
+				error = "Enum index out of range: ";
+				error += std::to_string(value).c_str();
+				return false;
+			}
+
+			entry.StringValue = nullptr;
+			entry.IntValue = (int32_t)value;
+		}
+
+		return true;
+	}
+
+	int StatApplyPatch(lua_State * L)
+	{
+		luaL_checktype(L, 1, LUA_TTABLE);
+		lua_settop(L, 1); // stack: patch
+
+		LuaVirtualPin lua(gOsirisProxy->GetCurrentExtensionState());
+		if (!(lua->RestrictionFlags & State::ScopeModuleLoad)) {
+			return luaL_error(L, "StatApplyPatch() can only be called during module load");
+		}
+
+		auto stats = GetStaticSymbols().GetStats();
+		if (stats == nullptr) {
+			OsiErrorS("CRPGStatsManager not available");
+			return 0;
+		}
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		// Attributes are resolved once per stats type (modifier list); entries are grouped
+		// by the stats type, so entries of the same type are applied together
+		std::unordered_map<int32_t, std::unordered_map<STDString, std::optional<StatAttributeHandle>>> attributes;
+		std::map<int32_t, std::vector<StatPatchEntry>> entries;
+		std::vector<STDString> errors;
+		uint32_t applied{ 0 };
+
+		auto addError = [&errors](char const * statName, char const * attributeName, STDString const & message) {
+			STDString error = statName;
+			if (attributeName != nullptr) {
+				error += '.';
+				error += attributeName;
+			}
+
+			error += ": ";
+			error += message;
+			errors.push_back(error);
+		};
+
+		lua_pushnil(L); // stack: patch, nil
+		while (lua_next(L, 1) != 0) { // stack: patch, statName, attributes
+			if (lua_type(L, -2) != LUA_TSTRING || lua_type(L, -1) != LUA_TTABLE) {
+				lua_pop(L, 1); // stack: patch, statName
+				errors.push_back("Patch entries must be tables keyed by stat name");
+				continue;
+			}
+
+			auto statName = lua_tostring(L, -2);
+			auto object = stats->objects.Find(statName);
+			if (object == nullptr) {
+				lua_pop(L, 1); // stack: patch, statName
+				addError(statName, nullptr, "Stat object does not exist");
+				continue;
+			}
+
+			auto modifierListIndex = (int32_t)object->ModifierListIndex;
+			auto & typeAttributes = attributes[modifierListIndex];
+			auto & typeEntries = entries[modifierListIndex];
+
+			lua_pushnil(L); // stack: patch, statName, attributes, nil
+			while (lua_next(L, -2) != 0) { // stack: patch, statName, attributes, attributeName, value
+				if (lua_type(L, -2) != LUA_TSTRING) {
+					lua_pop(L, 1); // stack: patch, statName, attributes, attributeName
+					addError(statName, nullptr, "Attribute names must be strings");
+					continue;
+				}
+
+				auto attributeName = lua_tostring(L, -2);
+				StatPatchEntry entry;
+				entry.Object = object;
+				if (strcmp(attributeName, "Requirements") == 0) {
+					entry.Type = StatPatchEntry::EntryType::Requirements;
+				} else if (strcmp(attributeName, "MemorizationRequirements") == 0) {
+					entry.Type = StatPatchEntry::EntryType::MemorizationRequirements;
+				} else if (strcmp(attributeName, "AIFlags") == 0) {
+					entry.Type = StatPatchEntry::EntryType::AIFlags;
+				}
+
+				if (entry.Type != StatPatchEntry::EntryType::Attribute) {
+					// These aren't regular attributes; they're validated here and applied with the rest of the patch
+					STDString error;
+					int isnum{ 0 };
+					if (entry.Type == StatPatchEntry::EntryType::AIFlags) {
+						entry.AIFlags = (uint64_t)lua_tointegerx(L, -1, &isnum);
+						if (!isnum) {
+							addError(statName, attributeName, "Expected an integer value");
+						} else {
+							typeEntries.push_back(std::move(entry));
+						}
+					} else if (!ValidateStatPatchRequirements(L, entry, error)) {
+						addError(statName, attributeName, error);
+					} else {
+						typeEntries.push_back(std::move(entry));
+					}
+
+					lua_pop(L, 1); // stack: patch, statName, attributes, attributeName
+					continue;
+				}
+
+				auto it = typeAttributes.find(attributeName);
+				if (it == typeAttributes.end()) {
+					it = typeAttributes.insert(std::make_pair(STDString(attributeName),
+						stats->ResolveAttribute(modifierListIndex, attributeName))).first;
+				}
+
+				STDString error;
+				if (!it->second) {
+					addError(statName, attributeName, "Attribute does not exist");
+				} else if (!ValidateStatPatchValue(L, stats, *it->second, entry, error)) {
+					addError(statName, attributeName, error);
+				} else {
+					entry.Attribute = &*it->second;
+					typeEntries.push_back(std::move(entry));
+				}
+
+				lua_pop(L, 1); // stack: patch, statName, attributes, attributeName
+			}
+
+			lua_pop(L, 1); // stack: patch, statName
+		}
+
+		DescriptionParamCache::InvalidateAll();
+		for (auto const & typeEntries : entries) {
+			for (auto const & entry : typeEntries.second) {
+				if (entry.Type != StatPatchEntry::EntryType::Attribute) {
+					if (entry.Type == StatPatchEntry::EntryType::AIFlags) {
+						entry.Object->AIFlags = entry.AIFlags;
+					} else {
+						auto & requirements = entry.Type == StatPatchEntry::EntryType::Requirements
+							? entry.Object->Requirements
+							: entry.Object->MemorizationRequirements;
+						requirements.Set.Reallocate((uint32_t)entry.Requirements.size());
+						requirements.Set.Size = (uint32_t)entry.Requirements.size();
+						for (uint32_t i = 0; i < requirements.Set.Size; i++) {
+							requirements[i] = entry.Requirements[i];
+						}
+					}
+
+					applied++;
+					continue;
+				}
+
+				bool ok;
+				if (entry.StringValue != nullptr) {
+					ok = stats->SetAttributeString(entry.Object, *entry.Attribute, entry.StringValue);
+				} else {
+					ok = stats->SetAttributeInt(entry.Object, *entry.Attribute, entry.IntValue);
+				}
+
+				if (ok) {
+					applied++;
+				} else {
+					addError(entry.Object->Name, entry.Attribute->Name.Str, "Invalid value");
+				}
+			}
+		}
+
+		auto time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+		if (!errors.empty()) {
+			OsiWarn("Stat patch: " << errors.size() << " entries could not be applied");
+		}
+
+		lua_newtable(L); // stack: result
+		settable(L, "Applied", applied);
+		settable(L, "Failed", (uint32_t)errors.size());
+		settable(L, "Time", time);
+
+		push(L, "Errors"); // stack: result, "Errors"
+		lua_createtable(L, (int)errors.size(), 0); // stack: result, "Errors", errors
+		for (uint32_t i = 0; i < errors.size(); i++) {
+			settable(L, i + 1, StringView(errors[i])); // stack: result, "Errors", errors
+		}
+		lua_settable(L, -3); // stack: result
+
+		return 1;
+	}
+
+	int GetStatAttributeHandle(lua_State * L)
+	{
+		auto statType = luaL_checkstring(L, 1);
+		auto attributeName = luaL_checkstring(L, 2);
+
+		auto stats = GetStaticSymbols().GetStats();
+		if (stats == nullptr) {
+			OsiErrorS("CRPGStatsManager not available");
+			return 0;
+		}
+
+		auto attribute = stats->ResolveAttribute(statType, attributeName);
+		if (!attribute) {
+			OsiError("Stats type '" << statType << "' has no attribute named '" << attributeName << "'");
+			return 0;
+		}
+
+		StatAttributeHandleProxy::New(L, *attribute);
+		return 1;
+	}
+
 	int StatAddCustomDescription(lua_State * L)
 	{
 		auto statName = luaL_checkstring(L, 1);
@@ -790,6 +919,7 @@ namespace dse::lua
 		}
 
 		if (!levelMapIds.empty()) {
+			DescriptionParamCache::InvalidateAll();
 			OsiWarn("Restored " << levelMapIds.size() << " level map overrides (Lua VM deleted)");
 		}
 	}
@@ -838,6 +968,7 @@ namespace dse::lua
 
 		stats->LevelMaps.Primitives.Set.Buf[modifier->LevelMapIndex] = levelMap;
 		lua->OverriddenLevelMaps.insert(modifier->LevelMapIndex);
+		DescriptionParamCache::InvalidateAll();
 
 		return 0;
 	}
@@ -1089,6 +1220,351 @@ namespace dse::lua
 		return 1;
 	}
 
+	// Called by the listener tables of Ext._Listeners when a listener is added to them
+	int OnListenerAdded(lua_State * L)
+	{
+		auto event = luaL_checkstring(L, 1);
+		State::FromLua(L)->OnListenerRegistered(event);
+		return 0;
+	}
+
+	int StartProfiler(lua_State * L)
+	{
+		LuaVirtualPin lua(gOsirisProxy->GetCurrentExtensionState());
+		auto & profiler = lua->GetProfiler();
+		profiler.Start(lua->GetState());
+
+		if (lua_gettop(L) >= 1 && !lua_isnil(L, 1)) {
+			auto reportFile = luaL_checkstring(L, 1);
+			auto interval = luaL_optnumber(L, 2, 10.0);
+			luaL_argcheck(L, interval > 0.0, 2, "report interval must be positive");
+			profiler.SetReportFile(reportFile, std::chrono::duration_cast<Profiler::Clock::duration>(
+				std::chrono::duration<double>(interval)));
+		} else {
+			profiler.SetReportFile("", Profiler::Clock::duration(0));
+		}
+
+		return 0;
+	}
+
+	int StopProfiler(lua_State * L)
+	{
+		LuaVirtualPin lua(gOsirisProxy->GetCurrentExtensionState());
+		lua->GetProfiler().Stop();
+		return 0;
+	}
+
+	int GetProfilerReport(lua_State * L)
+	{
+		auto maxFunctions = (uint32_t)luaL_optinteger(L, 1, 20);
+
+		LuaVirtualPin lua(gOsirisProxy->GetCurrentExtensionState());
+		push(L, lua->GetProfiler().GetReport(maxFunctions));
+		return 1;
+	}
+
+	int GetMemoryStats(lua_State * L)
+	{
+		LuaVirtualPin lua(gOsirisProxy->GetCurrentExtensionState());
+		auto const & allocator = lua->GetAllocator();
+
+		lua_newtable(L); // stack: stats
+		settable(L, "LiveBytes", (uint64_t)allocator.GetLiveBytes());
+		settable(L, "PeakBytes", (uint64_t)allocator.GetPeakBytes());
+		settable(L, "LargeAllocations", (uint64_t)allocator.GetLargeAllocations());
+
+		push(L, "SizeClasses"); // stack: stats, "SizeClasses"
+		lua_newtable(L); // stack: stats, "SizeClasses", sizeClasses
+		for (std::size_t i = 0; i < PoolAllocator::NumSizeClasses; i++) {
+			auto const & sizeClass = allocator.GetSizeClassStats(i);
+			push(L, (int64_t)i + 1); // stack: stats, "SizeClasses", sizeClasses, index
+			lua_newtable(L); // stack: stats, "SizeClasses", sizeClasses, index, sizeClass
+			settable(L, "BlockSize", (uint64_t)sizeClass.BlockSize);
+			settable(L, "LiveBlocks", (uint64_t)sizeClass.LiveBlocks);
+			settable(L, "ReservedBlocks", (uint64_t)sizeClass.ReservedBlocks);
+			settable(L, "TotalAllocations", (uint64_t)sizeClass.TotalAllocations);
+			lua_settable(L, -3); // stack: stats, "SizeClasses", sizeClasses
+		}
+
+		lua_settable(L, -3); // stack: stats
+		return 1;
+	}
+
+	int SetGCParameters(lua_State * L)
+	{
+		luaL_checktype(L, 1, LUA_TTABLE);
+
+		LuaVirtualPin lua(gOsirisProxy->GetCurrentExtensionState());
+		auto params = lua->GetGCParameters();
+
+		lua_getfield(L, 1, "Pause");
+		if (!lua_isnil(L, -1)) {
+			params.Pause = (int)luaL_checkinteger(L, -1);
+		}
+		lua_pop(L, 1);
+
+		lua_getfield(L, 1, "StepMultiplier");
+		if (!lua_isnil(L, -1)) {
+			params.StepMultiplier = (int)luaL_checkinteger(L, -1);
+		}
+		lua_pop(L, 1);
+
+		lua_getfield(L, 1, "IdleStepBudget");
+		if (!lua_isnil(L, -1)) {
+			auto budgetMs = luaL_checknumber(L, -1);
+			params.IdleStepBudget = std::chrono::microseconds((int64_t)(budgetMs * 1000.0));
+		}
+		lua_pop(L, 1);
+
+		if (params.Pause <= 0 || params.StepMultiplier <= 0) {
+			return luaL_error(L, "GC pause and step multiplier must be positive");
+		}
+
+		lua->SetGCParameters(params);
+		return 0;
+	}
+
+	int GetGCStats(lua_State * L)
+	{
+		LuaVirtualPin lua(gOsirisProxy->GetCurrentExtensionState());
+		auto const & params = lua->GetGCParameters();
+		auto const & stats = lua->GetGCStats();
+
+		auto toMs = [](std::chrono::nanoseconds d) {
+			return std::chrono::duration<double, std::milli>(d).count();
+		};
+
+		lua_newtable(L); // stack: stats
+		settable(L, "Pause", (int32_t)params.Pause);
+		settable(L, "StepMultiplier", (int32_t)params.StepMultiplier);
+		settable(L, "IdleStepBudget", toMs(params.IdleStepBudget));
+		settable(L, "MemoryKB", (int32_t)lua_gc(L, LUA_GCCOUNT, 0));
+		settable(L, "IdleSlices", stats.IdleSlices);
+		settable(L, "TickSlices", stats.TickSlices);
+		settable(L, "IdleSteps", stats.IdleSteps);
+		settable(L, "CompletedCycles", stats.CompletedCycles);
+		settable(L, "IdleTime", toMs(stats.IdleTime));
+		settable(L, "MaxIdleSliceTime", toMs(stats.MaxIdleSliceTime));
+		settable(L, "IdleFreedKB", stats.IdleFreedBytes / 1024);
+		settable(L, "NonIdleFrees", stats.NonIdleFrees);
+		settable(L, "NonIdleFreedKB", stats.NonIdleFreedBytes / 1024);
+		return 1;
+	}
+
+	int Schedule(lua_State * L)
+	{
+		luaL_checktype(L, 1, LUA_TFUNCTION);
+		auto priority = (int32_t)luaL_optinteger(L, 2, 0);
+		auto name = luaL_optstring(L, 3, "");
+
+		LuaVirtualPin lua(gOsirisProxy->GetCurrentExtensionState());
+		auto taskId = lua->GetTaskScheduler().Schedule(L, 1, priority, name);
+		push(L, taskId);
+		return 1;
+	}
+
+	int CancelTask(lua_State * L)
+	{
+		auto taskId = (int32_t)luaL_checkinteger(L, 1);
+
+		LuaVirtualPin lua(gOsirisProxy->GetCurrentExtensionState());
+		push(L, lua->GetTaskScheduler().Cancel(taskId));
+		return 1;
+	}
+
+	void PushTaskStats(lua_State * L, TaskScheduler::Task const & task, int64_t index)
+	{
+		auto toMs = [](TaskScheduler::Clock::duration d) {
+			return std::chrono::duration<double, std::milli>(d).count();
+		};
+
+		push(L, index); // stack: tasks, index
+		lua_newtable(L); // stack: tasks, index, task
+		settable(L, "Id", task.Id);
+		settable(L, "Name", StringView(task.Name));
+		settable(L, "Priority", task.Priority);
+		settable(L, "Status", TaskScheduler::GetStatusName(task.Status));
+		settable(L, "Resumes", task.Resumes);
+		settable(L, "TotalTime", toMs(task.TotalTime));
+		settable(L, "MaxSliceTime", toMs(task.MaxSliceTime));
+		lua_settable(L, -3); // stack: tasks
+	}
+
+	int GetTaskStats(lua_State * L)
+	{
+		LuaVirtualPin lua(gOsirisProxy->GetCurrentExtensionState());
+		auto const & scheduler = lua->GetTaskScheduler();
+		auto const & stats = scheduler.GetStats();
+
+		auto toMs = [](TaskScheduler::Clock::duration d) {
+			return std::chrono::duration<double, std::milli>(d).count();
+		};
+
+		lua_newtable(L); // stack: stats
+		settable(L, "Budget", (int32_t)gOsirisProxy->GetConfig().LuaTaskBudget);
+		settable(L, "Ticks", stats.Ticks);
+		settable(L, "TotalTime", toMs(stats.TotalTime));
+		settable(L, "MaxTickTime", toMs(stats.MaxTickTime));
+
+		push(L, "Tasks"); // stack: stats, "Tasks"
+		lua_newtable(L); // stack: stats, "Tasks", tasks
+		int64_t index = 1;
+		for (auto const & task : scheduler.GetTasks()) {
+			PushTaskStats(L, task, index++);
+		}
+
+		for (auto const & task : scheduler.GetPendingTasks()) {
+			PushTaskStats(L, task, index++);
+		}
+		lua_settable(L, -3); // stack: stats
+
+		push(L, "FinishedTasks"); // stack: stats, "FinishedTasks"
+		lua_newtable(L); // stack: stats, "FinishedTasks", tasks
+		index = 1;
+		for (auto const & task : scheduler.GetFinishedTasks()) {
+			PushTaskStats(L, task, index++);
+		}
+		lua_settable(L, -3); // stack: stats
+		return 1;
+	}
+
+	int AddWorkerScript(lua_State * L)
+	{
+		STDString modGuid = luaL_checkstring(L, 1);
+		STDString fileName = luaL_checkstring(L, 2);
+
+		auto extState = gOsirisProxy->GetCurrentExtensionState();
+		LuaVirtualPin lua(extState);
+		// All scripts must be known when the worker states are created
+		if (lua->StartupDone() || lua->GetWorkerPool().IsStarted()) {
+			return luaL_error(L, "Worker scripts can only be added during module startup");
+		}
+
+		auto path = extState->ResolveModScriptPath(modGuid, fileName);
+		if (!path) {
+			return luaL_error(L, "Mod does not exist or is not loaded: %s", modGuid.c_str());
+		}
+
+		auto reader = GetStaticSymbols().MakeFileReader(*path);
+		if (!reader.IsLoaded()) {
+			return luaL_error(L, "Script file could not be opened: %s", path->c_str());
+		}
+
+		lua->GetWorkerPool().AddScript(*path, reader.ToString());
+		return 0;
+	}
+
+	int SubmitJob(lua_State * L)
+	{
+		STDString function = luaL_checkstring(L, 1);
+		if (!lua_isnil(L, 2)) {
+			luaL_checktype(L, 2, LUA_TFUNCTION);
+		}
+
+		if (gOsirisProxy->GetConfig().LuaWorkerThreads == 0) {
+			return luaL_error(L, "Worker Lua states are disabled");
+		}
+
+		// Pack the arguments into a table, so they can be serialized as a single value
+		auto numArgs = lua_gettop(L) - 2;
+		lua_createtable(L, numArgs, 1); // stack: args
+		for (int i = 1; i <= numArgs; i++) {
+			lua_pushvalue(L, i + 2); // stack: args, arg
+			lua_rawseti(L, -2, i); // stack: args
+		}
+
+		push(L, numArgs); // stack: args, n
+		lua_setfield(L, -2, "n"); // stack: args
+
+		WorkerPool::Job job;
+		job.Function = function;
+		try {
+			SerializeValue(L, -1, job.Arguments);
+		} catch (std::runtime_error & e) {
+			return luaL_error(L, "Unable to serialize job arguments: %s", e.what());
+		}
+
+		lua_pop(L, 1); // stack: -
+		if (!lua_isnil(L, 2)) {
+			lua_pushvalue(L, 2); // stack: callback
+			job.CallbackRef = luaL_ref(L, LUA_REGISTRYINDEX); // stack: -
+		}
+
+		LuaVirtualPin lua(gOsirisProxy->GetCurrentExtensionState());
+		auto jobId = lua->GetWorkerPool().Submit(std::move(job));
+		push(L, (int64_t)jobId);
+		return 1;
+	}
+
+	void PushNetCounters(lua_State * L, std::map<NetStatistics::Key, NetStatistics::Counter> const & counters)
+	{
+		lua_newtable(L); // stack: counters
+		int64_t index = 1;
+		for (auto const & counter : counters) {
+			push(L, index++); // stack: counters, index
+			lua_newtable(L); // stack: counters, index, counter
+			settable(L, "Direction", NetStatistics::GetDirectionName(counter.first.Dir));
+			settable(L, "Peer", counter.first.PeerId);
+			settable(L, "Name", StringView(counter.first.Name));
+			settable(L, "Messages", counter.second.Messages);
+			settable(L, "Bytes", counter.second.Bytes);
+			lua_settable(L, -3); // stack: counters
+		}
+	}
+
+	void PushNetTiming(lua_State * L, NetStatistics::TimingStats const & timing)
+	{
+		lua_newtable(L); // stack: timing
+		settable(L, "Count", timing.Count);
+		settable(L, "TotalTime", timing.TotalMicroseconds / 1000.0);
+		settable(L, "MaxTime", timing.MaxMicroseconds / 1000.0);
+	}
+
+	int GetNetStats(lua_State * L)
+	{
+		auto stats = gOsirisProxy->GetNetworkManager().GetStatistics().GetSnapshot();
+
+		lua_newtable(L); // stack: stats
+		push(L, "MessageTypes"); // stack: stats, "MessageTypes"
+		PushNetCounters(L, stats.MessageTypes); // stack: stats, "MessageTypes", types
+		lua_settable(L, -3); // stack: stats
+
+		push(L, "Channels"); // stack: stats, "Channels"
+		PushNetCounters(L, stats.Channels); // stack: stats, "Channels", channels
+		lua_settable(L, -3); // stack: stats
+
+		for (auto dir : { NetStatistics::Direction::Sent, NetStatistics::Direction::Received }) {
+			STDString name = NetStatistics::GetDirectionName(dir);
+			name += "Sizes";
+			push(L, StringView(name)); // stack: stats, name
+			lua_newtable(L); // stack: stats, name, histogram
+			for (std::size_t i = 0; i < NetStatistics::NumSizeBuckets; i++) {
+				push(L, (int64_t)i + 1); // stack: stats, name, histogram, index
+				lua_newtable(L); // stack: stats, name, histogram, index, bucket
+				if (i < NetStatistics::NumSizeBuckets - 1) {
+					settable(L, "MaxSize", (uint64_t)NetStatistics::SizeBucketLimits[i]);
+				}
+				settable(L, "Messages", stats.SizeHistogram[(int)dir][i]);
+				lua_settable(L, -3); // stack: stats, name, histogram
+			}
+			lua_settable(L, -3); // stack: stats
+		}
+
+		push(L, "Serialize"); // stack: stats, "Serialize"
+		PushNetTiming(L, stats.Serialize); // stack: stats, "Serialize", timing
+		lua_settable(L, -3); // stack: stats
+
+		push(L, "Parse"); // stack: stats, "Parse"
+		PushNetTiming(L, stats.Parse); // stack: stats, "Parse", timing
+		lua_settable(L, -3); // stack: stats
+
+		if (lua_toboolean(L, 1)) {
+			gOsirisProxy->GetNetworkManager().GetStatistics().Reset();
+		}
+
+		return 1;
+	}
+
 	char const * OsiToLuaTypeName(ValueType type)
 	{
 		switch (type) {
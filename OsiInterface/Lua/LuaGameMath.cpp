@@ -0,0 +1,1570 @@
+#include <stdafx.h>
+#include <OsirisProxy.h>
+#include <Lua/LuaBinding.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <vector>
+
+// Native version of the hit chance, skill damage and character hit calculations in Game.Math.lua.
+// Function names and the order of evaluation (including RNG draws) match the Lua implementation;
+// any change made to one of them must be made to the other as well.
+
+namespace dse::lua
+{
+	// Temporary damage list that frees its buffer when going out of scope
+	struct ScopedDamageList : public DamagePairList
+	{
+		~ScopedDamageList()
+		{
+			if (Buf != nullptr) {
+				GameFree(Buf);
+			}
+		}
+	};
+
+	struct NativeHitInfo
+	{
+		int64_t EffectFlags{ 0 };
+		double DamageMultiplier{ 1.0 };
+		int64_t TotalDamageDone{ 0 };
+		int64_t ArmorAbsorption{ 0 };
+		std::optional<int64_t> LifeSteal;
+		std::optional<DamageType> DamageType;
+		DamagePairList * DamageList{ nullptr };
+	};
+
+	constexpr double RadToDeg = 180.0 / 3.141592653589793238462643383279502884;
+
+	class NativeGameMath
+	{
+	public:
+		NativeGameMath(lua_State * L)
+			: L(L)
+		{
+			stats_ = GetStaticSymbols().GetStats();
+			if (stats_ == nullptr || stats_->ExtraData == nullptr) {
+				luaL_error(L, "Stats not available");
+			}
+		}
+
+		// Rolls are made with the same functions as in the Lua implementation (Ext.Random() for damage
+		// rolls and math.random() for chance rolls), so both draw from the same generators
+		int64_t ExtRandom(int64_t low, int64_t up)
+		{
+			return CallRandom("Ext", "Random", low, up);
+		}
+
+		int64_t MathRandom(int64_t low, int64_t up)
+		{
+			return CallRandom("math", "random", low, up);
+		}
+
+		int64_t CallRandom(char const * library, char const * function, int64_t low, int64_t up)
+		{
+			lua_getglobal(L, library); // stack: lib
+			lua_getfield(L, -1, function); // stack: lib, fn
+			push(L, low); // stack: lib, fn, low
+			push(L, up); // stack: lib, fn, low, up
+			lua_call(L, 2, 1); // stack: lib, value
+			auto value = lua_tointeger(L, -1);
+			lua_pop(L, 2); // stack: -
+			return value;
+		}
+
+		double ExtraData(char const * key)
+		{
+			auto value = stats_->ExtraData->Properties.Find(key);
+			if (value == nullptr) {
+				luaL_error(L, "ExtraData key '%s' does not exist", key);
+			}
+
+			return *value;
+		}
+
+		int32_t CharacterStat(CDivinityStats_Character * character, char const * name)
+		{
+			auto value = character->GetStat(name, false);
+			if (!value) {
+				luaL_error(L, "Unknown character stats property: %s", name);
+			}
+
+			return *value;
+		}
+
+		int32_t Ability(CDivinityStats_Character * character, AbilityType ability)
+		{
+			return character->GetAbility(ability, false);
+		}
+
+		bool Talent(CDivinityStats_Character * character, TalentType talent)
+		{
+			return character->HasTalent(talent, false);
+		}
+
+		bool HasFlag(CDivinityStats_Character * character, StatCharacterFlags flag)
+		{
+			return (character->Flags & flag) != 0;
+		}
+
+		Vector3 const & Position(CDivinityStats_Character * character)
+		{
+			if (character->Character == nullptr) {
+				luaL_error(L, "Character stats have no position");
+			}
+
+			return *character->Character->GetTranslate();
+		}
+
+		// Same layout as the "Rotation" table returned to Lua (1-based)
+		float RotationAt(CDivinityStats_Character * character, int index)
+		{
+			if (character->Character == nullptr) {
+				luaL_error(L, "Character stats have no rotation");
+			}
+
+			auto rot = character->Character->GetRotation();
+			return (*rot)[(index - 1) / 3][(index - 1) % 3];
+		}
+
+		template <class TFun>
+		void ForEachEquipmentStat(CDivinityStats_Item * item, TFun fun)
+		{
+			for (auto stat = item->DynamicAttributes_Start; stat != item->DynamicAttributes_End; stat++) {
+				fun(*stat);
+			}
+		}
+
+		CDivinityStats_Equipment_Attributes_Weapon * AsWeaponStat(CDivinityStats_Equipment_Attributes * stat, char const * prop)
+		{
+			if (stat->StatsType != EquipmentStatsType::Weapon) {
+				luaL_error(L, "Equipment stats have no property named '%s'", prop);
+			}
+
+			return static_cast<CDivinityStats_Equipment_Attributes_Weapon *>(stat);
+		}
+
+		void BindSkill(CRPGStats_Object * skill, std::optional<int> level)
+		{
+			skill_ = skill;
+			skillLevel_ = level;
+		}
+
+		// Mirrors LuaStatGetAttribute(): enumerations are read as strings, everything else as integers
+		std::optional<char const *> SkillString(char const * attributeName)
+		{
+			return stats_->GetAttributeString(skill_, attributeName);
+		}
+
+		int32_t SkillInt(char const * attributeName)
+		{
+			std::optional<int> value;
+			if (skillLevel_) {
+				auto level = (*skillLevel_ == -1) ? (int)skill_->Level : *skillLevel_;
+				value = stats_->GetAttributeIntScaled(skill_, attributeName, level);
+			} else {
+				value = stats_->GetAttributeInt(skill_, attributeName);
+			}
+
+			if (!value) {
+				luaL_error(L, "Stat object '%s' has no integer attribute named '%s'", skill_->Name, attributeName);
+			}
+
+			return *value;
+		}
+
+		bool SkillIs(char const * attributeName, char const * value)
+		{
+			auto attr = SkillString(attributeName);
+			return attr && strcmp(*attr, value) == 0;
+		}
+
+		std::optional<DamageType> SkillDamageType()
+		{
+			auto damageType = SkillString("DamageType");
+			if (!damageType) {
+				luaL_error(L, "Skill has no damage type");
+			}
+
+			auto type = EnumInfo<DamageType>::Find(*damageType);
+			if (!type) {
+				luaL_error(L, "Unknown damage type: %s", *damageType);
+			}
+
+			return type;
+		}
+
+
+		char const * DamageTypeToDeathType(DamageType damageType)
+		{
+			switch (damageType) {
+			case DamageType::Physical: return "Physical";
+			case DamageType::Piercing: return "Piercing";
+			case DamageType::Fire: return "Incinerate";
+			case DamageType::Air: return "Electrocution";
+			case DamageType::Water: return "FrozenShatter";
+			case DamageType::Earth: return "PetrifiedShatter";
+			case DamageType::Poison: return "Acid";
+			default: return "Sentinel";
+			}
+		}
+
+		bool IsRangedWeapon(CDivinityStats_Item * item)
+		{
+			auto type = item->WeaponType;
+			return type == WeaponType::Bow || type == WeaponType::Crossbow
+				|| type == WeaponType::Wand || type == WeaponType::Rifle;
+		}
+
+		double ScaledDamageFromPrimaryAttribute(double primaryAttr)
+		{
+			return (primaryAttr - ExtraData("AttributeBaseValue")) * ExtraData("DamageBoostFromAttribute");
+		}
+
+		double GetPrimaryAttributeAmount(CDivinityStats_Character * character)
+		{
+			// UseWeaponDamage skills never get here; see GetSkillAttributeDamageScale()
+			auto ability = SkillString("Ability");
+			if (ability && (strcmp(*ability, "Warrior") == 0 || strcmp(*ability, "Polymorph") == 0)) {
+				return CharacterStat(character, "Strength");
+			} else if (ability && (strcmp(*ability, "Ranger") == 0 || strcmp(*ability, "Rogue") == 0)) {
+				return CharacterStat(character, "Finesse");
+			} else {
+				return CharacterStat(character, "Intelligence");
+			}
+		}
+
+		double GetSkillAttributeDamageScale(CDivinityStats_Character * attacker)
+		{
+			// The Lua version compares the "Ability" enumeration label against 0,
+			// which never matches; this is kept as-is
+			if (attacker == nullptr || SkillIs("UseWeaponDamage", "Yes")) {
+				return 1.0;
+			} else {
+				auto primaryAttr = GetPrimaryAttributeAmount(attacker);
+				return 1.0 + ScaledDamageFromPrimaryAttribute(primaryAttr);
+			}
+		}
+
+		double GetDamageMultipliers(bool stealthed, Vector3 const & attackerPos, Vector3 const & targetPos)
+		{
+			auto stealthDamageMultiplier = 1.0;
+			if (stealthed) {
+				stealthDamageMultiplier = SkillInt("Stealth Damage Multiplier") * 0.01;
+			}
+
+			auto targetDistance = sqrt(pow((double)attackerPos[0] - targetPos[0], 2.0) + pow((double)attackerPos[2] - targetPos[2], 2.0));
+			auto distanceDamageMultiplier = 1.0;
+			if (targetDistance > 1.0) {
+				distanceDamageMultiplier = round(targetDistance) * SkillInt("Distance Damage Multiplier") * 0.01 + 1;
+			}
+
+			auto damageMultiplier = SkillInt("Damage Multiplier") * 0.01;
+			return stealthDamageMultiplier * distanceDamageMultiplier * damageMultiplier;
+		}
+
+		double GetVitalityBoostByLevel(double level)
+		{
+			auto expGrowth = ExtraData("VitalityExponentialGrowth");
+			auto growth = pow(expGrowth, level - 1);
+
+			if (level >= ExtraData("FirstVitalityLeapLevel")) {
+				growth = growth * ExtraData("FirstVitalityLeapGrowth") / expGrowth;
+			}
+
+			if (level >= ExtraData("SecondVitalityLeapLevel")) {
+				growth = growth * ExtraData("SecondVitalityLeapGrowth") / expGrowth;
+			}
+
+			if (level >= ExtraData("ThirdVitalityLeapLevel")) {
+				growth = growth * ExtraData("ThirdVitalityLeapGrowth") / expGrowth;
+			}
+
+			if (level >= ExtraData("FourthVitalityLeapLevel")) {
+				growth = growth * ExtraData("FourthVitalityLeapGrowth") / expGrowth;
+			}
+
+			auto vit = level * ExtraData("VitalityLinearGrowth") + ExtraData("VitalityStartingAmount") * growth;
+			return round(vit / 5.0) * 5.0;
+		}
+
+		double GetLevelScaledDamage(double level)
+		{
+			auto vitalityBoost = GetVitalityBoostByLevel(level);
+			return vitalityBoost / (((level - 1) * ExtraData("VitalityToDamageRatioGrowth")) + ExtraData("VitalityToDamageRatio"));
+		}
+
+		double GetAverageLevelDamage(double level)
+		{
+			auto scaled = GetLevelScaledDamage(level);
+			return ((level * ExtraData("ExpectedDamageBoostFromAttributePerLevel")) + 1.0) * scaled
+				* ((level * ExtraData("ExpectedDamageBoostFromSkillAbilityPerLevel")) + 1.0);
+		}
+
+		double GetLevelScaledWeaponDamage(double level)
+		{
+			auto scaledDmg = GetLevelScaledDamage(level);
+			return ((level * ExtraData("ExpectedDamageBoostFromWeaponAbilityPerLevel")) + 1.0) * scaledDmg;
+		}
+
+		double GetLevelScaledMonsterWeaponDamage(double level)
+		{
+			auto weaponDmg = GetLevelScaledWeaponDamage(level);
+			return ((level * ExtraData("MonsterDamageBoostPerLevel")) + 1.0) * weaponDmg;
+		}
+
+		double GetDamageBoostByType(CDivinityStats_Character * character, DamageType damageType)
+		{
+			switch (damageType) {
+			case DamageType::Physical:
+				return Ability(character, AbilityType::WarriorLore) * ExtraData("SkillAbilityPhysicalDamageBoostPerPoint") / 100.0;
+			case DamageType::Fire:
+				return Ability(character, AbilityType::FireSpecialist) * ExtraData("SkillAbilityFireDamageBoostPerPoint") / 100.0;
+			case DamageType::Air:
+				return Ability(character, AbilityType::AirSpecialist) * ExtraData("SkillAbilityAirDamageBoostPerPoint") / 100.0;
+			case DamageType::Water:
+				return Ability(character, AbilityType::WaterSpecialist) * ExtraData("SkillAbilityWaterDamageBoostPerPoint") / 100.0;
+			case DamageType::Earth:
+			case DamageType::Poison:
+				return Ability(character, AbilityType::EarthSpecialist) * ExtraData("SkillAbilityPoisonAndEarthDamageBoostPerPoint") / 100.0;
+			default:
+				return 0.0;
+			}
+		}
+
+		void ApplyDamageBoosts(CDivinityStats_Character * character, DamagePairList & damageList)
+		{
+			std::vector<TDamagePair> damages(damageList.Buf, damageList.Buf + damageList.Size);
+			for (auto const & damage : damages) {
+				auto boost = GetDamageBoostByType(character, damage.DamageType);
+				if (boost > 0.0) {
+					damageList.AddDamage(damage.DamageType, (int32_t)round(damage.Amount * boost));
+				}
+			}
+		}
+
+		double CalculateBaseDamage(char const * skillDamageType, CDivinityStats_Character * attacker, double level)
+		{
+			if (strcmp(skillDamageType, "BaseLevelDamage") == 0) {
+				return round(GetLevelScaledDamage(level));
+			} else if (strcmp(skillDamageType, "AverageLevelDamge") == 0) {
+				return round(GetAverageLevelDamage(level));
+			} else if (strcmp(skillDamageType, "MonsterWeaponDamage") == 0) {
+				return round(GetLevelScaledMonsterWeaponDamage(level));
+			} else if (strncmp(skillDamageType, "Source", 6) == 0) {
+				if (attacker == nullptr) {
+					luaL_error(L, "Damage source '%s' needs an attacker", skillDamageType);
+				}
+
+				auto source = skillDamageType + 6;
+				if (strcmp(source, "MaximumVitality") == 0) return attacker->MaxVitality;
+				if (strcmp(source, "MaximumPhysicalArmor") == 0) return attacker->MaxArmor;
+				if (strcmp(source, "MaximumMagicArmor") == 0) return attacker->MaxMagicArmor;
+				if (strcmp(source, "CurrentVitality") == 0) return attacker->CurrentVitality;
+				if (strcmp(source, "CurrentPhysicalArmor") == 0) return attacker->CurrentArmor;
+				if (strcmp(source, "CurrentMagicArmor") == 0) return attacker->CurrentMagicArmor;
+				if (strcmp(source, "ShieldPhysicalArmor") == 0) {
+					luaL_error(L, "SourceShieldPhysicalArmor NOT IMPLEMENTED YET");
+				}
+			} else if (strncmp(skillDamageType, "Target", 6) == 0) {
+				// GetSkillDamage() passes 0 as the target
+				luaL_error(L, "Damage source '%s' needs a target", skillDamageType);
+			}
+
+			return luaL_error(L, "Unknown damage source: %s", skillDamageType);
+		}
+
+		std::optional<DamageType> GetDamageListDeathType(DamagePairList const & damageList, char const *& deathType)
+		{
+			int32_t biggestDamage = -1;
+			std::optional<DamageType> biggestType;
+			for (uint32_t i = 0; i < damageList.Size; i++) {
+				if (damageList[i].Amount > biggestDamage) {
+					biggestType = damageList[i].DamageType;
+					biggestDamage = damageList[i].Amount;
+				}
+			}
+
+			deathType = biggestType ? DamageTypeToDeathType(*biggestType) : nullptr;
+			return biggestType;
+		}
+
+		std::optional<AbilityType> GetWeaponAbility(CDivinityStats_Character * character, CDivinityStats_Item * weapon)
+		{
+			if (weapon == nullptr) {
+				return {};
+			}
+
+			auto offHandWeapon = character->GetOffHandWeapon();
+			if (offHandWeapon != nullptr && IsRangedWeapon(weapon) && IsRangedWeapon(offHandWeapon)) {
+				return AbilityType::DualWielding;
+			}
+
+			auto weaponType = weapon->WeaponType;
+			if (weaponType == WeaponType::Bow || weaponType == WeaponType::Crossbow || weaponType == WeaponType::Rifle) {
+				return AbilityType::Ranged;
+			}
+
+			if (weapon->IsTwoHanded) {
+				return AbilityType::TwoHanded;
+			}
+
+			return AbilityType::SingleHanded;
+		}
+
+		double ComputeWeaponCombatAbilityBoost(CDivinityStats_Character * character, CDivinityStats_Item * weapon)
+		{
+			auto abilityType = GetWeaponAbility(character, weapon);
+			if (abilityType) {
+				return Ability(character, *abilityType) * ExtraData("CombatAbilityDamageBonus");
+			} else {
+				return 0;
+			}
+		}
+
+		char const * GetWeaponScalingRequirement(CDivinityStats_Item * weapon)
+		{
+			char const * requirementName = nullptr;
+			int32_t largestRequirement = -1;
+
+			auto & requirements = weapon->Requirements;
+			for (uint32_t i = 0; i < requirements.Set.Size; i++) {
+				auto const & requirement = requirements[i];
+				auto reqId = requirement.RequirementId;
+				if (!requirement.Negate && requirement.IntParam > largestRequirement &&
+					(reqId == RequirementType::Strength || reqId == RequirementType::Finesse || reqId == RequirementType::Constitution ||
+					reqId == RequirementType::Memory || reqId == RequirementType::Wits)) {
+					requirementName = *EnumInfo<RequirementType>::Find(reqId);
+					largestRequirement = requirement.IntParam;
+				}
+			}
+
+			return requirementName;
+		}
+
+		double ComputeWeaponRequirementScaledDamage(CDivinityStats_Character * character, CDivinityStats_Item * weapon)
+		{
+			auto scalingReq = GetWeaponScalingRequirement(weapon);
+			if (scalingReq != nullptr) {
+				return ScaledDamageFromPrimaryAttribute(CharacterStat(character, scalingReq)) * 100.0;
+			} else {
+				return 0;
+			}
+		}
+
+		struct BaseWeaponDamage
+		{
+			DamageType Type;
+			double Min;
+			double Max;
+		};
+
+		double ComputeBaseWeaponDamage(CDivinityStats_Item * weapon, std::vector<BaseWeaponDamage> & damages)
+		{
+			if (weapon->DynamicAttributes_Start == weapon->DynamicAttributes_End) {
+				luaL_error(L, "Weapon has no dynamic stats");
+			}
+
+			auto baseStat = *weapon->DynamicAttributes_Start;
+			auto baseWeaponStat = AsWeaponStat(baseStat, "DamageFromBase");
+			auto baseMinDamage = baseWeaponStat->MinDamage;
+			auto baseMaxDamage = baseWeaponStat->MaxDamage;
+			double damageBoost = 0;
+
+			ForEachEquipmentStat(weapon, [&](CDivinityStats_Equipment_Attributes * stat) {
+				if (stat->StatsType != EquipmentStatsType::Weapon) return;
+
+				auto weaponStat = static_cast<CDivinityStats_Equipment_Attributes_Weapon *>(stat);
+				if (weaponStat->DamageType == DamageType::None) return;
+
+				auto dmgType = weaponStat->DamageType;
+				auto dmgFromBase = weaponStat->DamageFromBase * 0.01;
+				double minDamage = weaponStat->MinDamage;
+				double maxDamage = weaponStat->MaxDamage;
+
+				if (dmgFromBase != 0) {
+					if (stat == baseStat) {
+						if (baseMinDamage != 0) {
+							minDamage = std::max(dmgFromBase * baseMinDamage, 1.0);
+						}
+						if (baseMaxDamage != 0) {
+							maxDamage = std::max(dmgFromBase * baseMaxDamage, 1.0);
+						}
+					} else {
+						minDamage = std::max(dmgFromBase * dmgFromBase * baseMinDamage, 1.0);
+						maxDamage = std::max(dmgFromBase * dmgFromBase * baseMaxDamage, 1.0);
+					}
+				}
+
+				if (minDamage > 0) {
+					maxDamage = std::max(maxDamage, minDamage + 1.0);
+				}
+
+				damageBoost += weaponStat->DamageBoost;
+
+				auto damage = std::find_if(damages.begin(), damages.end(), [dmgType](BaseWeaponDamage const & dmg) {
+					return dmg.Type == dmgType;
+				});
+				if (damage == damages.end()) {
+					damages.push_back(BaseWeaponDamage{ dmgType, minDamage, maxDamage });
+				} else {
+					damage->Min += minDamage;
+					damage->Max += maxDamage;
+				}
+			});
+
+			return damageBoost;
+		}
+
+		void CalculateWeaponScaledDamage(CDivinityStats_Character * character, CDivinityStats_Item * weapon,
+			DamagePairList & damageList, bool noRandomization)
+		{
+			std::vector<BaseWeaponDamage> damages;
+			auto damageBoost = ComputeBaseWeaponDamage(weapon, damages);
+
+			auto abilityBoosts = character->GetDamageBoost()
+				+ ComputeWeaponCombatAbilityBoost(character, weapon)
+				+ ComputeWeaponRequirementScaledDamage(character, weapon);
+			abilityBoosts = std::max(abilityBoosts + 100.0, 0.0) / 100.0;
+
+			auto boost = 1.0 + damageBoost * 0.01;
+			if (!HasFlag(character, SCF_NotSneaking)) {
+				boost = boost + ExtraData("Sneak Damage Multiplier");
+			}
+
+			for (auto const & damage : damages) {
+				auto min = ceil(damage.Min * boost * abilityBoosts);
+				auto max = ceil(damage.Max * boost * abilityBoosts);
+
+				int64_t randRange = 1;
+				if (max - min >= 1) {
+					randRange = (int64_t)(max - min);
+				}
+
+				int64_t finalAmount;
+				if (noRandomization) {
+					finalAmount = (int64_t)min + randRange / 2;
+				} else {
+					finalAmount = (int64_t)min + ExtRandom(0, randRange);
+				}
+
+				damageList.AddDamage(damage.Type, (int32_t)finalAmount);
+			}
+		}
+
+		void CalculateWeaponDamage(CDivinityStats_Character * attacker, CDivinityStats_Item * weapon,
+			DamagePairList & damageList, bool noRandomization)
+		{
+			CalculateWeaponScaledDamage(attacker, weapon, damageList, noRandomization);
+			ApplyDamageBoosts(attacker, damageList);
+			// The Lua version applies DualWieldingDamagePenalty when 'weapon == offHand'; this never holds
+			// there as each OffHandWeapon access returns a new proxy object, so the penalty is not applied here either
+		}
+
+		int GetSkillDamage(CDivinityStats_Character * attacker, bool stealthed, Vector3 const & attackerPos,
+			Vector3 const & targetPos, double level, bool noRandomization)
+		{
+			if (attacker != nullptr && level < 0) {
+				level = attacker->Level;
+			}
+
+			auto damageMultiplier = SkillInt("Damage Multiplier") * 0.01;
+			auto damageMultipliers = GetDamageMultipliers(stealthed, attackerPos, targetPos);
+
+			// level == 0 with a non-numeric OverrideSkillLevel is delegated to Lua by the caller
+			if (level == 0) {
+				level = SkillInt("OverrideSkillLevel");
+				if (level == 0) {
+					level = (double)skillPrototypeLevel_;
+				}
+			}
+
+			if (damageMultiplier <= 0) {
+				return 0;
+			}
+
+			auto damageList = DamageList::New(L);
+			auto & damages = damageList->Get();
+			auto useWeaponDamage = SkillIs("UseWeaponDamage", "Yes");
+
+			if (useWeaponDamage) {
+				auto damageType = SkillDamageType();
+				if (damageType == DamageType::None || damageType == DamageType::Sentinel) {
+					damageType = {};
+				}
+
+				auto weapon = attacker->GetMainWeapon();
+				auto offHand = attacker->GetOffHandWeapon();
+
+				if (weapon != nullptr) {
+					ScopedDamageList mainDmgs;
+					CalculateWeaponDamage(attacker, weapon, mainDmgs, noRandomization);
+					mainDmgs.Multiply(damageMultipliers);
+					if (damageType) {
+						mainDmgs.ConvertDamageType(*damageType);
+					}
+					damages.Merge(mainDmgs);
+				}
+
+				if (offHand != nullptr && IsRangedWeapon(weapon) && IsRangedWeapon(offHand)) {
+					ScopedDamageList offHandDmgs;
+					CalculateWeaponDamage(attacker, offHand, offHandDmgs, noRandomization);
+					offHandDmgs.Multiply(damageMultipliers);
+					if (damageType) {
+						offHandDmgs.ConvertDamageType(*damageType);
+					}
+					damages.Merge(offHandDmgs);
+				}
+
+				damages.AggregateSameTypeDamages();
+			} else {
+				auto damageType = SkillDamageType();
+
+				auto skillDamage = SkillString("Damage");
+				if (!skillDamage) {
+					luaL_error(L, "Skill has no damage source");
+				}
+
+				auto baseDamage = CalculateBaseDamage(*skillDamage, attacker, level);
+				auto damageRange = SkillInt("Damage Range");
+				double randomMultiplier;
+				if (noRandomization) {
+					randomMultiplier = 0.0;
+				} else {
+					randomMultiplier = 1.0 + (ExtRandom(0, damageRange) - damageRange / 2.0) * 0.01;
+				}
+
+				double attrDamageScale;
+				if (strcmp(*skillDamage, "BaseLevelDamage") == 0 || strcmp(*skillDamage, "AverageLevelDamge") == 0) {
+					attrDamageScale = GetSkillAttributeDamageScale(attacker);
+				} else {
+					attrDamageScale = 1.0;
+				}
+
+				double damageBoost;
+				if (attacker != nullptr) {
+					damageBoost = attacker->GetDamageBoost() / 100.0 + 1.0;
+				} else {
+					damageBoost = 1.0;
+				}
+
+				auto finalDamage = baseDamage * randomMultiplier * attrDamageScale * damageMultipliers;
+				finalDamage = std::max(round(finalDamage), 1.0);
+				finalDamage = ceil(finalDamage * damageBoost);
+				damages.AddDamage(*damageType, (int32_t)finalDamage);
+
+				if (attacker != nullptr) {
+					ApplyDamageBoosts(attacker, damages);
+				}
+			}
+
+			char const * deathType{ nullptr };
+			auto skillDeathType = SkillString("DeathType");
+			if (skillDeathType) {
+				deathType = *skillDeathType;
+			}
+
+			if (deathType != nullptr && strcmp(deathType, "None") == 0) {
+				if (useWeaponDamage) {
+					GetDamageListDeathType(damages, deathType);
+				} else {
+					deathType = DamageTypeToDeathType(*SkillDamageType());
+				}
+			}
+
+			if (deathType != nullptr) {
+				push(L, deathType);
+			} else {
+				lua_pushnil(L);
+			}
+
+			return 2;
+		}
+
+
+		void ApplyDamageSkillAbilityBonuses(DamagePairList & damageList, CDivinityStats_Character * attacker)
+		{
+			if (attacker == nullptr) {
+				return;
+			}
+
+			int64_t magicArmorDamage = 0;
+			int64_t armorDamage = 0;
+
+			for (uint32_t i = 0; i < damageList.Size; i++) {
+				auto const & damage = damageList[i];
+				auto type = damage.DamageType;
+				if (type == DamageType::Magic || type == DamageType::Fire || type == DamageType::Air
+					|| type == DamageType::Water || type == DamageType::Earth) {
+					magicArmorDamage += damage.Amount;
+				}
+
+				if (type == DamageType::Physical || type == DamageType::Corrosive || type == DamageType::Sulfuric) {
+					armorDamage += damage.Amount;
+				}
+			}
+
+			if (magicArmorDamage > 0) {
+				auto airSpecialist = Ability(attacker, AbilityType::AirSpecialist);
+				if (airSpecialist > 0) {
+					auto magicBonus = airSpecialist * ExtraData("SkillAbilityDamageToMagicArmorPerPoint");
+					if (magicBonus > 0) {
+						auto magicDamage = ceil((magicArmorDamage * magicBonus) / 100.0);
+						damageList.AddDamage(DamageType::Magic, (int32_t)magicDamage);
+					}
+				}
+			}
+
+			if (armorDamage > 0) {
+				auto armorBonus = Ability(attacker, AbilityType::WarriorLore) * ExtraData("SkillAbilityDamageToPhysicalArmorPerPoint");
+				if (armorBonus > 0) {
+					auto corrosiveDamage = ceil((armorDamage * armorBonus) / 100.0);
+					damageList.AddDamage(DamageType::Corrosive, (int32_t)corrosiveDamage);
+				}
+			}
+		}
+
+		int32_t GetResistance(CDivinityStats_Character * character, DamageType type)
+		{
+			if (type == DamageType::None || type == DamageType::Chaos) {
+				return 0;
+			}
+
+			STDString resistanceName = *EnumInfo<DamageType>::Find(type);
+			resistanceName += "Resistance";
+			return CharacterStat(character, resistanceName.c_str());
+		}
+
+		void ApplyHitResistances(CDivinityStats_Character * character, DamagePairList & damageList)
+		{
+			std::vector<TDamagePair> damages(damageList.Buf, damageList.Buf + damageList.Size);
+			for (auto const & damage : damages) {
+				auto resistance = GetResistance(character, damage.DamageType);
+				damageList.AddDamage(damage.DamageType, (int32_t)floor(damage.Amount * -resistance / 100.0));
+			}
+		}
+
+		void ApplyDamageCharacterBonuses(CDivinityStats_Character * character, CDivinityStats_Character * attacker,
+			DamagePairList & damageList)
+		{
+			damageList.AggregateSameTypeDamages();
+			ApplyHitResistances(character, damageList);
+
+			ApplyDamageSkillAbilityBonuses(damageList, attacker);
+		}
+
+		double GetAbilityCriticalHitMultiplier(CDivinityStats_Character * character, std::optional<AbilityType> ability)
+		{
+			if (ability == AbilityType::TwoHanded) {
+				return round(Ability(character, AbilityType::TwoHanded) * ExtraData("CombatAbilityCritMultiplierBonus"));
+			}
+
+			if (ability == AbilityType::RogueLore) {
+				return round(Ability(character, AbilityType::RogueLore) * ExtraData("SkillAbilityCritMultiplierPerPoint"));
+			}
+
+			return 0;
+		}
+
+		double GetCriticalHitMultiplier(CDivinityStats_Item * weapon, CDivinityStats_Character * character)
+		{
+			double criticalMultiplier = 0;
+			if (weapon->ItemType == EquipmentStatsType::Weapon) {
+				ForEachEquipmentStat(weapon, [&](CDivinityStats_Equipment_Attributes * stat) {
+					criticalMultiplier += AsWeaponStat(stat, "CriticalDamage")->CriticalDamage;
+				});
+
+				if (character != nullptr) {
+					auto ability = GetWeaponAbility(character, weapon);
+					criticalMultiplier = criticalMultiplier + GetAbilityCriticalHitMultiplier(character, ability)
+						+ GetAbilityCriticalHitMultiplier(character, AbilityType::RogueLore);
+
+					if (Talent(character, TALENT_Human_Inventive)) {
+						criticalMultiplier = criticalMultiplier + ExtraData("TalentHumanCriticalMultiplier");
+					}
+				}
+			}
+
+			return criticalMultiplier * 0.01;
+		}
+
+		void ApplyCriticalHit(NativeHitInfo & hit, CDivinityStats_Character * attacker)
+		{
+			auto mainWeapon = attacker->GetMainWeapon();
+			if (mainWeapon != nullptr) {
+				hit.EffectFlags |= HF_CriticalHit;
+				hit.DamageMultiplier = hit.DamageMultiplier + (GetCriticalHitMultiplier(mainWeapon, attacker) - 1.0);
+			}
+		}
+
+		bool ShouldApplyCriticalHit(NativeHitInfo & hit, CDivinityStats_Character * attacker,
+			std::optional<HitType> hitType, std::optional<CriticalRoll> criticalRoll)
+		{
+			if (criticalRoll != CriticalRoll::Roll) {
+				return criticalRoll == CriticalRoll::Critical;
+			}
+
+			if (Talent(attacker, TALENT_Haymaker)) {
+				return false;
+			}
+
+			if (!Talent(attacker, TALENT_ViolentMagic) || hitType != HitType::Magic) {
+				if ((hit.EffectFlags & HF_Backstab) != 0) {
+					return true;
+				}
+
+				if (hitType == HitType::Magic || hitType == HitType::DoT || hitType == HitType::Surface) {
+					return false;
+				}
+
+				return MathRandom(0, 99) < CharacterStat(attacker, "CriticalChance");
+			} else {
+				// The Lua version computes a ViolentMagic-adjusted crit chance here, but rolls against
+				// the unadjusted CriticalChance; this is kept as-is
+				return MathRandom(0, 99) < CharacterStat(attacker, "CriticalChance");
+			}
+		}
+
+		void ConditionalApplyCriticalHitMultiplier(NativeHitInfo & hit, CDivinityStats_Character * attacker,
+			std::optional<HitType> hitType, std::optional<CriticalRoll> criticalRoll)
+		{
+			if (ShouldApplyCriticalHit(hit, attacker, hitType, criticalRoll)) {
+				ApplyCriticalHit(hit, attacker);
+			}
+		}
+
+		void ApplyLifeSteal(NativeHitInfo & hit, CDivinityStats_Character * target, CDivinityStats_Character * attacker,
+			std::optional<HitType> hitType)
+		{
+			if (attacker == nullptr || hitType == HitType::DoT || hitType == HitType::Surface) {
+				return;
+			}
+
+			auto magicDmg = hit.DamageList->GetByType(DamageType::Magic);
+			auto corrosiveDmg = hit.DamageList->GetByType(DamageType::Corrosive);
+			double lifesteal = (double)(hit.TotalDamageDone - hit.ArmorAbsorption - corrosiveDmg - magicDmg);
+
+			if ((hit.EffectFlags & (HF_FromShacklesOfPain | HF_NoDamageOnOwner | HF_Reflection)) != 0) {
+				auto modifier = ExtraData("LifestealFromReflectionModifier");
+				lifesteal = floor(lifesteal * modifier);
+			}
+
+			if (lifesteal > target->CurrentVitality) {
+				lifesteal = target->CurrentVitality;
+			}
+
+			if (lifesteal > 0) {
+				hit.LifeSteal = (int64_t)std::max(ceil(lifesteal * CharacterStat(attacker, "LifeSteal") / 100), 0.0);
+			}
+		}
+
+		void ApplyDamagesToHitInfo(DamagePairList const & damageList, NativeHitInfo & hit)
+		{
+			int64_t totalDamage = 0;
+			for (uint32_t i = 0; i < damageList.Size; i++) {
+				auto const & damage = damageList[i];
+				totalDamage += damage.Amount;
+				if (damage.DamageType == DamageType::Chaos) {
+					if (!hit.DamageType) {
+						luaL_error(L, "Hit has no damage type");
+					}
+
+					hit.DamageList->AddDamage(*hit.DamageType, damage.Amount);
+				} else {
+					hit.DamageList->AddDamage(damage.DamageType, damage.Amount);
+				}
+			}
+
+			hit.TotalDamageDone = hit.TotalDamageDone + totalDamage;
+		}
+
+		int64_t ComputeArmorDamage(DamagePairList const & damageList, int64_t armor)
+		{
+			int64_t absorption = 0;
+
+			auto corrosive = damageList.GetByType(DamageType::Corrosive);
+			if (corrosive > 0) {
+				auto damageAmount = std::min(armor, (int64_t)corrosive);
+				armor = armor - damageAmount;
+				absorption = absorption + damageAmount;
+			}
+
+			for (uint32_t i = 0; i < damageList.Size; i++) {
+				// The Lua version also checks for "Sulfur", which is not a valid damage type
+				if (damageList[i].DamageType == DamageType::Physical) {
+					absorption = absorption + std::min(armor, (int64_t)damageList[i].Amount);
+				}
+			}
+
+			return absorption;
+		}
+
+		int64_t ComputeMagicArmorDamage(DamagePairList const & damageList, int64_t magicArmor)
+		{
+			int64_t absorption = 0;
+
+			auto magic = damageList.GetByType(DamageType::Magic);
+			if (magic > 0) {
+				auto damageAmount = std::min(magicArmor, (int64_t)magic);
+				magicArmor = magicArmor - damageAmount;
+				absorption = absorption + damageAmount;
+			}
+
+			for (uint32_t i = 0; i < damageList.Size; i++) {
+				auto type = damageList[i].DamageType;
+				if (type == DamageType::Fire || type == DamageType::Water || type == DamageType::Air
+					|| type == DamageType::Earth || type == DamageType::Poison) {
+					absorption = absorption + std::min(magicArmor, (int64_t)damageList[i].Amount);
+				}
+			}
+
+			return absorption;
+		}
+
+		void DoHit(int hitIdx, NativeHitInfo & hit, DamagePairList & damageList, std::vector<DamageType> const & statusBonusDmgTypes,
+			std::optional<HitType> hitType, CDivinityStats_Character * target, CDivinityStats_Character * attacker)
+		{
+			hit.EffectFlags |= HF_Hit;
+			damageList.AggregateSameTypeDamages();
+			damageList.Multiply(hit.DamageMultiplier);
+
+			int64_t totalDamage = 0;
+			for (uint32_t i = 0; i < damageList.Size; i++) {
+				totalDamage += damageList[i].Amount;
+			}
+
+			if (totalDamage < 0) {
+				damageList.Clear();
+			}
+
+			ApplyDamageCharacterBonuses(target, attacker, damageList);
+			damageList.AggregateSameTypeDamages();
+
+			hit.DamageList = &DamageList::New(L)->Get();
+			lua_setfield(L, hitIdx, "DamageList");
+
+			for (auto damageType : statusBonusDmgTypes) {
+				damageList.AddDamage(damageType, (int32_t)ceil(totalDamage * 0.1));
+			}
+
+			ApplyDamagesToHitInfo(damageList, hit);
+			hit.ArmorAbsorption = hit.ArmorAbsorption + ComputeArmorDamage(damageList, target->CurrentArmor);
+			hit.ArmorAbsorption = hit.ArmorAbsorption + ComputeMagicArmorDamage(damageList, target->CurrentMagicArmor);
+
+			if (hit.TotalDamageDone > 0) {
+				ApplyLifeSteal(hit, target, attacker, hitType);
+			} else {
+				hit.EffectFlags |= HF_DontCreateBloodSurface;
+			}
+
+			if (hitType == HitType::Surface) {
+				hit.EffectFlags |= HF_Surface;
+			}
+
+			if (hitType == HitType::DoT) {
+				hit.EffectFlags |= HF_DoT;
+			}
+		}
+
+		// Note: ComputeCharacterHit() passes the target as 'attacker' (and vice versa); kept as-is
+		double GetAttackerDamageMultiplier(CDivinityStats_Character * attacker, CDivinityStats_Character * target,
+			std::optional<HighGroundBonus> highGround)
+		{
+			if (target == nullptr) {
+				return 0.0;
+			}
+
+			if (highGround == HighGroundBonus::HighGround) {
+				auto rangerLoreBonus = Ability(attacker, AbilityType::RangerLore) * ExtraData("SkillAbilityHighGroundBonusPerPoint");
+				return std::max(rangerLoreBonus + ExtraData("HighGroundBaseDamageBonus"), 0.0);
+			} else if (highGround == HighGroundBonus::LowGround) {
+				return ExtraData("LowGroundBaseDamagePenalty");
+			} else {
+				return 0.0;
+			}
+		}
+
+		// Mirrors Lua truthiness of an item stat attribute: any existing value is true
+		bool ItemAttributeIsSet(CDivinityStats_Item * item, char const * attributeName)
+		{
+			return stats_->GetAttributeString(item, attributeName) || stats_->GetAttributeInt(item, attributeName);
+		}
+
+		void DamageItemDurability(CDivinityStats_Item * item)
+		{
+			int64_t degradeSpeed = 0;
+			ForEachEquipmentStat(item, [&](CDivinityStats_Equipment_Attributes * stat) {
+				degradeSpeed += stat->DurabilityDegradeSpeed;
+			});
+
+			if (degradeSpeed > 0) {
+				// Item stats are read-only from Lua, so the Lua version fails at this point
+				luaL_error(L, "Not supported yet!");
+			}
+		}
+
+		void ConditionalDamageItemDurability(CDivinityStats_Character * character, CDivinityStats_Item * item)
+		{
+			if (!HasFlag(character, SCF_InParty) || !ItemAttributeIsSet(item, "LoseDurabilityOnCharacterHit")
+				|| ItemAttributeIsSet(item, "Unbreakable") || !IsRangedWeapon(item)) {
+				return;
+			}
+
+			auto chance = 100;
+			if (Talent(character, TALENT_Durability)) {
+				chance = 50;
+			}
+
+			if (MathRandom(0, 99) < chance) {
+				DamageItemDurability(item);
+			}
+		}
+
+		void PushHitChance(CDivinityStats_Character * attacker, CDivinityStats_Character * target)
+		{
+			if (Talent(attacker, TALENT_Haymaker)) {
+				push(L, 100);
+				return;
+			}
+
+			auto mainWeapon = attacker->GetMainWeapon();
+			auto ranged = mainWeapon != nullptr && IsRangedWeapon(mainWeapon);
+			auto accuracy = CharacterStat(attacker, "Accuracy");
+			int32_t dodge = 0;
+			if ((!HasFlag(attacker, SCF_Invisible) || ranged) && target->IsIncapacitatedRefCount == 0) {
+				dodge = CharacterStat(target, "Dodge");
+			}
+
+			auto chanceToHit1 = round(((100.0 - dodge) * accuracy) / 100);
+			chanceToHit1 = std::max(0.0, std::min(100.0, chanceToHit1));
+			push(L, chanceToHit1 + CharacterStat(attacker, "ChanceToHitBoost"));
+		}
+
+		double CalculateHitChance(CDivinityStats_Character * attacker, CDivinityStats_Character * target)
+		{
+			PushHitChance(attacker, target);
+			auto hitChance = lua_tonumber(L, -1);
+			lua_pop(L, 1);
+			return hitChance;
+		}
+
+		bool IsInFlankingPosition(CDivinityStats_Character * target, CDivinityStats_Character * attacker)
+		{
+			auto const & tPos = Position(target);
+			auto const & aPos = Position(attacker);
+
+			double dx = tPos[0] - aPos[0], dy = tPos[1] - aPos[1], dz = tPos[2] - aPos[2];
+			auto distanceSq = 1.0 / sqrt(dx * dx + dy * dy + dz * dz);
+			auto nx = dx * distanceSq, ny = dy * distanceSq, nz = dz * distanceSq;
+
+			auto ang = -RotationAt(target, 7) * nx - RotationAt(target, 8) * ny - RotationAt(target, 9) * nz;
+			return ang > cos(0.52359879);
+		}
+
+		bool CanBackstab(CDivinityStats_Character * target, CDivinityStats_Character * attacker)
+		{
+			auto const & targetPos = Position(target);
+			auto const & attackerPos = Position(attacker);
+
+			double atkDir[3];
+			for (auto i = 0; i < 3; i++) {
+				atkDir[i] = (double)attackerPos[i] - targetPos[i];
+			}
+
+			auto atkAngle = atan2(atkDir[2], atkDir[0]) * RadToDeg;
+			if (atkAngle < 0) {
+				atkAngle = 360 + atkAngle;
+			}
+
+			auto angle = atan2(-(double)RotationAt(target, 1), (double)RotationAt(target, 3)) * RadToDeg;
+			if (angle < 0) {
+				angle = 360 + angle;
+			}
+
+			auto relAngle = atkAngle - angle;
+			if (relAngle < 0) {
+				relAngle = 360 + relAngle;
+			}
+
+			return relAngle >= 150 && relAngle <= 210;
+		}
+
+		void ComputeCharacterHit(int hitIdx, NativeHitInfo & hit, CDivinityStats_Character * target,
+			CDivinityStats_Character * attacker, CDivinityStats_Item * weapon, DamagePairList & damageList,
+			std::optional<HitType> hitType, bool noHitRoll, bool forceReduceDurability, bool alwaysBackstab,
+			std::optional<HighGroundBonus> highGroundFlag, std::optional<CriticalRoll> criticalRoll)
+		{
+			hit.DamageMultiplier = 1.0;
+			std::vector<DamageType> statusBonusDmgTypes;
+
+			if (attacker == nullptr) {
+				DoHit(hitIdx, hit, damageList, statusBonusDmgTypes, hitType, target, attacker);
+				return;
+			}
+
+			hit.DamageMultiplier = 1.0 + GetAttackerDamageMultiplier(target, attacker, highGroundFlag);
+			if (hitType == HitType::Magic || hitType == HitType::Surface || hitType == HitType::DoT || hitType == HitType::Reflected) {
+				ConditionalApplyCriticalHitMultiplier(hit, attacker, hitType, criticalRoll);
+				DoHit(hitIdx, hit, damageList, statusBonusDmgTypes, hitType, target, attacker);
+				return;
+			}
+
+			auto backstabbed = false;
+			if (alwaysBackstab || (weapon != nullptr && weapon->WeaponType == WeaponType::Knife && CanBackstab(target, attacker))) {
+				hit.EffectFlags |= HF_Backstab;
+				backstabbed = true;
+			}
+
+			if (hitType == HitType::Melee) {
+				if (IsInFlankingPosition(target, attacker)) {
+					hit.EffectFlags |= HF_Flanking;
+				}
+
+				// Apply Sadist talent
+				if (Talent(attacker, TALENT_Sadist)) {
+					if ((hit.EffectFlags & HF_Poisoned) != 0) {
+						statusBonusDmgTypes.push_back(DamageType::Poison);
+					}
+					if ((hit.EffectFlags & HF_Burning) != 0) {
+						statusBonusDmgTypes.push_back(DamageType::Fire);
+					}
+					if ((hit.EffectFlags & HF_Bleeding) != 0) {
+						statusBonusDmgTypes.push_back(DamageType::Physical);
+					}
+				}
+			}
+
+			if (Talent(attacker, TALENT_Damage)) {
+				hit.DamageMultiplier = hit.DamageMultiplier + 0.1;
+			}
+
+			auto hitBlocked = false;
+
+			if (!noHitRoll) {
+				// Note: target and attacker are swapped here in the Lua version; kept as-is
+				auto hitChance = CalculateHitChance(target, attacker);
+				auto hitRoll = MathRandom(0, 99);
+				if (hitRoll >= hitChance) {
+					if (Talent(target, TALENT_RangerLoreEvasionBonus) && hitRoll < hitChance + 10) {
+						hit.EffectFlags |= HF_Dodged;
+					} else {
+						hit.EffectFlags |= HF_Missed;
+					}
+					hitBlocked = true;
+				} else {
+					auto blockChance = CharacterStat(target, "BlockChance");
+					if (!backstabbed && blockChance > 0 && MathRandom(0, 99) <= blockChance) {
+						hit.EffectFlags |= HF_Blocked;
+						hitBlocked = true;
+					}
+				}
+			}
+
+			if (weapon != nullptr && strcmp(weapon->Name, "DefaultWeapon") != 0 && hitType != HitType::Magic
+				&& forceReduceDurability && (hit.EffectFlags & (HF_Missed | HF_Dodged)) == 0) {
+				ConditionalDamageItemDurability(attacker, weapon);
+			}
+
+			if (!hitBlocked) {
+				ConditionalApplyCriticalHitMultiplier(hit, attacker, hitType, criticalRoll);
+				DoHit(hitIdx, hit, damageList, statusBonusDmgTypes, hitType, target, attacker);
+			}
+		}
+
+		void BindSkillPrototypeLevel(uint32_t level)
+		{
+			skillPrototypeLevel_ = level;
+		}
+
+	private:
+		lua_State * L;
+		CRPGStatsManager * stats_;
+		CRPGStats_Object * skill_{ nullptr };
+		std::optional<int> skillLevel_;
+		uint32_t skillPrototypeLevel_{ 0 };
+	};
+
+
+	// All native entry points receive the Lua implementation of the function as their first argument,
+	// and pass the call through to it for arguments that the native version does not handle
+	int CallLuaImplementation(lua_State * L)
+	{
+		lua_call(L, lua_gettop(L) - 1, LUA_MULTRET);
+		return lua_gettop(L);
+	}
+
+	// Returns false if the value is neither nil nor a character stats object
+	bool GetOptionalCharacter(lua_State * L, int index, CDivinityStats_Character *& character)
+	{
+		if (lua_isnil(L, index)) {
+			character = nullptr;
+			return true;
+		}
+
+		auto proxy = ObjectProxy<CDivinityStats_Character>::AsUserData(L, index);
+		if (proxy == nullptr) {
+			return false;
+		}
+
+		character = proxy->Get(L);
+		return true;
+	}
+
+	template <class T>
+	std::optional<T> GetOptionalEnum(lua_State * L, int index)
+	{
+		if (lua_type(L, index) != LUA_TSTRING) {
+			return {};
+		}
+
+		return EnumInfo<T>::Find(lua_tostring(L, index));
+	}
+
+	Vector3 GetPosition(lua_State * L, int index)
+	{
+		luaL_checktype(L, index, LUA_TTABLE);
+		Vector3 pos;
+		for (auto i = 0; i < 3; i++) {
+			lua_rawgeti(L, index, i + 1);
+			pos[i] = (float)luaL_checknumber(L, -1);
+			lua_pop(L, 1);
+		}
+
+		return pos;
+	}
+
+	int64_t GetHitField(lua_State * L, int hitIdx, char const * field)
+	{
+		lua_getfield(L, hitIdx, field);
+		int isnum;
+		auto value = lua_tointegerx(L, -1, &isnum);
+		lua_pop(L, 1);
+		if (!isnum) {
+			luaL_error(L, "Hit field '%s' must be an integer", field);
+		}
+
+		return value;
+	}
+
+
+	// CalculateHitChance(luaImpl, attacker, target)
+	int NativeCalculateHitChance(lua_State * L)
+	{
+		auto attacker = ObjectProxy<CDivinityStats_Character>::AsUserData(L, 2);
+		auto target = ObjectProxy<CDivinityStats_Character>::AsUserData(L, 3);
+		if (attacker == nullptr || target == nullptr) {
+			return CallLuaImplementation(L);
+		}
+
+		NativeGameMath math(L);
+		math.PushHitChance(attacker->Get(L), target->Get(L));
+		return 1;
+	}
+
+	// GetSkillDamage(luaImpl, skill, attacker, isFromItem, stealthed, attackerPos, targetPos, level, noRandomization)
+	int NativeGetSkillDamage(lua_State * L)
+	{
+		auto skill = SkillPrototypeProxy::AsUserData(L, 2);
+		CDivinityStats_Character * attacker;
+		if (skill == nullptr || skill->GetStats() == nullptr
+			|| !GetOptionalCharacter(L, 3, attacker)
+			|| !lua_isnumber(L, 8)) {
+			return CallLuaImplementation(L);
+		}
+
+		NativeGameMath math(L);
+		math.BindSkill(skill->GetStats(), skill->GetLevel());
+		if (skill->Get() != nullptr) {
+			math.BindSkillPrototypeLevel(skill->Get()->Level);
+		}
+
+		auto useWeaponDamage = math.SkillIs("UseWeaponDamage", "Yes");
+		auto level = lua_tonumber(L, 8);
+		auto effectiveLevel = (attacker != nullptr && level < 0) ? attacker->Level : level;
+		if ((useWeaponDamage && attacker == nullptr)
+			|| (effectiveLevel == 0 && math.SkillString("OverrideSkillLevel"))) {
+			return CallLuaImplementation(L);
+		}
+
+		auto stealthed = lua_toboolean(L, 5) != 0;
+		auto attackerPos = GetPosition(L, 6);
+		auto targetPos = GetPosition(L, 7);
+		auto noRandomization = lua_toboolean(L, 9) != 0;
+
+		if (useWeaponDamage && attacker->GetMainWeapon() == nullptr && attacker->GetOffHandWeapon() != nullptr) {
+			return CallLuaImplementation(L);
+		}
+
+		return math.GetSkillDamage(attacker, stealthed, attackerPos, targetPos, level, noRandomization);
+	}
+
+	// ComputeCharacterHit(luaImpl, target, attacker, weapon, damageList, hitType, noHitRoll, forceReduceDurability,
+	//     hit, alwaysBackstab, highGroundFlag, criticalRoll)
+	int NativeComputeCharacterHit(lua_State * L)
+	{
+		auto target = ObjectProxy<CDivinityStats_Character>::AsUserData(L, 2);
+		CDivinityStats_Character * attacker;
+		auto weapon = ObjectProxy<CDivinityStats_Item>::AsUserData(L, 4);
+		auto damageList = DamageList::AsUserData(L, 5);
+		if (target == nullptr
+			|| !GetOptionalCharacter(L, 3, attacker)
+			|| (weapon == nullptr && !lua_isnil(L, 4))
+			|| damageList == nullptr
+			|| lua_type(L, 9) != LUA_TTABLE) {
+			return CallLuaImplementation(L);
+		}
+
+		auto const hitIdx = 9;
+		NativeHitInfo hit;
+		hit.EffectFlags = GetHitField(L, hitIdx, "EffectFlags");
+		hit.TotalDamageDone = GetHitField(L, hitIdx, "TotalDamageDone");
+		hit.ArmorAbsorption = GetHitField(L, hitIdx, "ArmorAbsorption");
+		lua_getfield(L, hitIdx, "DamageType");
+		hit.DamageType = GetOptionalEnum<DamageType>(L, -1);
+		lua_pop(L, 1);
+
+		NativeGameMath math(L);
+		math.ComputeCharacterHit(hitIdx, hit, target->Get(L), attacker, weapon ? weapon->Get(L) : nullptr,
+			damageList->Get(), GetOptionalEnum<HitType>(L, 6), lua_toboolean(L, 7) != 0, lua_toboolean(L, 8) != 0,
+			lua_toboolean(L, 10) != 0, GetOptionalEnum<HighGroundBonus>(L, 11), GetOptionalEnum<CriticalRoll>(L, 12));
+
+		lua_pushvalue(L, hitIdx); // stack: hit
+		settable(L, "EffectFlags", hit.EffectFlags);
+		settable(L, "DamageMultiplier", hit.DamageMultiplier);
+		settable(L, "TotalDamageDone", hit.TotalDamageDone);
+		settable(L, "ArmorAbsorption", hit.ArmorAbsorption);
+		if (hit.LifeSteal) {
+			settable(L, "LifeSteal", *hit.LifeSteal);
+		}
+
+		return 1;
+	}
+
+
+	int LuaRandom(lua_State * L);
+
+	// Appends a printable form of a value to the stream, so the results of the two implementations can be compared
+	void DescribeMathValue(lua_State * L, int index, std::ostringstream & ss, int depth)
+	{
+		index = lua_absindex(L, index);
+		switch (lua_type(L, index)) {
+		case LUA_TNIL:
+			ss << "nil";
+			break;
+
+		case LUA_TBOOLEAN:
+			ss << (lua_toboolean(L, index) ? "true" : "false");
+			break;
+
+		case LUA_TNUMBER:
+			if (lua_isinteger(L, index)) {
+				ss << lua_tointeger(L, index);
+			} else {
+				ss << std::setprecision(6) << lua_tonumber(L, index);
+			}
+			break;
+
+		case LUA_TSTRING:
+			ss << '"' << lua_tostring(L, index) << '"';
+			break;
+
+		case LUA_TTABLE:
+		{
+			if (depth >= 2) {
+				ss << "{...}";
+				break;
+			}
+
+			// Table traversal order may differ between the two results, so keys are sorted
+			std::vector<STDString> keys;
+			lua_pushnil(L); // stack: key
+			while (lua_next(L, index) != 0) { // stack: key, value
+				lua_pop(L, 1); // stack: key
+				if (lua_type(L, -1) == LUA_TSTRING) {
+					keys.push_back(lua_tostring(L, -1));
+				}
+			}
+
+			std::sort(keys.begin(), keys.end());
+			ss << '{';
+			for (auto const & key : keys) {
+				lua_getfield(L, index, key.c_str()); // stack: value
+				ss << key << '=';
+				DescribeMathValue(L, -1, ss, depth + 1);
+				ss << ' ';
+				lua_pop(L, 1); // stack: -
+			}
+			ss << '}';
+			break;
+		}
+
+		default:
+		{
+			auto damageList = DamageList::AsUserData(L, index);
+			if (damageList != nullptr) {
+				auto const & damages = damageList->Get();
+				ss << '[';
+				for (uint32_t i = 0; i < damages.Size; i++) {
+					auto damageType = EnumInfo<DamageType>::Find(damages[i].DamageType);
+					ss << (damageType ? damageType->Str : "?") << ':' << damages[i].Amount << ' ';
+				}
+				ss << ']';
+			} else {
+				ss << luaL_typename(L, index);
+			}
+			break;
+		}
+		}
+	}
+
+	// Pushes a copy of the value at index if the math functions may modify it (damage lists and tables),
+	// or the value itself otherwise. Returns whether a copy was made.
+	bool PushMathArgumentCopy(lua_State * L, int index)
+	{
+		auto damageList = DamageList::AsUserData(L, index);
+		if (damageList != nullptr) {
+			auto copy = DamageList::New(L); // stack: copy
+			auto const & damages = damageList->Get();
+			for (uint32_t i = 0; i < damages.Size; i++) {
+				copy->Get().SafeAdd(damages[i]);
+			}
+			return true;
+		}
+
+		if (lua_type(L, index) == LUA_TTABLE) {
+			lua_newtable(L); // stack: copy
+			lua_pushnil(L); // stack: copy, nil
+			while (lua_next(L, index) != 0) { // stack: copy, key, value
+				lua_pushvalue(L, -2); // stack: copy, key, value, key
+				lua_insert(L, -2); // stack: copy, key, key, value
+				lua_rawset(L, -4); // stack: copy, key
+			}
+			return true;
+		}
+
+		lua_pushvalue(L, index);
+		return false;
+	}
+
+	// Comparison mode for validating the native implementation (CompareNativeGameMath developer option).
+	// math.random() is redirected to the extender RNG (used by Ext.Random()), so its rolls can be replayed.
+	// The Lua implementation is called first, on a copy of the arguments; the RNG is then rewound and the
+	// native implementation is called on the original arguments. Differences in the results, the modified
+	// arguments or the number of random draws are logged; the results of the native implementation are returned.
+	// Upvalues: native function, function name
+	int CompareWithLuaImplementation(lua_State * L)
+	{
+		auto & rng = gOsirisProxy->GetCurrentExtensionState()->OsiRng;
+		auto name = lua_tostring(L, lua_upvalueindex(2));
+		auto numArgs = lua_gettop(L); // stack: luaImpl, args...
+		luaL_checkstack(L, numArgs * 3 + 4, nullptr);
+
+		lua_getglobal(L, "math"); // stack: luaImpl, args..., math
+		auto mathIdx = lua_gettop(L);
+		lua_getfield(L, mathIdx, "random"); // stack: luaImpl, args..., math, random
+
+		// The copy of argument i is at copiesIdx + i
+		auto copiesIdx = lua_gettop(L) - 1;
+		std::vector<int> modifiedArgs;
+		for (auto i = 2; i <= numArgs; i++) {
+			if (PushMathArgumentCopy(L, i)) { // stack: luaImpl, args..., math, random, copies...
+				modifiedArgs.push_back(i);
+			}
+		}
+
+		lua_pushcfunction(L, &LuaRandom);
+		lua_setfield(L, mathIdx, "random");
+
+		auto initialRng = rng;
+		auto luaIdx = lua_gettop(L) + 1;
+		lua_pushvalue(L, 1); // stack: luaImpl, args..., math, random, copies..., luaImpl
+		for (auto i = 2; i <= numArgs; i++) {
+			lua_pushvalue(L, copiesIdx + i); // stack: luaImpl, args..., math, random, copies..., luaImpl, copies...
+		}
+		auto status = lua_pcall(L, numArgs - 1, LUA_MULTRET, 0); // stack: luaImpl, args..., math, random, copies..., luaResults...
+		auto luaRng = rng;
+		rng = initialRng;
+
+		std::ostringstream luaDesc;
+		if (status != LUA_OK) {
+			luaDesc << "error: " << lua_tostring(L, -1);
+		} else {
+			for (auto i = luaIdx; i <= lua_gettop(L); i++) {
+				DescribeMathValue(L, i, luaDesc, 0);
+				luaDesc << "; ";
+			}
+
+			for (auto arg : modifiedArgs) {
+				luaDesc << "arg" << arg - 1 << '=';
+				DescribeMathValue(L, copiesIdx + arg, luaDesc, 0);
+				luaDesc << "; ";
+			}
+		}
+
+		auto nativeIdx = lua_gettop(L) + 1;
+		lua_pushvalue(L, lua_upvalueindex(1));
+		for (auto i = 1; i <= numArgs; i++) {
+			lua_pushvalue(L, i);
+		}
+		auto nativeStatus = lua_pcall(L, numArgs, LUA_MULTRET, 0); // stack: luaImpl, args..., math, random, copies..., luaResults..., nativeResults...
+
+		lua_pushvalue(L, mathIdx + 1);
+		lua_setfield(L, mathIdx, "random");
+		if (nativeStatus != LUA_OK) {
+			return lua_error(L);
+		}
+
+		auto numResults = lua_gettop(L) - nativeIdx + 1;
+
+		std::ostringstream nativeDesc;
+		for (auto i = nativeIdx; i <= lua_gettop(L); i++) {
+			DescribeMathValue(L, i, nativeDesc, 0);
+			nativeDesc << "; ";
+		}
+
+		for (auto arg : modifiedArgs) {
+			nativeDesc << "arg" << arg - 1 << '=';
+			DescribeMathValue(L, arg, nativeDesc, 0);
+			nativeDesc << "; ";
+		}
+
+		auto luaText = luaDesc.str();
+		auto nativeText = nativeDesc.str();
+		if (luaText != nativeText) {
+			OsiWarn("Game.Math." << name << ": Lua and native results differ; Lua: " << luaText << " native: " << nativeText);
+		} else if (luaRng != rng) {
+			OsiWarn("Game.Math." << name << ": Lua and native implementations used a different number of random rolls");
+		}
+
+		return numResults;
+	}
+
+	void RegisterGameMathLib(lua_State * L)
+	{
+		static const luaL_Reg mathLib[] = {
+			{"CalculateHitChance", NativeCalculateHitChance},
+			{"GetSkillDamage", NativeGetSkillDamage},
+			{"ComputeCharacterHit", NativeComputeCharacterHit},
+			{0,0}
+		};
+
+		lua_getglobal(L, "Ext"); // stack: Ext
+		luaL_newlib(L, mathLib); // stack: Ext, lib
+
+		auto const & config = gOsirisProxy->GetConfig();
+		if (config.DeveloperMode && config.CompareNativeGameMath) {
+			for (auto func = mathLib; func->name != nullptr; func++) {
+				lua_pushcfunction(L, func->func); // stack: Ext, lib, native
+				push(L, func->name); // stack: Ext, lib, native, name
+				lua_pushcclosure(L, &CompareWithLuaImplementation, 2); // stack: Ext, lib, compare
+				lua_setfield(L, -2, func->name); // stack: Ext, lib
+			}
+		}
+
+		lua_setfield(L, -2, "_NativeMath"); // stack: Ext
+		lua_pop(L, 1); // stack: -
+	}
+}
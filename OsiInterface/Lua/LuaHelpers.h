@@ -561,6 +561,134 @@ namespace dse::lua
 		}
 	};
 
+	// Pool of reusable userdata objects for engine callbacks.
+	// Engine callbacks (hit calculation, skill damage, hit chance, etc.) fire many times per frame;
+	// instead of allocating new userdata for each call, pooled objects are kept alive in the registry
+	// and rebound to the native objects of the current call via T::Rebind().
+	template <class T>
+	class UserdataPool
+	{
+	public:
+		// Pushes an idle pooled object to the stack, or a new object if all pooled objects are in use.
+		template <class... Args>
+		T * Push(lua_State * L, uint32_t & slot, Args... args)
+		{
+			if (idle_.empty()) {
+				auto obj = T::New(L, args...);
+				slot = (uint32_t)slots_.size();
+				slots_.push_back(Slot{ RegistryEntry(L, -1), obj });
+				return obj;
+			}
+
+			slot = idle_.back();
+			idle_.pop_back();
+			auto & entry = slots_[slot];
+			entry.Ref.Push();
+			entry.Object->Rebind(args...);
+			return entry.Object;
+		}
+
+		void Release(uint32_t slot)
+		{
+			auto obj = slots_[slot].Object;
+			if constexpr (std::is_base_of_v<Pushable<PushPolicy::Unbind>, T>) {
+				obj->Unbind();
+			}
+
+			idle_.push_back(slot);
+		}
+
+		// Must be called before the owning Lua state is closed
+		void Clear()
+		{
+			slots_.clear();
+			idle_.clear();
+		}
+
+	private:
+		struct Slot
+		{
+			RegistryEntry Ref;
+			T * Object;
+		};
+
+		std::vector<Slot> slots_;
+		std::vector<uint32_t> idle_;
+	};
+
+	// Pool of reusable argument tables for engine callbacks.
+	// Tables are cleared before they're handed out again.
+	class TablePool
+	{
+	public:
+		void Push(lua_State * L, uint32_t & slot);
+		void Release(uint32_t slot);
+		void Clear();
+
+	private:
+		std::vector<RegistryEntry> tables_;
+		std::vector<uint32_t> idle_;
+	};
+
+	// Returns a pooled object to its pool when the pin goes out of scope
+	template <class TPool>
+	class PooledPin
+	{
+	public:
+		inline PooledPin()
+			: pool_(nullptr), slot_(0)
+		{}
+
+		inline PooledPin(TPool & pool, uint32_t slot)
+			: pool_(&pool), slot_(slot)
+		{}
+
+		inline ~PooledPin()
+		{
+			if (pool_) pool_->Release(slot_);
+		}
+
+		inline PooledPin(PooledPin const &) = delete;
+
+		inline PooledPin(PooledPin && other)
+			: pool_(other.pool_), slot_(other.slot_)
+		{
+			other.pool_ = nullptr;
+		}
+
+		PooledPin & operator = (PooledPin const &) = delete;
+
+		inline PooledPin & operator = (PooledPin && other)
+		{
+			if (pool_) pool_->Release(slot_);
+			pool_ = other.pool_;
+			slot_ = other.slot_;
+			other.pool_ = nullptr;
+			return *this;
+		}
+
+	private:
+		TPool * pool_;
+		uint32_t slot_;
+	};
+
+	// Pushes a pooled userdata object and returns a pin that releases it after the call
+	template <class T, class... Args>
+	inline PooledPin<UserdataPool<T>> PushPooled(lua_State * L, UserdataPool<T> & pool, T *& object, Args... args)
+	{
+		uint32_t slot;
+		object = pool.Push(L, slot, args...);
+		return PooledPin<UserdataPool<T>>(pool, slot);
+	}
+
+	// Pushes an empty pooled table and returns a pin that releases it after the call
+	inline PooledPin<TablePool> PushPooledTable(lua_State * L, TablePool & pool)
+	{
+		uint32_t slot;
+		pool.Push(L, slot);
+		return PooledPin<TablePool>(pool, slot);
+	}
+
 	template <class T>
 	inline std::optional<T *> safe_get_userdata(lua_State * L, int index)
 	{
@@ -0,0 +1,689 @@
+#include <stdafx.h>
+#include <Lua/LuaHelpers.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace dse::lua
+{
+	// Parses JSON text directly onto the Lua stack, without building a document tree first.
+	// Accepts the same extensions as the jsoncpp reader we used previously (comments, trailing data after the root value).
+	class JsonReader
+	{
+	public:
+		static constexpr int MaxDepth = 1000;
+
+		inline JsonReader(lua_State * L, char const * json, std::size_t length)
+			: L_(L), begin_(json), cur_(json), end_(json + length)
+		{}
+
+		// Pushes the parsed value to the stack; raises a Lua error if the document is malformed
+		void Parse()
+		{
+			ParseValue();
+		}
+
+	private:
+		lua_State * L_;
+		char const * begin_;
+		char const * cur_;
+		char const * end_;
+		int depth_{ 0 };
+
+		[[noreturn]] void Error(char const * msg)
+		{
+			luaL_error(L_, "Unable to parse JSON: %s (at offset %d)", msg, (int)(cur_ - begin_));
+			// luaL_error() doesn't return
+			abort();
+		}
+
+		void SkipWhitespace()
+		{
+			while (cur_ < end_) {
+				switch (*cur_) {
+				case ' ':
+				case '\t':
+				case '\r':
+				case '\n':
+					cur_++;
+					break;
+
+				case '/':
+					if (cur_ + 1 < end_ && cur_[1] == '/') {
+						while (cur_ < end_ && *cur_ != '\n') cur_++;
+					} else if (cur_ + 1 < end_ && cur_[1] == '*') {
+						cur_ += 2;
+						while (cur_ + 1 < end_ && !(cur_[0] == '*' && cur_[1] == '/')) cur_++;
+						if (cur_ + 1 >= end_) {
+							Error("Unterminated comment");
+						}
+						cur_ += 2;
+					} else {
+						return;
+					}
+					break;
+
+				default:
+					return;
+				}
+			}
+		}
+
+		void ParseValue()
+		{
+			SkipWhitespace();
+			if (cur_ == end_) {
+				Error("Unexpected end of input");
+			}
+
+			switch (*cur_) {
+			case '{':
+				ParseObject();
+				break;
+
+			case '[':
+				ParseArray();
+				break;
+
+			case '"':
+				ParseString();
+				break;
+
+			case 't':
+				ParseLiteral("true");
+				lua_pushboolean(L_, 1);
+				break;
+
+			case 'f':
+				ParseLiteral("false");
+				lua_pushboolean(L_, 0);
+				break;
+
+			case 'n':
+				ParseLiteral("null");
+				lua_pushnil(L_);
+				break;
+
+			default:
+				if (*cur_ == '-' || (*cur_ >= '0' && *cur_ <= '9')) {
+					ParseNumber();
+				} else {
+					Error("Syntax error: value, object or array expected");
+				}
+			}
+		}
+
+		void ParseLiteral(std::string_view literal)
+		{
+			if ((std::size_t)(end_ - cur_) < literal.size()
+				|| std::string_view(cur_, literal.size()) != literal) {
+				Error("Syntax error: value, object or array expected");
+			}
+
+			cur_ += literal.size();
+		}
+
+		void EnterContainer()
+		{
+			if (++depth_ > MaxDepth) {
+				Error("Exceeded nesting limit");
+			}
+
+			luaL_checkstack(L_, 3, "JSON nesting too deep");
+			cur_++;
+		}
+
+		void ParseObject()
+		{
+			EnterContainer();
+			lua_newtable(L_); // stack: object
+
+			for (;;) {
+				SkipWhitespace();
+				if (cur_ < end_ && *cur_ == '}') {
+					cur_++;
+					break;
+				}
+
+				if (cur_ == end_ || *cur_ != '"') {
+					Error("Missing '}' or object member name");
+				}
+
+				ParseString(); // stack: object, key
+				SkipWhitespace();
+				if (cur_ == end_ || *cur_ != ':') {
+					Error("Missing ':' after object member name");
+				}
+
+				cur_++;
+				ParseValue(); // stack: object, key, value
+				lua_rawset(L_, -3); // stack: object
+
+				SkipWhitespace();
+				if (cur_ < end_ && *cur_ == ',') {
+					cur_++;
+				} else if (cur_ < end_ && *cur_ == '}') {
+					cur_++;
+					break;
+				} else {
+					Error("Missing ',' or '}' in object declaration");
+				}
+			}
+
+			depth_--;
+		}
+
+		void ParseArray()
+		{
+			EnterContainer();
+			lua_newtable(L_); // stack: array
+
+			lua_Integer index = 1;
+			for (;;) {
+				SkipWhitespace();
+				if (cur_ < end_ && *cur_ == ']') {
+					cur_++;
+					break;
+				}
+
+				ParseValue(); // stack: array, value
+				lua_rawseti(L_, -2, index++); // stack: array
+
+				SkipWhitespace();
+				if (cur_ < end_ && *cur_ == ',') {
+					cur_++;
+				} else if (cur_ < end_ && *cur_ == ']') {
+					cur_++;
+					break;
+				} else {
+					Error("Missing ',' or ']' in array declaration");
+				}
+			}
+
+			depth_--;
+		}
+
+		unsigned ParseHex4()
+		{
+			if (end_ - cur_ < 4) {
+				Error("Bad unicode escape sequence in string: four digits expected");
+			}
+
+			unsigned value = 0;
+			for (int i = 0; i < 4; i++) {
+				char c = *cur_++;
+				value <<= 4;
+				if (c >= '0' && c <= '9') {
+					value |= c - '0';
+				} else if (c >= 'a' && c <= 'f') {
+					value |= c - 'a' + 10;
+				} else if (c >= 'A' && c <= 'F') {
+					value |= c - 'A' + 10;
+				} else {
+					Error("Bad unicode escape sequence in string: hexadecimal digit expected");
+				}
+			}
+
+			return value;
+		}
+
+		void AddCodePoint(luaL_Buffer & buf, unsigned cp)
+		{
+			if (cp < 0x80) {
+				luaL_addchar(&buf, (char)cp);
+			} else if (cp < 0x800) {
+				luaL_addchar(&buf, (char)(0xC0 | (cp >> 6)));
+				luaL_addchar(&buf, (char)(0x80 | (cp & 0x3F)));
+			} else if (cp < 0x10000) {
+				luaL_addchar(&buf, (char)(0xE0 | (cp >> 12)));
+				luaL_addchar(&buf, (char)(0x80 | ((cp >> 6) & 0x3F)));
+				luaL_addchar(&buf, (char)(0x80 | (cp & 0x3F)));
+			} else {
+				luaL_addchar(&buf, (char)(0xF0 | (cp >> 18)));
+				luaL_addchar(&buf, (char)(0x80 | ((cp >> 12) & 0x3F)));
+				luaL_addchar(&buf, (char)(0x80 | ((cp >> 6) & 0x3F)));
+				luaL_addchar(&buf, (char)(0x80 | (cp & 0x3F)));
+			}
+		}
+
+		void ParseString()
+		{
+			cur_++;
+			auto start = cur_;
+			while (cur_ < end_ && *cur_ != '"' && *cur_ != '\\') cur_++;
+
+			if (cur_ == end_) {
+				Error("Missing '\"' at end of string");
+			}
+
+			// Fast path: no escape sequences
+			if (*cur_ == '"') {
+				lua_pushlstring(L_, start, cur_ - start);
+				cur_++;
+				return;
+			}
+
+			luaL_Buffer buf;
+			luaL_buffinit(L_, &buf);
+			luaL_addlstring(&buf, start, cur_ - start);
+
+			while (cur_ < end_ && *cur_ != '"') {
+				if (*cur_ != '\\') {
+					start = cur_;
+					while (cur_ < end_ && *cur_ != '"' && *cur_ != '\\') cur_++;
+					luaL_addlstring(&buf, start, cur_ - start);
+					continue;
+				}
+
+				cur_++;
+				if (cur_ == end_) break;
+
+				char escape = *cur_++;
+				switch (escape) {
+				case '"': luaL_addchar(&buf, '"'); break;
+				case '\\': luaL_addchar(&buf, '\\'); break;
+				case '/': luaL_addchar(&buf, '/'); break;
+				case 'b': luaL_addchar(&buf, '\b'); break;
+				case 'f': luaL_addchar(&buf, '\f'); break;
+				case 'n': luaL_addchar(&buf, '\n'); break;
+				case 'r': luaL_addchar(&buf, '\r'); break;
+				case 't': luaL_addchar(&buf, '\t'); break;
+
+				case 'u':
+				{
+					auto cp = ParseHex4();
+					if (cp >= 0xD800 && cp <= 0xDBFF) {
+						if (end_ - cur_ < 6 || cur_[0] != '\\' || cur_[1] != 'u') {
+							Error("Additional six characters expected to parse unicode surrogate pair");
+						}
+
+						cur_ += 2;
+						auto low = ParseHex4();
+						if (low < 0xDC00 || low > 0xDFFF) {
+							Error("Expecting another \\u token to begin the second half of a unicode surrogate pair");
+						}
+
+						cp = 0x10000 + ((cp & 0x3FF) << 10) + (low & 0x3FF);
+					}
+
+					AddCodePoint(buf, cp);
+					break;
+				}
+
+				default:
+					Error("Bad escape sequence in string");
+				}
+			}
+
+			if (cur_ == end_) {
+				Error("Missing '\"' at end of string");
+			}
+
+			cur_++;
+			luaL_pushresult(&buf);
+		}
+
+		void ParseNumber()
+		{
+			auto start = cur_;
+			bool negative = false;
+			if (*cur_ == '-') {
+				negative = true;
+				cur_++;
+			}
+
+			if (cur_ == end_ || *cur_ < '0' || *cur_ > '9') {
+				Error("Invalid number");
+			}
+
+			uint64_t value = 0;
+			bool overflow = false;
+			while (cur_ < end_ && *cur_ >= '0' && *cur_ <= '9') {
+				unsigned digit = *cur_++ - '0';
+				if (value > (UINT64_MAX - digit) / 10) {
+					overflow = true;
+				} else {
+					value = value * 10 + digit;
+				}
+			}
+
+			bool isFloat = false;
+			bool negativeExponent = false;
+			if (cur_ < end_ && *cur_ == '.') {
+				isFloat = true;
+				cur_++;
+				while (cur_ < end_ && *cur_ >= '0' && *cur_ <= '9') cur_++;
+			}
+
+			if (cur_ < end_ && (*cur_ == 'e' || *cur_ == 'E')) {
+				isFloat = true;
+				cur_++;
+				if (cur_ < end_ && (*cur_ == '+' || *cur_ == '-')) {
+					negativeExponent = (*cur_ == '-');
+					cur_++;
+				}
+				if (cur_ == end_ || *cur_ < '0' || *cur_ > '9') {
+					Error("Invalid number");
+				}
+				while (cur_ < end_ && *cur_ >= '0' && *cur_ <= '9') cur_++;
+			}
+
+			if (!isFloat && !overflow) {
+				if (!negative && value <= (uint64_t)LUA_MAXINTEGER) {
+					lua_pushinteger(L_, (lua_Integer)value);
+					return;
+				} else if (negative && value <= (uint64_t)LUA_MAXINTEGER + 1) {
+					lua_pushinteger(L_, (lua_Integer)(0 - value));
+					return;
+				}
+			}
+
+			// from_chars() doesn't depend on the decimal separator of the current locale
+			double number{ 0.0 };
+			auto result = std::from_chars(start, cur_, number);
+			if (result.ec == std::errc::result_out_of_range) {
+				// Values that don't fit in a double are rounded to zero or infinity, like strtod() does
+				if (negativeExponent) {
+					number = negative ? -0.0 : 0.0;
+				} else {
+					number = negative ? -HUGE_VAL : HUGE_VAL;
+				}
+			} else if (result.ec != std::errc() || result.ptr != cur_) {
+				Error("Invalid number");
+			}
+
+			lua_pushnumber(L_, number);
+		}
+	};
+
+
+	// Serializes a Lua value to JSON text without building a document tree first.
+	// Object keys are sorted so the output is deterministic.
+	class JsonWriter
+	{
+	public:
+		static constexpr int MaxDepth = 64;
+
+		inline JsonWriter(lua_State * L, std::string & buf, bool beautify)
+			: L_(L), buf_(buf), beautify_(beautify)
+		{}
+
+		void Write(int index)
+		{
+			WriteValue(lua_absindex(L_, index), 0);
+		}
+
+	private:
+		lua_State * L_;
+		std::string & buf_;
+		bool beautify_;
+
+		void WriteValue(int index, int depth)
+		{
+			if (depth > MaxDepth) {
+				throw std::runtime_error("Recursion depth exceeded while stringifying JSON");
+			}
+
+			switch (lua_type(L_, index)) {
+			case LUA_TNIL:
+				buf_ += "null";
+				break;
+
+			case LUA_TBOOLEAN:
+				buf_ += lua_toboolean(L_, index) ? "true" : "false";
+				break;
+
+			case LUA_TNUMBER:
+				if (lua_isinteger(L_, index)) {
+					char num[32];
+					auto len = snprintf(num, sizeof(num), "%lld", (long long)lua_tointeger(L_, index));
+					buf_.append(num, len);
+				} else {
+					WriteDouble(lua_tonumber(L_, index));
+				}
+				break;
+
+			case LUA_TSTRING:
+			{
+				size_t len;
+				auto str = lua_tolstring(L_, index, &len);
+				WriteString(str, len);
+				break;
+			}
+
+			case LUA_TTABLE:
+				WriteTable(index, depth);
+				break;
+
+			case LUA_TLIGHTUSERDATA:
+			case LUA_TFUNCTION:
+			case LUA_TUSERDATA:
+			case LUA_TTHREAD:
+			default:
+				throw std::runtime_error("Attempted to stringify a lightuserdata, userdata, function or thread value");
+			}
+		}
+
+		void WriteDouble(double value)
+		{
+			if (std::isnan(value)) {
+				buf_ += "null";
+				return;
+			}
+
+			if (std::isinf(value)) {
+				buf_ += value < 0 ? "-1e+9999" : "1e+9999";
+				return;
+			}
+
+			char num[40];
+			auto len = snprintf(num, sizeof(num), "%.17g", value);
+			// Don't depend on the decimal separator of the current locale
+			std::replace(num, num + len, ',', '.');
+			buf_.append(num, len);
+			if (std::find_if(num, num + len, [](char c) { return c == '.' || c == 'e'; }) == num + len) {
+				buf_ += ".0";
+			}
+		}
+
+		void WriteString(char const * str, std::size_t len)
+		{
+			static char const * hexDigits = "0123456789abcdef";
+
+			buf_ += '"';
+			auto end = str + len;
+			while (str < end) {
+				auto start = str;
+				while (str < end && *str != '"' && *str != '\\' && (unsigned char)*str >= 0x20) str++;
+				buf_.append(start, str - start);
+				if (str == end) break;
+
+				char c = *str++;
+				switch (c) {
+				case '"': buf_ += "\\\""; break;
+				case '\\': buf_ += "\\\\"; break;
+				case '\b': buf_ += "\\b"; break;
+				case '\f': buf_ += "\\f"; break;
+				case '\n': buf_ += "\\n"; break;
+				case '\r': buf_ += "\\r"; break;
+				case '\t': buf_ += "\\t"; break;
+				default:
+					buf_ += "\\u00";
+					buf_ += hexDigits[(c >> 4) & 0xf];
+					buf_ += hexDigits[c & 0xf];
+					break;
+				}
+			}
+			buf_ += '"';
+		}
+
+		void NewLine(int depth)
+		{
+			if (beautify_) {
+				buf_ += '\n';
+				buf_.append(depth, '\t');
+			}
+		}
+
+		// Tables with the keys 1..n are written as arrays, everything else as objects
+		bool IsArray(int index, lua_Integer & length)
+		{
+			lua_Integer count = 0, maxKey = 0;
+			bool isArray = true;
+			lua_pushnil(L_); // stack: key
+			while (lua_next(L_, index) != 0) { // stack: key, value
+				count++;
+				if (isArray) {
+					if (lua_isinteger(L_, -2) && lua_tointeger(L_, -2) >= 1) {
+						maxKey = std::max(maxKey, lua_tointeger(L_, -2));
+					} else {
+						isArray = false;
+					}
+				}
+
+				lua_pop(L_, 1); // stack: key
+			}
+
+			length = count;
+			return isArray && maxKey == count;
+		}
+
+		void WriteTable(int index, int depth)
+		{
+			luaL_checkstack(L_, 6, "JSON nesting too deep");
+
+			lua_Integer length;
+			if (IsArray(index, length)) {
+				WriteArray(index, length, depth);
+			} else {
+				WriteObject(index, length, depth);
+			}
+		}
+
+		void WriteArray(int index, lua_Integer length, int depth)
+		{
+			if (length == 0) {
+				buf_ += "[]";
+				return;
+			}
+
+			buf_ += '[';
+			for (lua_Integer i = 1; i <= length; i++) {
+				if (i > 1) buf_ += ',';
+				NewLine(depth + 1);
+				lua_rawgeti(L_, index, i); // stack: value
+				WriteValue(lua_gettop(L_), depth + 1);
+				lua_pop(L_, 1); // stack: -
+			}
+
+			NewLine(depth);
+			buf_ += ']';
+		}
+
+		void WriteObject(int index, lua_Integer count, int depth)
+		{
+			// Collect keys and their string forms; the name table keeps the strings alive while sorting
+			lua_createtable(L_, (int)count, 0); // stack: keys
+			auto keysIdx = lua_gettop(L_);
+			lua_createtable(L_, (int)count, 0); // stack: keys, names
+			auto namesIdx = lua_gettop(L_);
+
+			lua_Integer numKeys = 0;
+			lua_pushnil(L_); // stack: keys, names, key
+			while (lua_next(L_, index) != 0) { // stack: keys, names, key, value
+				lua_pop(L_, 1); // stack: keys, names, key
+				auto keyType = lua_type(L_, -1);
+				if (keyType != LUA_TSTRING && keyType != LUA_TNUMBER) {
+					throw std::runtime_error("Can only stringify string or number table keys");
+				}
+
+				numKeys++;
+				lua_pushvalue(L_, -1); // stack: keys, names, key, key
+				lua_rawseti(L_, keysIdx, numKeys); // stack: keys, names, key
+				lua_pushvalue(L_, -1); // stack: keys, names, key, key
+				lua_tostring(L_, -1); // converts numeric keys in place
+				lua_rawseti(L_, namesIdx, numKeys); // stack: keys, names, key
+			}
+
+			std::vector<std::pair<std::string_view, lua_Integer>> names;
+			names.reserve((std::size_t)numKeys);
+			for (lua_Integer i = 1; i <= numKeys; i++) {
+				lua_rawgeti(L_, namesIdx, i); // stack: keys, names, name
+				size_t len;
+				auto name = lua_tolstring(L_, -1, &len);
+				names.push_back(std::make_pair(std::string_view(name, len), i));
+				lua_pop(L_, 1); // stack: keys, names
+			}
+
+			std::sort(names.begin(), names.end());
+
+			buf_ += '{';
+			for (std::size_t i = 0; i < names.size(); i++) {
+				if (i > 0) buf_ += ',';
+				NewLine(depth + 1);
+				WriteString(names[i].first.data(), names[i].first.size());
+				buf_ += beautify_ ? " : " : ":";
+
+				lua_rawgeti(L_, keysIdx, names[i].second); // stack: keys, names, key
+				lua_rawget(L_, index); // stack: keys, names, value
+				WriteValue(lua_gettop(L_), depth + 1);
+				lua_pop(L_, 1); // stack: keys, names
+			}
+
+			if (!names.empty()) {
+				NewLine(depth);
+			}
+			buf_ += '}';
+
+			lua_pop(L_, 2); // stack: -
+		}
+	};
+
+
+	int JsonParse(lua_State * L)
+	{
+		size_t length;
+		auto json = luaL_checklstring(L, 1, &length);
+
+		JsonReader reader(L, json, length);
+		reader.Parse();
+		return 1;
+	}
+
+	int JsonStringify(lua_State * L)
+	{
+		int nargs = lua_gettop(L);
+		if (nargs < 1 || nargs > 2) {
+			return luaL_error(L, "JsonStringify expects at most two parameters.");
+		}
+
+		bool beautify{ true };
+		if (nargs >= 2) {
+			beautify = lua_toboolean(L, 2) == 1;
+		}
+
+		// Reuse the output buffer between calls to avoid reallocating it for large documents
+		static thread_local std::string buffer;
+		buffer.clear();
+
+		try {
+			JsonWriter writer(L, buffer, beautify);
+			writer.Write(1);
+		} catch (std::runtime_error & e) {
+			return luaL_error(L, "%s", e.what());
+		}
+
+		lua_pushlstring(L, buffer.data(), buffer.size());
+
+		// Don't hold on to huge buffers indefinitely
+		if (buffer.capacity() > 16 * 1024 * 1024) {
+			buffer = std::string();
+		}
+
+		return 1;
+	}
+}
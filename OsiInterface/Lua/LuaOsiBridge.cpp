@@ -7,7 +7,52 @@
 
 namespace dse::lua
 {
-	void LuaToOsi(lua_State * L, int i, TypedValue & tv, ValueType osiType, bool allowNil)
+	void * OsiScratchArena::Allocate(std::size_t size, std::size_t alignment)
+	{
+		if (currentSegment_ < segments_.size()) {
+			auto & segment = segments_[currentSegment_];
+			auto offset = (offset_ + alignment - 1) & ~(alignment - 1);
+			if (offset + size <= segment.Size) {
+				offset_ = offset + size;
+				return segment.Data.get() + offset;
+			}
+
+			currentSegment_++;
+		}
+
+		// Segments are allocated with the default new alignment, so the start of each segment is aligned
+		if (currentSegment_ >= segments_.size() || segments_[currentSegment_].Size < size) {
+			Segment segment;
+			segment.Size = std::max(SegmentSize, size);
+			segment.Data = std::make_unique<uint8_t[]>(segment.Size);
+			segments_.insert(segments_.begin() + currentSegment_, std::move(segment));
+		}
+
+		offset_ = size;
+		return segments_[currentSegment_].Data.get();
+	}
+
+	char * OsiScratchArena::CopyString(char const * str, std::size_t length)
+	{
+		auto copy = reinterpret_cast<char *>(Allocate(length + 1, 1));
+		memcpy(copy, str, length);
+		copy[length] = 0;
+		return copy;
+	}
+
+	char const * OsiStringPool::Intern(char const * str, std::size_t length)
+	{
+		std::lock_guard lock(mutex_);
+		return strings_.insert(STDString(str, length)).first->c_str();
+	}
+
+	void OsiStringPool::Clear()
+	{
+		std::lock_guard lock(mutex_);
+		strings_.clear();
+	}
+
+	void LuaToOsi(lua_State * L, int i, TypedValue & tv, ValueType osiType, OsiScratchArena * arena, bool allowNil)
 	{
 		tv.VMT = gOsirisProxy->GetGlobals().TypedValueVMT;
 		tv.TypeId = (uint32_t)osiType;
@@ -63,12 +108,20 @@ namespace dse::lua
 				luaL_error(L, "String expected for argument %d, got %s", i, lua_typename(L, type));
 			}
 
-			// TODO - not sure if we're the owners of the string or the TypedValue is
-			tv.Value.Val.String = _strdup(lua_tostring(L, i));
-			if (tv.Value.Val.String == nullptr) {
+		{
+			size_t length;
+			auto str = lua_tolstring(L, i, &length);
+			if (str == nullptr) {
 				luaL_error(L, "Could not cast argument %d to string", i);
 			}
+
+			if (arena != nullptr) {
+				tv.Value.Val.String = arena->CopyString(str, length);
+			} else {
+				tv.Value.Val.String = const_cast<char *>(gOsirisProxy->GetOsiStringPool().Intern(str, length));
+			}
 			break;
+		}
 
 		default:
 			luaL_error(L, "Unhandled Osi argument type %d", osiType);
@@ -76,13 +129,6 @@ namespace dse::lua
 		}
 	}
 
-	TypedValue * LuaToOsi(lua_State * L, int i, ValueType osiType, bool allowNil)
-	{
-		auto tv = new TypedValue();
-		LuaToOsi(L, i, *tv, osiType, allowNil);
-		return tv;
-	}
-
 	void LuaToOsi(lua_State * L, int i, OsiArgumentValue & arg, ValueType osiType, bool allowNil)
 	{
 		arg.TypeId = osiType;
@@ -416,18 +462,20 @@ namespace dse::lua
 				function_->Signature->Name, funcArgs, numArgs - 1);
 		}
 
-		OsiArgumentListPin<OsiArgumentDesc> args(state_->GetArgumentDescPool(), (uint32_t)funcArgs);
+		auto & arena = state_->GetOsiScratchArena();
+		OsiScratchScope scope(arena);
+		auto args = arena.AllocateArray<OsiArgumentDesc>((uint32_t)funcArgs);
 		auto argType = function_->Signature->Params->Params.Head->Next;
 		for (uint32_t i = 0; i < funcArgs; i++) {
-			auto arg = args.Args() + i;
+			auto arg = args + i;
 			if (i > 0) {
-				args.Args()[i - 1].NextParam = arg;
+				args[i - 1].NextParam = arg;
 			}
 			LuaToOsi(L, i + 2, arg->Value, (ValueType)argType->Item.Type);
 			argType = argType->Next;
 		}
 
-		gOsirisProxy->GetWrappers().Call.CallWithHooks(function_->GetHandle(), funcArgs == 0 ? nullptr : args.Args());
+		gOsirisProxy->GetWrappers().Call.CallWithHooks(function_->GetHandle(), funcArgs == 0 ? nullptr : args);
 	}
 
 	void OsiFunction::OsiInsert(lua_State * L, bool deleteTuple)
@@ -443,19 +491,22 @@ namespace dse::lua
 			luaL_error(L, "Function has no node");
 		}
 
-		OsiArgumentListPin<TypedValue> tvs(state_->GetTypedValuePool(), (uint32_t)funcArgs);
-		OsiArgumentListPin<ListNode<TypedValue *>> nodes(state_->GetTypedValueNodePool(), (uint32_t)funcArgs + 1);
+		auto & arena = state_->GetOsiScratchArena();
+		OsiScratchScope scope(arena);
+		auto tvs = arena.AllocateArray<TypedValue>((uint32_t)funcArgs);
+		auto nodes = arena.AllocateArray<ListNode<TypedValue *>>((uint32_t)funcArgs + 1);
 
 		TuplePtrLL tuple;
 		auto & args = tuple.Items;
 		auto argType = function_->Signature->Params->Params.Head->Next;
-		args.Init(nodes.Args());
+		args.Init(nodes);
 
 		auto prev = args.Head;
 		for (uint32_t i = 0; i < funcArgs; i++) {
-			auto tv = tvs.Args() + i;
-			LuaToOsi(L, i + 2, *tv, (ValueType)argType->Item.Type, deleteTuple);
-			auto node = nodes.Args() + i + 1;
+			auto tv = tvs + i;
+			// Inserted values may be retained by the DB, only the descriptors and list nodes are call-scoped
+			LuaToOsi(L, i + 2, *tv, (ValueType)argType->Item.Type, deleteTuple ? &arena : nullptr, deleteTuple);
+			auto node = nodes + i + 1;
 			args.Insert(tv, node, prev);
 			prev = node;
 			argType = argType->Next;
@@ -481,13 +532,15 @@ namespace dse::lua
 				function_->Signature->Name, inParams, numArgs - 1);
 		}
 
-		OsiArgumentListPin<OsiArgumentDesc> args(state_->GetArgumentDescPool(), (uint32_t)numParams);
+		auto & arena = state_->GetOsiScratchArena();
+		OsiScratchScope scope(arena);
+		auto args = arena.AllocateArray<OsiArgumentDesc>((uint32_t)numParams);
 		auto argType = function_->Signature->Params->Params.Head->Next;
 		uint32_t inputArg = 2;
 		for (uint32_t i = 0; i < numParams; i++) {
-			auto arg = args.Args() + i;
+			auto arg = args + i;
 			if (i > 0) {
-				args.Args()[i - 1].NextParam = arg;
+				args[i - 1].NextParam = arg;
 			}
 
 			if (function_->Signature->OutParamList.isOutParam(i)) {
@@ -499,7 +552,7 @@ namespace dse::lua
 			argType = argType->Next;
 		}
 
-		bool handled = gOsirisProxy->GetWrappers().Query.CallWithHooks(function_->GetHandle(), numParams == 0 ? nullptr : args.Args());
+		bool handled = gOsirisProxy->GetWrappers().Query.CallWithHooks(function_->GetHandle(), numParams == 0 ? nullptr : args);
 		if (outParams == 0) {
 			lua_pushboolean(L, handled ? 1 : 0);
 			return 1;
@@ -507,7 +560,7 @@ namespace dse::lua
 			if (handled) {
 				for (uint32_t i = 0; i < numParams; i++) {
 					if (function_->Signature->OutParamList.isOutParam(i)) {
-						OsiToLua(L, args.Args()[i].Value);
+						OsiToLua(L, args[i].Value);
 					}
 				}
 			} else {
@@ -532,22 +585,24 @@ namespace dse::lua
 				function_->Signature->Name, inParams, numArgs - 1);
 		}
 
-		OsiArgumentListPin<ListNode<TupleLL::Item>> nodes(state_->GetTupleNodePool(), (uint32_t)numParams + 1);
+		auto & arena = state_->GetOsiScratchArena();
+		OsiScratchScope scope(arena);
+		auto nodes = arena.AllocateArray<ListNode<TupleLL::Item>>((uint32_t)numParams + 1);
 
 		VirtTupleLL tuple;
 		
 		auto & args = tuple.Data.Items;
 		auto argType = function_->Signature->Params->Params.Head->Next;
-		args.Init(nodes.Args());
+		args.Init(nodes);
 
 		auto prev = args.Head;
 		uint32_t inputArgIndex = 0;
 		for (uint32_t i = 0; i < numParams; i++) {
-			auto node = nodes.Args() + i + 1;
+			auto node = nodes + i + 1;
 			args.Insert(node, prev);
 			node->Item.Index = i;
 			if (!function_->Signature->OutParamList.isOutParam(i)) {
-				LuaToOsi(L, inputArgIndex + 2, node->Item.Value, (ValueType)argType->Item.Type);
+				LuaToOsi(L, inputArgIndex + 2, node->Item.Value, (ValueType)argType->Item.Type, &arena);
 				inputArgIndex++;
 			} else {
 				node->Item.Value.VMT = gOsirisProxy->GetGlobals().TypedValueVMT;
@@ -694,24 +749,13 @@ namespace dse::lua
 			return &functions_[arity];
 		}
 
-		// Look for Call/Proc/Event/Query (number of OUT args == 0)
-		auto func = LookupOsiFunction(arity);
-		if (func != nullptr && func->Signature->OutParamList.numOutParams() == 0) {
+		// Functions are indexed by their number of IN params, so this finds both
+		// Call/Proc/Event/Query and Query/UserQuery functions with OUT params
+		auto func = gOsirisProxy->GetCustomFunctionInjector().LookupOsiFunction(name_, arity);
+		if (func != nullptr) {
 			return CreateFunctionMapping(arity, func);
 		}
 
-		for (uint32_t args = arity + 1; args < arity + MaxQueryOutParams; args++) {
-			// Look for Query/UserQuery (number of OUT args > 0)
-			auto func = LookupOsiFunction(args);
-			if (func != nullptr) {
-				auto outParams = func->Signature->OutParamList.numOutParams();
-				auto params = func->Signature->Params->Params.Size - outParams;
-				if (params == arity) {
-					return CreateFunctionMapping(arity, func);
-				}
-			}
-		}
-
 		return nullptr;
 	}
 
@@ -728,36 +772,6 @@ namespace dse::lua
 		}
 	}
 
-	uint32_t FunctionNameHash(char const * str)
-	{
-		uint32_t hash{ 0 };
-		while (*str) {
-			hash = (*str++ | 0x20) + 129 * (hash % 4294967);
-		}
-
-		return hash;
-	}
-
-	Function const * OsiFunctionNameProxy::LookupOsiFunction(uint32_t arity)
-	{
-		auto functions = gOsirisProxy->GetGlobals().Functions;
-
-		STDString sig(name_);
-		sig += "/";
-		sig += std::to_string(arity);
-
-		auto hash = FunctionNameHash(name_.c_str()) + arity;
-		auto func = (*functions)->Find(hash, sig);
-		if (func == nullptr 
-			|| ((*func)->Node.Id == 0 
-				&& (*func)->Type != FunctionType::Call
-				&& (*func)->Type != FunctionType::Query)) {
-			return nullptr;
-		}
-
-		return *func;
-	}
-
 	ValueType StringToValueType(std::string_view s)
 	{
 		if (s == "INTEGER") {
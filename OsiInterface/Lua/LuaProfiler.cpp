@@ -0,0 +1,285 @@
+#include <stdafx.h>
+#include <Lua/LuaProfiler.h>
+#include <Lua/LuaBinding.h>
+#include <OsirisProxy.h>
+#include <ScriptHelpers.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace dse::lua
+{
+	void Profiler::Start(lua_State * L)
+	{
+		if (L_ != nullptr) {
+			Stop();
+		}
+
+		functions_.clear();
+		mods_.clear();
+		functionIndex_.clear();
+		modIndex_.clear();
+		callStack_.clear();
+		unattributedAllocations_ = 0;
+		profiledTime_ = Clock::duration(0);
+
+		// Mod 0 collects code that doesn't belong to any mod (builtin libraries, external files)
+		GetModIndex("");
+
+		L_ = L;
+		startTime_ = Clock::now();
+		nextReport_ = startTime_ + reportInterval_;
+		lua_sethook(L_, &Hook, LUA_MASKCALL | LUA_MASKRET, 0);
+	}
+
+	void Profiler::Stop()
+	{
+		if (L_ == nullptr) return;
+
+		auto now = Clock::now();
+		while (!callStack_.empty()) {
+			EndFrame(now);
+		}
+
+		lua_sethook(L_, nullptr, 0, 0);
+		profiledTime_ += now - startTime_;
+		L_ = nullptr;
+
+		if (!reportPath_.empty()) {
+			WriteReport();
+		}
+	}
+
+	void Profiler::SetReportFile(STDString const & path, Clock::duration interval)
+	{
+		reportPath_ = path;
+		reportInterval_ = interval;
+		nextReport_ = Clock::now() + reportInterval_;
+	}
+
+	void Profiler::UnwindTo(std::size_t depth)
+	{
+		if (callStack_.size() <= depth) return;
+
+		auto now = Clock::now();
+		while (callStack_.size() > depth) {
+			EndFrame(now);
+		}
+	}
+
+	void Profiler::Hook(lua_State * L, lua_Debug * ar)
+	{
+		void * ud;
+		lua_getallocf(L, &ud);
+		auto & profiler = reinterpret_cast<State *>(ud)->GetProfiler();
+
+		// Coroutines inherit the hook from the main thread; time spent in them is
+		// attributed to the function that resumed them.
+		if (L != profiler.L_) return;
+
+		switch (ar->event) {
+		case LUA_HOOKCALL:
+			profiler.OnCall(L, ar);
+			break;
+
+		case LUA_HOOKTAILCALL:
+			// The caller frame is replaced by the callee and won't get a return event
+			if (!profiler.callStack_.empty()) {
+				profiler.EndFrame(Clock::now());
+			}
+			profiler.OnCall(L, ar);
+			break;
+
+		case LUA_HOOKRET:
+			profiler.OnReturn(L, ar);
+			break;
+		}
+	}
+
+	void Profiler::OnCall(lua_State * L, lua_Debug * ar)
+	{
+		lua_getinfo(L, "Sf", ar); // stack: fn
+		auto closure = lua_topointer(L, -1);
+
+		uint32_t callerMod = 0;
+		if (!callStack_.empty()) {
+			callerMod = functions_[callStack_.back().Function].ModIndex;
+		}
+
+		auto function = GetFunctionIndex(L, ar, callerMod);
+		lua_pop(L, 1); // stack: -
+
+		functions_[function].Calls++;
+		callStack_.push_back(Frame{ function, closure, Clock::now(), Clock::duration(0) });
+	}
+
+	void Profiler::OnReturn(lua_State * L, lua_Debug * ar)
+	{
+		lua_getinfo(L, "f", ar); // stack: fn
+		auto closure = lua_topointer(L, -1);
+		lua_pop(L, 1); // stack: -
+
+		// Frames unwound by an error thrown in a protected call don't get a return event;
+		// close everything above the returning function.
+		auto it = std::find_if(callStack_.rbegin(), callStack_.rend(), [closure](Frame const & frame) {
+			return frame.Closure == closure;
+		});
+
+		// Function was called before profiling was started
+		if (it == callStack_.rend()) return;
+
+		auto depth = (std::size_t)(callStack_.rend() - it) - 1;
+		auto now = Clock::now();
+		while (callStack_.size() > depth) {
+			EndFrame(now);
+		}
+
+		if (callStack_.empty() && !reportPath_.empty() && now >= nextReport_) {
+			WriteReport();
+			nextReport_ = now + reportInterval_;
+		}
+	}
+
+	void Profiler::EndFrame(Clock::time_point now)
+	{
+		auto frame = callStack_.back();
+		callStack_.pop_back();
+
+		auto totalTime = now - frame.Start;
+		auto & function = functions_[frame.Function];
+		function.SelfTime += totalTime - frame.ChildTime;
+
+		if (!callStack_.empty()) {
+			callStack_.back().ChildTime += totalTime;
+		}
+	}
+
+	uint32_t Profiler::GetModIndex(char const * source)
+	{
+		// Mod scripts are loaded with the chunk name "<ModDirectory>/<Path>"
+		STDString modName;
+		auto sep = strchr(source, '/');
+		if (sep != nullptr && *source != '@' && *source != '=') {
+			modName = STDString(source, sep - source);
+		}
+
+		auto it = modIndex_.find(modName);
+		if (it != modIndex_.end()) {
+			return it->second;
+		}
+
+		auto index = (uint32_t)mods_.size();
+		ModStats mod;
+		mod.Name = modName.empty() ? "(Extender)" : modName;
+		mods_.push_back(mod);
+		modIndex_.insert(std::make_pair(modName, index));
+		return index;
+	}
+
+	uint32_t Profiler::GetFunctionIndex(lua_State * L, lua_Debug * ar, uint32_t callerMod)
+	{
+		FunctionKey key;
+		bool isC = ar->what[0] == 'C';
+		if (isC) {
+			// C functions are tracked separately for each calling mod
+			key.Source = (void const *)lua_tocfunction(L, -1);
+			key.Line = 0;
+			key.ModIndex = callerMod;
+		} else {
+			// The source string is shared by every function in the chunk
+			key.Source = ar->source;
+			key.Line = ar->linedefined;
+			key.ModIndex = 0;
+		}
+
+		auto it = functionIndex_.find(key);
+		if (it != functionIndex_.end()) {
+			return it->second;
+		}
+
+		FunctionStats function;
+		if (isC) {
+			lua_getinfo(L, "n", ar);
+			function.Name = "[C] ";
+			function.Name += ar->name ? ar->name : "?";
+			function.ModIndex = callerMod;
+		} else {
+			function.Name = ar->short_src;
+			function.Name += ":";
+			function.Name += std::to_string(ar->linedefined).c_str();
+			function.ModIndex = GetModIndex(ar->source);
+		}
+
+		auto index = (uint32_t)functions_.size();
+		functions_.push_back(function);
+		functionIndex_.insert(std::make_pair(key, index));
+		return index;
+	}
+
+	STDString Profiler::GetReport(uint32_t maxFunctionsPerMod) const
+	{
+		auto profiledTime = profiledTime_;
+		if (L_ != nullptr) {
+			profiledTime += Clock::now() - startTime_;
+		}
+
+		std::vector<ModStats> mods(mods_);
+		std::vector<std::vector<FunctionStats const *>> modFunctions(mods.size());
+		for (auto const & function : functions_) {
+			mods[function.ModIndex].SelfTime += function.SelfTime;
+			mods[function.ModIndex].AllocatedBytes += function.AllocatedBytes;
+			modFunctions[function.ModIndex].push_back(&function);
+		}
+
+		std::vector<uint32_t> modOrder;
+		for (uint32_t i = 0; i < mods.size(); i++) {
+			modOrder.push_back(i);
+		}
+
+		std::sort(modOrder.begin(), modOrder.end(), [&mods](uint32_t a, uint32_t b) {
+			return mods[a].SelfTime > mods[b].SelfTime;
+		});
+
+		auto toMs = [](Clock::duration d) {
+			return std::chrono::duration<double, std::milli>(d).count();
+		};
+
+		std::stringstream ss;
+		ss << std::fixed << std::setprecision(3);
+		ss << "Lua profile: " << toMs(profiledTime) << " ms profiled, "
+			<< unattributedAllocations_ << " bytes allocated outside Lua calls" << std::endl;
+
+		for (auto modIdx : modOrder) {
+			auto const & mod = mods[modIdx];
+			auto & functions = modFunctions[modIdx];
+			if (functions.empty()) continue;
+
+			ss << std::endl << mod.Name << ": " << toMs(mod.SelfTime) << " ms, "
+				<< mod.AllocatedBytes << " bytes allocated" << std::endl;
+
+			std::sort(functions.begin(), functions.end(), [](FunctionStats const * a, FunctionStats const * b) {
+				return a->SelfTime > b->SelfTime;
+			});
+
+			auto numFunctions = std::min((std::size_t)maxFunctionsPerMod, functions.size());
+			for (std::size_t i = 0; i < numFunctions; i++) {
+				auto const & function = *functions[i];
+				ss << "    " << std::setw(10) << toMs(function.SelfTime) << " ms "
+					<< std::setw(10) << function.Calls << " calls "
+					<< std::setw(12) << function.AllocatedBytes << " bytes  "
+					<< function.Name << std::endl;
+			}
+		}
+
+		return ss.str().c_str();
+	}
+
+	void Profiler::WriteReport()
+	{
+		auto report = GetReport(20);
+		if (!script::SaveExternalFile(reportPath_, report)) {
+			OsiError("Failed to write Lua profiler report to '" << reportPath_ << "'");
+		}
+	}
+}
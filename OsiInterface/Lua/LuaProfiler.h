@@ -0,0 +1,119 @@
+#pragma once
+
+#include <GameDefinitions/BaseTypes.h>
+#include <Lua/LuaHelpers.h>
+
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+namespace dse::lua
+{
+	// Call/return hook based profiler that attributes Lua CPU time and allocations
+	// to the mod that owns the executing function.
+	// Mods are identified by the chunk name of the script ("<ModDirectory>/<Script>.lua");
+	// C functions (Ext API calls, etc.) are attributed to the mod that called them.
+	class Profiler
+	{
+	public:
+		using Clock = std::chrono::high_resolution_clock;
+
+		struct FunctionStats
+		{
+			STDString Name;
+			uint32_t ModIndex;
+			uint64_t Calls{ 0 };
+			// Time spent in the function itself, excluding callees
+			Clock::duration SelfTime{ 0 };
+			uint64_t AllocatedBytes{ 0 };
+		};
+
+		struct ModStats
+		{
+			STDString Name;
+			Clock::duration SelfTime{ 0 };
+			uint64_t AllocatedBytes{ 0 };
+		};
+
+		inline bool IsEnabled() const
+		{
+			return L_ != nullptr;
+		}
+
+		void Start(lua_State * L);
+		void Stop();
+		// Writes the report to the specified file in the extender storage
+		// directory every `interval`; an empty path disables periodic reports
+		void SetReportFile(STDString const & path, Clock::duration interval);
+		STDString GetReport(uint32_t maxFunctionsPerMod) const;
+
+		inline void OnAllocation(size_t bytes)
+		{
+			if (!callStack_.empty()) {
+				functions_[callStack_.back().Function].AllocatedBytes += bytes;
+			} else {
+				unattributedAllocations_ += bytes;
+			}
+		}
+
+		// Returns the current call depth; used to discard frames unwound by Lua errors
+		inline std::size_t GetCallDepth() const
+		{
+			return callStack_.size();
+		}
+
+		void UnwindTo(std::size_t depth);
+
+	private:
+		struct FunctionKey
+		{
+			void const * Source;
+			intptr_t Line;
+			uint32_t ModIndex;
+
+			inline bool operator ==(FunctionKey const & o) const
+			{
+				return Source == o.Source && Line == o.Line && ModIndex == o.ModIndex;
+			}
+		};
+
+		struct FunctionKeyHash
+		{
+			inline std::size_t operator ()(FunctionKey const & key) const
+			{
+				return std::hash<void const *>()(key.Source) ^ (std::hash<intptr_t>()(key.Line) << 1)
+					^ ((std::size_t)key.ModIndex << 7);
+			}
+		};
+
+		struct Frame
+		{
+			uint32_t Function;
+			void const * Closure;
+			Clock::time_point Start;
+			Clock::duration ChildTime;
+		};
+
+		lua_State * L_{ nullptr };
+		Clock::time_point startTime_;
+		Clock::duration profiledTime_{ 0 };
+		std::vector<FunctionStats> functions_;
+		std::vector<ModStats> mods_;
+		std::unordered_map<FunctionKey, uint32_t, FunctionKeyHash> functionIndex_;
+		std::unordered_map<STDString, uint32_t> modIndex_;
+		std::vector<Frame> callStack_;
+		uint64_t unattributedAllocations_{ 0 };
+
+		STDString reportPath_;
+		Clock::duration reportInterval_{ 0 };
+		Clock::time_point nextReport_;
+
+		static void Hook(lua_State * L, lua_Debug * ar);
+		void OnCall(lua_State * L, lua_Debug * ar);
+		void OnReturn(lua_State * L, lua_Debug * ar);
+		void EndFrame(Clock::time_point now);
+		uint32_t GetModIndex(char const * source);
+		uint32_t GetFunctionIndex(lua_State * L, lua_Debug * ar, uint32_t callerMod);
+		void WriteReport();
+	};
+}
@@ -0,0 +1,532 @@
+#include <stdafx.h>
+#include <Lua/LuaSerializer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace dse::lua
+{
+	// Binary encoding used by Ext.Serialize/Ext.Deserialize.
+	//
+	// A document starts with BinaryMagic and BinaryFormatVersion, followed by the root value.
+	// Each value starts with a tag byte; tags >= Tag::SmallInt encode integers 0..127 directly.
+	// Variable-length integers are LEB128 encoded, signed ones are zigzag encoded first.
+	// Every string literal and table is assigned a sequential index in the order it appears in
+	// the document; later occurrences are written as references to that index, which
+	// deduplicates strings and preserves shared and cyclic table references.
+	namespace binary
+	{
+		static constexpr uint8_t BinaryMagic = 0xD5;
+		static constexpr uint8_t BinaryFormatVersion = 1;
+
+		enum Tag : uint8_t
+		{
+			Nil = 0x00,
+			False = 0x01,
+			True = 0x02,
+			// Zigzag varint
+			Integer = 0x03,
+			// 4-byte float, used when the number can be represented exactly
+			Float = 0x04,
+			// 8-byte double
+			Double = 0x05,
+			// Varint length + bytes
+			String = 0x06,
+			// Varint index into the string list
+			StringRef = 0x07,
+			// Varint count + values for the keys 1..count
+			Array = 0x08,
+			// Varint count + key/value pairs
+			Map = 0x09,
+			// Varint index into the table list
+			TableRef = 0x0A,
+			SmallInt = 0x80
+		};
+	}
+
+	class BinarySerializer
+	{
+	public:
+		// Serializing is recursive, so the nesting limit has to be kept in line with the C stack
+		static constexpr int MaxDepth = 200;
+
+		inline BinarySerializer(lua_State * L, std::string & buf)
+			: L_(L), buf_(buf)
+		{}
+
+		void Write(int index)
+		{
+			index = lua_absindex(L_, index);
+			CheckStack(2);
+			lua_newtable(L_); // stack: strings
+			stringsIdx_ = lua_gettop(L_);
+			lua_newtable(L_); // stack: strings, tables
+			tablesIdx_ = lua_gettop(L_);
+
+			buf_ += (char)binary::BinaryMagic;
+			buf_ += (char)binary::BinaryFormatVersion;
+			WriteValue(index, 0);
+
+			lua_pop(L_, 2); // stack: -
+		}
+
+	private:
+		lua_State * L_;
+		std::string & buf_;
+		int stringsIdx_{ 0 };
+		int tablesIdx_{ 0 };
+		lua_Integer numStrings_{ 0 };
+		lua_Integer numTables_{ 0 };
+
+		void CheckStack(int slots)
+		{
+			if (!lua_checkstack(L_, slots)) {
+				throw std::runtime_error("Stack overflow while serializing");
+			}
+		}
+
+		void WriteVarint(uint64_t value)
+		{
+			while (value >= 0x80) {
+				buf_ += (char)((value & 0x7f) | 0x80);
+				value >>= 7;
+			}
+
+			buf_ += (char)value;
+		}
+
+		void WriteValue(int index, int depth)
+		{
+			switch (lua_type(L_, index)) {
+			case LUA_TNIL:
+				buf_ += (char)binary::Nil;
+				break;
+
+			case LUA_TBOOLEAN:
+				buf_ += (char)(lua_toboolean(L_, index) ? binary::True : binary::False);
+				break;
+
+			case LUA_TNUMBER:
+				if (lua_isinteger(L_, index)) {
+					WriteInteger(lua_tointeger(L_, index));
+				} else {
+					WriteNumber(lua_tonumber(L_, index));
+				}
+				break;
+
+			case LUA_TSTRING:
+				WriteString(index);
+				break;
+
+			case LUA_TTABLE:
+				WriteTable(index, depth);
+				break;
+
+			case LUA_TLIGHTUSERDATA:
+			case LUA_TFUNCTION:
+			case LUA_TUSERDATA:
+			case LUA_TTHREAD:
+			default:
+				throw std::runtime_error("Attempted to serialize a lightuserdata, userdata, function or thread value");
+			}
+		}
+
+		void WriteInteger(lua_Integer value)
+		{
+			if (value >= 0 && value < 0x80) {
+				buf_ += (char)(binary::SmallInt | value);
+			} else {
+				buf_ += (char)binary::Integer;
+				auto uv = (uint64_t)value;
+				WriteVarint((uv << 1) ^ (value < 0 ? ~(uint64_t)0 : 0));
+			}
+		}
+
+		void WriteNumber(lua_Number value)
+		{
+			auto f = (float)value;
+			if ((lua_Number)f == value || std::isnan(value)) {
+				buf_ += (char)binary::Float;
+				buf_.append(reinterpret_cast<char const *>(&f), sizeof(f));
+			} else {
+				buf_ += (char)binary::Double;
+				buf_.append(reinterpret_cast<char const *>(&value), sizeof(value));
+			}
+		}
+
+		void WriteString(int index)
+		{
+			CheckStack(2);
+			lua_pushvalue(L_, index); // stack: str
+			lua_rawget(L_, stringsIdx_); // stack: ref
+			if (lua_isinteger(L_, -1)) {
+				buf_ += (char)binary::StringRef;
+				WriteVarint((uint64_t)lua_tointeger(L_, -1));
+				lua_pop(L_, 1); // stack: -
+				return;
+			}
+
+			lua_pop(L_, 1); // stack: -
+			lua_pushvalue(L_, index); // stack: str
+			lua_pushinteger(L_, numStrings_++); // stack: str, ref
+			lua_rawset(L_, stringsIdx_); // stack: -
+
+			size_t len;
+			auto str = lua_tolstring(L_, index, &len);
+			buf_ += (char)binary::String;
+			WriteVarint(len);
+			buf_.append(str, len);
+		}
+
+		// Tables with the keys 1..n are written as arrays, everything else as maps
+		bool IsArray(int index, lua_Integer & length)
+		{
+			lua_Integer count = 0, maxKey = 0;
+			bool isArray = true;
+			lua_pushnil(L_); // stack: key
+			while (lua_next(L_, index) != 0) { // stack: key, value
+				count++;
+				if (isArray) {
+					if (lua_isinteger(L_, -2) && lua_tointeger(L_, -2) >= 1) {
+						maxKey = std::max(maxKey, lua_tointeger(L_, -2));
+					} else {
+						isArray = false;
+					}
+				}
+
+				lua_pop(L_, 1); // stack: key
+			}
+
+			length = count;
+			return isArray && maxKey == count;
+		}
+
+		void WriteTable(int index, int depth)
+		{
+			if (depth > MaxDepth) {
+				throw std::runtime_error("Recursion depth exceeded while serializing");
+			}
+
+			CheckStack(4);
+			lua_pushvalue(L_, index); // stack: tab
+			lua_rawget(L_, tablesIdx_); // stack: ref
+			if (lua_isinteger(L_, -1)) {
+				buf_ += (char)binary::TableRef;
+				WriteVarint((uint64_t)lua_tointeger(L_, -1));
+				lua_pop(L_, 1); // stack: -
+				return;
+			}
+
+			lua_pop(L_, 1); // stack: -
+			lua_pushvalue(L_, index); // stack: tab
+			lua_pushinteger(L_, numTables_++); // stack: tab, ref
+			lua_rawset(L_, tablesIdx_); // stack: -
+
+			lua_Integer length;
+			if (IsArray(index, length)) {
+				buf_ += (char)binary::Array;
+				WriteVarint((uint64_t)length);
+				for (lua_Integer i = 1; i <= length; i++) {
+					lua_rawgeti(L_, index, i); // stack: value
+					WriteValue(lua_gettop(L_), depth + 1);
+					lua_pop(L_, 1); // stack: -
+				}
+			} else {
+				buf_ += (char)binary::Map;
+				WriteVarint((uint64_t)length);
+				lua_pushnil(L_); // stack: key
+				while (lua_next(L_, index) != 0) { // stack: key, value
+					WriteValue(lua_gettop(L_) - 1, depth + 1);
+					WriteValue(lua_gettop(L_), depth + 1);
+					lua_pop(L_, 1); // stack: key
+				}
+			}
+		}
+	};
+
+
+	class BinaryDeserializer
+	{
+	public:
+		static constexpr int MaxDepth = 200;
+
+		inline BinaryDeserializer(lua_State * L, char const * buf, std::size_t length)
+			: L_(L), cur_(reinterpret_cast<uint8_t const *>(buf)), end_(cur_ + length)
+		{}
+
+		// Pushes the deserialized value to the stack; raises a Lua error if the data is malformed
+		void Read()
+		{
+			if (end_ - cur_ < 2 || cur_[0] != binary::BinaryMagic) {
+				Error("Not a serialized Lua value");
+			}
+
+			if (cur_[1] != binary::BinaryFormatVersion) {
+				Error("Unsupported format version");
+			}
+
+			cur_ += 2;
+			luaL_checkstack(L_, 3, "Stack overflow while deserializing");
+			lua_newtable(L_); // stack: strings
+			stringsIdx_ = lua_gettop(L_);
+			lua_newtable(L_); // stack: strings, tables
+			tablesIdx_ = lua_gettop(L_);
+
+			ReadValue(0); // stack: strings, tables, value
+			if (cur_ != end_) {
+				Error("Unexpected data after the end of the value");
+			}
+
+			lua_replace(L_, stringsIdx_); // stack: value, tables
+			lua_pop(L_, 1); // stack: value
+		}
+
+	private:
+		lua_State * L_;
+		uint8_t const * cur_;
+		uint8_t const * end_;
+		int stringsIdx_{ 0 };
+		int tablesIdx_{ 0 };
+		lua_Integer numStrings_{ 0 };
+		lua_Integer numTables_{ 0 };
+
+		[[noreturn]] void Error(char const * msg)
+		{
+			luaL_error(L_, "Unable to deserialize: %s", msg);
+			// luaL_error() doesn't return
+			abort();
+		}
+
+		uint64_t ReadVarint()
+		{
+			uint64_t value = 0;
+			for (unsigned shift = 0; shift < 64; shift += 7) {
+				if (cur_ == end_) {
+					Error("Unexpected end of data");
+				}
+
+				auto byte = *cur_++;
+				value |= (uint64_t)(byte & 0x7f) << shift;
+				if ((byte & 0x80) == 0) {
+					return value;
+				}
+			}
+
+			Error("Malformed varint");
+		}
+
+		// Element counts are bounded by the remaining data (each value takes at least one byte),
+		// so a corrupted count can't make us preallocate huge tables
+		int ReadCount(std::size_t bytesPerElement)
+		{
+			auto count = ReadVarint();
+			if (count > (uint64_t)(end_ - cur_) / bytesPerElement) {
+				Error("Element count exceeds data size");
+			}
+
+			return (int)count;
+		}
+
+		void ReadBytes(void * out, std::size_t size)
+		{
+			if ((std::size_t)(end_ - cur_) < size) {
+				Error("Unexpected end of data");
+			}
+
+			memcpy(out, cur_, size);
+			cur_ += size;
+		}
+
+		void ReadValue(int depth)
+		{
+			if (cur_ == end_) {
+				Error("Unexpected end of data");
+			}
+
+			auto tag = *cur_++;
+			if (tag >= binary::SmallInt) {
+				lua_pushinteger(L_, tag & 0x7f);
+				return;
+			}
+
+			switch (tag) {
+			case binary::Nil:
+				lua_pushnil(L_);
+				break;
+
+			case binary::False:
+				lua_pushboolean(L_, 0);
+				break;
+
+			case binary::True:
+				lua_pushboolean(L_, 1);
+				break;
+
+			case binary::Integer:
+			{
+				auto zz = ReadVarint();
+				lua_pushinteger(L_, (lua_Integer)((zz >> 1) ^ (0 - (zz & 1))));
+				break;
+			}
+
+			case binary::Float:
+			{
+				float value;
+				ReadBytes(&value, sizeof(value));
+				lua_pushnumber(L_, value);
+				break;
+			}
+
+			case binary::Double:
+			{
+				double value;
+				ReadBytes(&value, sizeof(value));
+				lua_pushnumber(L_, value);
+				break;
+			}
+
+			case binary::String:
+			{
+				auto length = ReadVarint();
+				if (length > (uint64_t)(end_ - cur_)) {
+					Error("Unexpected end of data");
+				}
+
+				lua_pushlstring(L_, reinterpret_cast<char const *>(cur_), (std::size_t)length); // stack: str
+				cur_ += length;
+				lua_pushvalue(L_, -1); // stack: str, str
+				lua_rawseti(L_, stringsIdx_, ++numStrings_); // stack: str
+				break;
+			}
+
+			case binary::StringRef:
+			{
+				auto ref = ReadVarint();
+				if (ref >= (uint64_t)numStrings_) {
+					Error("Invalid string reference");
+				}
+
+				lua_rawgeti(L_, stringsIdx_, (lua_Integer)ref + 1);
+				break;
+			}
+
+			case binary::Array:
+				ReadArray(depth);
+				break;
+
+			case binary::Map:
+				ReadMap(depth);
+				break;
+
+			case binary::TableRef:
+			{
+				auto ref = ReadVarint();
+				if (ref >= (uint64_t)numTables_) {
+					Error("Invalid table reference");
+				}
+
+				lua_rawgeti(L_, tablesIdx_, (lua_Integer)ref + 1);
+				break;
+			}
+
+			default:
+				Error("Unknown value tag");
+			}
+		}
+
+		void BeginTable(int depth, int narr, int nrec)
+		{
+			if (depth > MaxDepth) {
+				Error("Exceeded nesting limit");
+			}
+
+			luaL_checkstack(L_, 4, "Stack overflow while deserializing");
+			lua_createtable(L_, narr, nrec); // stack: tab
+			// Register the table before reading its contents, so nested values can refer to it
+			lua_pushvalue(L_, -1); // stack: tab, tab
+			lua_rawseti(L_, tablesIdx_, ++numTables_); // stack: tab
+		}
+
+		void ReadArray(int depth)
+		{
+			auto count = ReadCount(1);
+			BeginTable(depth, count, 0); // stack: tab
+			for (int i = 1; i <= count; i++) {
+				ReadValue(depth + 1); // stack: tab, value
+				lua_rawseti(L_, -2, i); // stack: tab
+			}
+		}
+
+		void ReadMap(int depth)
+		{
+			auto count = ReadCount(2);
+			BeginTable(depth, 0, count); // stack: tab
+			for (int i = 0; i < count; i++) {
+				ReadValue(depth + 1); // stack: tab, key
+				if (lua_isnil(L_, -1)) {
+					Error("Table key is nil");
+				}
+
+				if (lua_type(L_, -1) == LUA_TNUMBER && !lua_isinteger(L_, -1) && std::isnan(lua_tonumber(L_, -1))) {
+					Error("Table key is NaN");
+				}
+
+				ReadValue(depth + 1); // stack: tab, key, value
+				lua_rawset(L_, -3); // stack: tab
+			}
+		}
+	};
+
+
+	void SerializeValue(lua_State * L, int index, std::string & buf)
+	{
+		BinarySerializer serializer(L, buf);
+		serializer.Write(index);
+	}
+
+	void DeserializeValue(lua_State * L, char const * buf, std::size_t length)
+	{
+		BinaryDeserializer deserializer(L, buf, length);
+		deserializer.Read();
+	}
+
+	int Serialize(lua_State * L)
+	{
+		luaL_checkany(L, 1);
+
+		// Reuse the output buffer between calls to avoid reallocating it for large payloads
+		static thread_local std::string buffer;
+		buffer.clear();
+
+		int top = lua_gettop(L);
+		try {
+			BinarySerializer serializer(L, buffer);
+			serializer.Write(1);
+		} catch (std::runtime_error & e) {
+			lua_settop(L, top);
+			return luaL_error(L, "%s", e.what());
+		}
+
+		lua_pushlstring(L, buffer.data(), buffer.size());
+
+		// Don't hold on to huge buffers indefinitely
+		if (buffer.capacity() > 16 * 1024 * 1024) {
+			buffer = std::string();
+		}
+
+		return 1;
+	}
+
+	int Deserialize(lua_State * L)
+	{
+		size_t length;
+		auto data = luaL_checklstring(L, 1, &length);
+
+		BinaryDeserializer deserializer(L, data, length);
+		deserializer.Read();
+		return 1;
+	}
+}
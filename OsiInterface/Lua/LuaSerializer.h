@@ -0,0 +1,14 @@
+#pragma once
+
+#include <Lua/LuaHelpers.h>
+
+#include <string>
+
+namespace dse::lua
+{
+	// Appends the value at the specified stack index to `buf` in the Ext.Serialize format.
+	// Throws std::runtime_error if the value can't be serialized.
+	void SerializeValue(lua_State * L, int index, std::string & buf);
+	// Pushes the value encoded in `buf`; raises a Lua error if the data is malformed
+	void DeserializeValue(lua_State * L, char const * buf, std::size_t length);
+}
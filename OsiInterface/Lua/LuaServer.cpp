@@ -415,6 +415,8 @@ namespace dse::lua
 	int LoadFile(lua_State* L);
 	int JsonParse(lua_State * L);
 	int JsonStringify(lua_State * L);
+	int Serialize(lua_State * L);
+	int Deserialize(lua_State * L);
 	int IsModLoaded(lua_State* L);
 	int GetModLoadOrder(lua_State* L);
 	int GetModInfo(lua_State* L);
@@ -423,6 +425,8 @@ namespace dse::lua
 	int GetEquipmentSet(lua_State * L);
 	int StatGetAttribute(lua_State * L);
 	int StatSetAttribute(lua_State * L);
+	int GetStatAttributeHandle(lua_State * L);
+	int StatApplyPatch(lua_State * L);
 	int StatAddCustomDescription(lua_State * L);
 	int GetStat(lua_State * L);
 	int GetCharacter(lua_State * L);
@@ -437,12 +441,26 @@ namespace dse::lua
 	int LuaRound(lua_State * L);
 	int GenerateIdeHelpers(lua_State * L);
 	int AddVoiceMetaData(lua_State * L);
+	int OnListenerAdded(lua_State * L);
+	int StartProfiler(lua_State * L);
+	int StopProfiler(lua_State * L);
+	int GetProfilerReport(lua_State * L);
+	int GetMemoryStats(lua_State * L);
+	int SetGCParameters(lua_State * L);
+	int GetGCStats(lua_State * L);
+	int Schedule(lua_State * L);
+	int CancelTask(lua_State * L);
+	int GetTaskStats(lua_State * L);
+	int AddWorkerScript(lua_State * L);
+	int SubmitJob(lua_State * L);
+	int GetNetStats(lua_State * L);
 
 
 	int BroadcastMessage(lua_State * L)
 	{
 		auto channel = luaL_checkstring(L, 1);
-		auto payload = luaL_checkstring(L, 2);
+		size_t payloadLength;
+		auto payload = luaL_checklstring(L, 2, &payloadLength);
 
 		esv::Character * excludeCharacter = nullptr;
 		if (!lua_isnil(L, 3)) {
@@ -452,20 +470,8 @@ namespace dse::lua
 		}
 
 		auto & networkMgr = gOsirisProxy->GetNetworkManager();
-		auto msg = networkMgr.GetFreeServerMessage();
-		if (msg != nullptr) {
-			auto postMsg = msg->GetMessage().mutable_post_lua();
-			postMsg->set_channel_name(channel);
-			postMsg->set_payload(payload);
-			if (excludeCharacter != nullptr) {
-				networkMgr.ServerBroadcast(msg, excludeCharacter->PeerId);
-			} else {
-				networkMgr.ServerBroadcast(msg, -1);
-			}
-		} else {
-			OsiErrorS("Could not get free message!");
-		}
-
+		networkMgr.ServerBroadcastLuaMessage(channel, std::string_view(payload, payloadLength),
+			excludeCharacter != nullptr ? excludeCharacter->PeerId : -1);
 		return 0;
 	}
 
@@ -473,22 +479,14 @@ namespace dse::lua
 	{
 		auto characterGuid = luaL_checkstring(L, 1);
 		auto channel = luaL_checkstring(L, 2);
-		auto payload = luaL_checkstring(L, 3);
+		size_t payloadLength;
+		auto payload = luaL_checklstring(L, 3, &payloadLength);
 
 		auto character = FindCharacterByNameGuid(characterGuid);
 		if (character == nullptr) return 0;
 
 		auto & networkMgr = gOsirisProxy->GetNetworkManager();
-		auto msg = networkMgr.GetFreeServerMessage();
-		if (msg != nullptr) {
-			auto postMsg = msg->GetMessage().mutable_post_lua();
-			postMsg->set_channel_name(channel);
-			postMsg->set_payload(payload);
-			networkMgr.ServerSend(msg, character->PeerId);
-		} else {
-			OsiErrorS("Could not get free message!");
-		}
-
+		networkMgr.ServerPostLuaMessage(character->PeerId, channel, std::string_view(payload, payloadLength));
 		return 0;
 	}
 
@@ -508,6 +506,8 @@ namespace dse::lua
 
 			{"JsonParse", JsonParse},
 			{"JsonStringify", JsonStringify},
+			{"Serialize", Serialize},
+			{"Deserialize", Deserialize},
 
 			{"IsModLoaded", IsModLoaded},
 			{"GetModLoadOrder", GetModLoadOrder},
@@ -518,6 +518,8 @@ namespace dse::lua
 			{"GetEquipmentSet", GetEquipmentSet},
 			{"StatGetAttribute", StatGetAttribute},
 			{"StatSetAttribute", StatSetAttribute},
+			{"StatAttributeHandle", GetStatAttributeHandle},
+			{"StatApplyPatch", StatApplyPatch},
 			{"StatAddCustomDescription", StatAddCustomDescription},
 			{"GetStat", GetStat},
 
@@ -530,11 +532,25 @@ namespace dse::lua
 			{"IsDeveloperMode", IsDeveloperMode},
 			{"Random", LuaRandom},
 			{"Round", LuaRound},
+			{"_OnListenerAdded", OnListenerAdded},
 			{"GenerateIdeHelpers", GenerateIdeHelpers},
 
 			{"AddPathOverride", AddPathOverride},
 			{"AddVoiceMetaData", AddVoiceMetaData},
 
+			{"StartProfiler", StartProfiler},
+			{"StopProfiler", StopProfiler},
+			{"GetProfilerReport", GetProfilerReport},
+			{"GetMemoryStats", GetMemoryStats},
+			{"SetGCParameters", SetGCParameters},
+			{"GetGCStats", GetGCStats},
+			{"Schedule", Schedule},
+			{"CancelTask", CancelTask},
+			{"GetTaskStats", GetTaskStats},
+			{"AddWorkerScript", AddWorkerScript},
+			{"SubmitJob", SubmitJob},
+			{"GetNetStats", GetNetStats},
+
 			{"BroadcastMessage", BroadcastMessage},
 			{"PostMessageToClient", PostMessageToClient},
 			{0,0}
@@ -568,6 +584,7 @@ namespace dse::lua
 		// Ext is not writeable after loading SandboxStartup!
 		auto sandbox = GetBuiltinLibrary(IDR_LUA_SANDBOX_STARTUP);
 		LoadScript(sandbox, "SandboxStartup.lua");
+		ResolveExtCallbacks();
 	}
 
 	ServerState::~ServerState()
@@ -583,9 +600,9 @@ namespace dse::lua
 		std::lock_guard lock(mutex_);
 		Restriction restriction(*this, RestrictAll);
 
-		PushExtFunction(L, "_StatusGetEnterChance"); // stack: fn
-		auto _{ PushArguments(L,
-			std::tuple{Push<ObjectProxy<esv::Status>>(status)}) };
+		PushExtCallback(ExtCallback::StatusGetEnterChance); // stack: fn
+		ObjectProxy<esv::Status> * luaStatus;
+		auto _{ PushPooled(L, statusPool_, luaStatus, status) };
 		push(L, useCharacterStats);
 
 		auto result = CheckedCall<std::optional<int32_t>>(L, 2, "Ext.StatusGetEnterChance");
@@ -605,21 +622,22 @@ namespace dse::lua
 		std::lock_guard lock(mutex_);
 		Restriction restriction(*this, RestrictAll);
 
-		PushExtFunction(L, "_ComputeCharacterHit"); // stack: fn
+		PushExtCallback(ExtCallback::ComputeCharacterHit); // stack: fn
 
-		auto luaTarget = ObjectProxy<CDivinityStats_Character>::New(L, target);
-		UnbindablePin _(luaTarget);
-		ItemOrCharacterPushPin luaAttacker(L, attacker);
+		ObjectProxy<CDivinityStats_Character> * luaTarget;
+		auto _{ PushPooled(L, callbackPools_.CharacterStats, luaTarget, target) };
+		ItemOrCharacterPushPin luaAttacker(L, callbackPools_, attacker);
 
-		ObjectProxy<CDivinityStats_Item> * luaWeapon = nullptr;
+		PooledPin<UserdataPool<ObjectProxy<CDivinityStats_Item>>> _2;
 		if (weapon != nullptr) {
-			luaWeapon = ObjectProxy<CDivinityStats_Item>::New(L, weapon);
+			ObjectProxy<CDivinityStats_Item> * luaWeapon;
+			_2 = PushPooled(L, callbackPools_.ItemStats, luaWeapon, weapon);
 		} else {
 			lua_pushnil(L);
 		}
-		UnbindablePin _2(luaWeapon);
 
-		auto luaDamageList = DamageList::New(L);
+		DamageList * luaDamageList;
+		auto _3{ PushPooled(L, callbackPools_.DamageLists, luaDamageList) };
 		for (uint32_t i = 0; i < damageList->Size; i++) {
 			luaDamageList->Get().SafeAdd((*damageList)[i]);
 		}
@@ -634,7 +652,7 @@ namespace dse::lua
 		push(L, noHitRoll);
 		push(L, forceReduceDurability);
 
-		lua_newtable(L);
+		auto _4{ PushPooledTable(L, callbackPools_.Tables) };
 		settable(L, "EffectFlags", hit->EffectFlags);
 		settable(L, "TotalDamageDone", hit->TotalDamage);
 		settable(L, "ArmorAbsorption", hit->ArmorAbsorption);
@@ -733,9 +751,10 @@ namespace dse::lua
 			return false;
 		}
 
-		PushExtFunction(L, "_CalculateTurnOrder"); // stack: fn
+		PushExtCallback(ExtCallback::CalculateTurnOrder); // stack: fn
 
-		TurnManagerCombatProxy::New(L, combatId); // stack: fn, combat
+		TurnManagerCombatProxy * luaCombat;
+		auto _{ PushPooled(L, combatPool_, luaCombat, combatId) }; // stack: fn, combat
 		CombatTeamListToLua(L, combat->NextRoundTeams.Set);
 
 		if (CallWithTraceback(L, 2, 1) != 0) { // stack: retval
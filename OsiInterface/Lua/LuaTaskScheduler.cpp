@@ -0,0 +1,160 @@
+#include <stdafx.h>
+#include <Lua/LuaTaskScheduler.h>
+#include <OsirisProxy.h>
+
+#include <algorithm>
+
+namespace dse::lua
+{
+	char const * TaskScheduler::GetStatusName(TaskStatus status)
+	{
+		switch (status) {
+		case TaskStatus::Running: return "Running";
+		case TaskStatus::Finished: return "Finished";
+		case TaskStatus::Failed: return "Failed";
+		case TaskStatus::Cancelled: return "Cancelled";
+		default: return "Unknown";
+		}
+	}
+
+	int32_t TaskScheduler::Schedule(lua_State * L, int fn, int32_t priority, STDString const & name)
+	{
+		fn = lua_absindex(L, fn);
+		auto thread = lua_newthread(L); // stack: thread
+		lua_pushvalue(L, fn); // stack: thread, fn
+		lua_xmove(L, thread, 1); // stack: thread
+
+		Task task;
+		task.Id = nextTaskId_++;
+		task.Priority = priority;
+		task.Name = name;
+		task.ThreadRef = luaL_ref(L, LUA_REGISTRYINDEX); // stack: -
+		pendingTasks_.push_back(std::move(task));
+		return pendingTasks_.back().Id;
+	}
+
+	bool TaskScheduler::Cancel(int32_t taskId)
+	{
+		auto cancel = [taskId](std::vector<Task> & tasks) {
+			for (auto & task : tasks) {
+				if (task.Id == taskId && task.Status == TaskStatus::Running) {
+					// The coroutine is released when the scheduler next runs, as the
+					// task may be cancelling itself
+					task.Status = TaskStatus::Cancelled;
+					return true;
+				}
+			}
+
+			return false;
+		};
+
+		return cancel(tasks_) || cancel(pendingTasks_);
+	}
+
+	void TaskScheduler::Update(lua_State * L, Clock::duration budget)
+	{
+		AddPendingTasks();
+		RemoveFinishedTasks(L);
+		if (tasks_.empty()) return;
+
+		stats_.Ticks++;
+
+		// Tasks that were waiting the longest come first within the same priority
+		std::stable_sort(tasks_.begin(), tasks_.end(), [](Task const & a, Task const & b) {
+			if (a.Priority != b.Priority) return a.Priority > b.Priority;
+			return a.LastResumedTick < b.LastResumedTick;
+		});
+
+		auto start = Clock::now();
+		auto deadline = start + budget;
+		auto now = start;
+		bool resumed;
+		do {
+			resumed = false;
+			// New tasks are only added between passes, so references into tasks_ stay valid
+			for (auto & task : tasks_) {
+				if (task.Status != TaskStatus::Running) continue;
+
+				ResumeTask(L, task);
+				resumed = true;
+				now = Clock::now();
+				if (now >= deadline) break;
+			}
+
+			AddPendingTasks();
+			RemoveFinishedTasks(L);
+		} while (resumed && now < deadline);
+
+		auto tickTime = now - start;
+		stats_.TotalTime += tickTime;
+		stats_.MaxTickTime = std::max(stats_.MaxTickTime, tickTime);
+	}
+
+	void TaskScheduler::ResumeTask(lua_State * L, Task & task)
+	{
+		lua_rawgeti(L, LUA_REGISTRYINDEX, task.ThreadRef); // stack: thread
+		auto thread = lua_tothread(L, -1);
+		lua_pop(L, 1); // stack: -
+
+		if (task.Resumes > 0) {
+			// Discard values passed to coroutine.yield()
+			lua_settop(thread, 0);
+		}
+
+		// On the first resume, the task function is on the coroutine stack
+		auto start = Clock::now();
+		auto status = lua_resume(thread, L, 0);
+		auto sliceTime = Clock::now() - start;
+
+		task.Resumes++;
+		task.LastResumedTick = stats_.Ticks;
+		task.TotalTime += sliceTime;
+		task.MaxSliceTime = std::max(task.MaxSliceTime, sliceTime);
+
+		if (status == LUA_YIELD) {
+			return;
+		}
+
+		if (status != LUA_OK) {
+			luaL_traceback(L, thread, lua_tostring(thread, -1), 0); // stack: traceback
+			OsiError("Scheduled task " << task.Id << " (" << task.Name << ") failed: " << lua_tostring(L, -1));
+			lua_pop(L, 1); // stack: -
+			if (task.Status == TaskStatus::Running) {
+				task.Status = TaskStatus::Failed;
+			}
+		} else if (task.Status == TaskStatus::Running) {
+			task.Status = TaskStatus::Finished;
+		}
+
+		lua_settop(thread, 0);
+	}
+
+	void TaskScheduler::AddPendingTasks()
+	{
+		for (auto & task : pendingTasks_) {
+			// New tasks are resumed before tasks that already ran in this tick
+			task.LastResumedTick = stats_.Ticks > 0 ? stats_.Ticks - 1 : 0;
+			tasks_.push_back(std::move(task));
+		}
+
+		pendingTasks_.clear();
+	}
+
+	void TaskScheduler::RemoveFinishedTasks(lua_State * L)
+	{
+		auto it = std::stable_partition(tasks_.begin(), tasks_.end(), [](Task const & task) {
+			return task.Status == TaskStatus::Running;
+		});
+
+		for (auto finished = it; finished != tasks_.end(); finished++) {
+			luaL_unref(L, LUA_REGISTRYINDEX, finished->ThreadRef);
+			finished->ThreadRef = LUA_NOREF;
+			finishedTasks_.push_back(std::move(*finished));
+			if (finishedTasks_.size() > MaxFinishedTasks) {
+				finishedTasks_.pop_front();
+			}
+		}
+
+		tasks_.erase(it, tasks_.end());
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <GameDefinitions/BaseTypes.h>
+#include <Lua/LuaHelpers.h>
+
+#include <chrono>
+#include <deque>
+#include <vector>
+
+namespace dse::lua
+{
+	// Cooperative scheduler for long-running Lua work (see Ext.Schedule).
+	// Each task is a coroutine that is resumed once per tick until the per-tick time budget
+	// is used up; higher priority tasks are resumed first, tasks with the same priority
+	// are resumed in round-robin order.
+	class TaskScheduler
+	{
+	public:
+		using Clock = std::chrono::high_resolution_clock;
+		// Number of completed tasks whose statistics are kept
+		static constexpr std::size_t MaxFinishedTasks = 32;
+
+		enum class TaskStatus
+		{
+			Running,
+			Finished,
+			Failed,
+			Cancelled
+		};
+
+		struct Task
+		{
+			int32_t Id;
+			int32_t Priority;
+			STDString Name;
+			TaskStatus Status{ TaskStatus::Running };
+			// Registry reference to the coroutine
+			int ThreadRef{ LUA_NOREF };
+			uint64_t LastResumedTick{ 0 };
+			uint64_t Resumes{ 0 };
+			Clock::duration TotalTime{ 0 };
+			Clock::duration MaxSliceTime{ 0 };
+		};
+
+		struct Stats
+		{
+			uint64_t Ticks{ 0 };
+			Clock::duration TotalTime{ 0 };
+			Clock::duration MaxTickTime{ 0 };
+		};
+
+		static char const * GetStatusName(TaskStatus status);
+
+		// Creates a task from the function at stack index `fn`
+		int32_t Schedule(lua_State * L, int fn, int32_t priority, STDString const & name);
+		bool Cancel(int32_t taskId);
+		void Update(lua_State * L, Clock::duration budget);
+
+		inline std::vector<Task> const & GetTasks() const
+		{
+			return tasks_;
+		}
+
+		inline std::vector<Task> const & GetPendingTasks() const
+		{
+			return pendingTasks_;
+		}
+
+		inline std::deque<Task> const & GetFinishedTasks() const
+		{
+			return finishedTasks_;
+		}
+
+		inline Stats const & GetStats() const
+		{
+			return stats_;
+		}
+
+	private:
+		std::vector<Task> tasks_;
+		// Tasks scheduled while the scheduler is running; added to tasks_ between passes
+		std::vector<Task> pendingTasks_;
+		std::deque<Task> finishedTasks_;
+		int32_t nextTaskId_{ 1 };
+		Stats stats_;
+
+		void ResumeTask(lua_State * L, Task & task);
+		void AddPendingTasks();
+		void RemoveFinishedTasks(lua_State * L);
+	};
+}
@@ -0,0 +1,243 @@
+#include <stdafx.h>
+#include <Lua/LuaWorkerPool.h>
+#include <Lua/LuaSerializer.h>
+#include <OsirisProxy.h>
+
+namespace dse::lua
+{
+	int GetExtensionVersion(lua_State * L);
+	int JsonParse(lua_State * L);
+	int JsonStringify(lua_State * L);
+	int Serialize(lua_State * L);
+	int Deserialize(lua_State * L);
+
+	WorkerPool::~WorkerPool()
+	{
+		Stop();
+	}
+
+	void WorkerPool::AddScript(STDString const & name, STDString const & source)
+	{
+		assert(!IsStarted());
+		scripts_.push_back(Script{ name, source });
+	}
+
+	uint32_t WorkerPool::Submit(Job && job)
+	{
+		if (!IsStarted()) {
+			Start();
+		}
+
+		job.Id = nextJobId_++;
+		auto id = job.Id;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			pendingJobs_.push_back(std::move(job));
+		}
+
+		jobAvailable_.notify_one();
+		return id;
+	}
+
+	void WorkerPool::TakeCompletedJobs(std::vector<Job> & jobs)
+	{
+		std::lock_guard<std::mutex> lock(completedMutex_);
+		for (auto & job : completedJobs_) {
+			jobs.push_back(std::move(job));
+		}
+
+		completedJobs_.clear();
+	}
+
+	void WorkerPool::Start()
+	{
+		stopping_ = false;
+		auto numThreads = std::max(gOsirisProxy->GetConfig().LuaWorkerThreads, 1u);
+		for (uint32_t i = 0; i < numThreads; i++) {
+			threads_.push_back(std::thread(&WorkerPool::WorkerMain, this));
+		}
+	}
+
+	void WorkerPool::Stop()
+	{
+		std::deque<Job> cancelledJobs;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			// Running jobs are aborted by the interrupt hook
+			stopping_ = true;
+			cancelledJobs.swap(pendingJobs_);
+		}
+
+		jobAvailable_.notify_all();
+		for (auto & thread : threads_) {
+			thread.join();
+		}
+
+		threads_.clear();
+
+		if (!cancelledJobs.empty()) {
+			WARN("Cancelled %d pending Lua worker jobs", (int)cancelledJobs.size());
+			std::lock_guard<std::mutex> lock(completedMutex_);
+			for (auto & job : cancelledJobs) {
+				job.Succeeded = false;
+				job.Error = "Job cancelled";
+				completedJobs_.push_back(std::move(job));
+			}
+		}
+	}
+
+	void WorkerPool::InterruptHook(lua_State * L, lua_Debug * ar)
+	{
+		auto context = *reinterpret_cast<WorkerContext **>(lua_getextraspace(L));
+		if (context->Pool->stopping_) {
+			luaL_error(L, "Job aborted: Lua worker pool is stopping");
+		} else if (Clock::now() - context->JobStart > MaxJobTime) {
+			luaL_error(L, "Job aborted: time limit of %d seconds exceeded", (int)MaxJobTime.count());
+		}
+	}
+
+	void WorkerPool::WorkerMain()
+	{
+		WorkerContext context{ this, Clock::now() };
+		auto L = CreateWorkerState(context);
+
+		for (;;) {
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				jobAvailable_.wait(lock, [this] { return stopping_ || !pendingJobs_.empty(); });
+				if (stopping_) break;
+
+				job = std::move(pendingJobs_.front());
+				pendingJobs_.pop_front();
+			}
+
+			RunJob(L, context, job);
+
+			std::lock_guard<std::mutex> lock(completedMutex_);
+			completedJobs_.push_back(std::move(job));
+		}
+
+		lua_close(L);
+	}
+
+	int WorkerTraceback(lua_State * L)
+	{
+		luaL_traceback(L, L, lua_tostring(L, 1), 1);
+		return 1;
+	}
+
+	lua_State * WorkerPool::CreateWorkerState(WorkerContext & context)
+	{
+		static const luaL_Reg workerLibs[] = {
+			{"_G", luaopen_base},
+			{LUA_TABLIBNAME, luaopen_table},
+			{LUA_COLIBNAME, luaopen_coroutine},
+			{LUA_STRLIBNAME, luaopen_string},
+			{LUA_MATHLIBNAME, luaopen_math},
+			{NULL, NULL}
+		};
+
+		static const luaL_Reg extLib[] = {
+			{"GetExtensionVersion", GetExtensionVersion},
+			{"JsonParse", JsonParse},
+			{"JsonStringify", JsonStringify},
+			{"Serialize", Serialize},
+			{"Deserialize", Deserialize},
+			{0,0}
+		};
+
+		auto L = luaL_newstate();
+		// Coroutines created by jobs inherit both the extra space and the hook
+		*reinterpret_cast<WorkerContext **>(lua_getextraspace(L)) = &context;
+		lua_sethook(L, &InterruptHook, LUA_MASKCOUNT, InterruptCheckInterval);
+
+		for (auto lib = workerLibs; lib->func; lib++) {
+			luaL_requiref(L, lib->name, lib->func, 1);
+			lua_pop(L, 1);
+		}
+
+		for (auto name : { "dofile", "loadfile", "load" }) {
+			lua_pushnil(L);
+			lua_setglobal(L, name);
+		}
+
+		luaL_newlib(L, extLib); // stack: lib
+		lua_setglobal(L, "Ext"); // stack: -
+
+		// Scripts can't change after the workers were started, so they're safe to read without locking
+		for (auto const & script : scripts_) {
+			context.JobStart = Clock::now();
+			lua_pushcfunction(L, &WorkerTraceback); // stack: traceback
+			if (luaL_loadbufferx(L, script.Source.c_str(), script.Source.size(), script.Name.c_str(), "t") != LUA_OK
+				|| lua_pcall(L, 0, 0, -2) != LUA_OK) {
+				ERR("Failed to load worker script '%s': %s", script.Name.c_str(), lua_tostring(L, -1));
+			}
+
+			lua_settop(L, 0); // stack: -
+		}
+
+		return L;
+	}
+
+	int RunJobInWorker(lua_State * L)
+	{
+		auto job = reinterpret_cast<WorkerPool::Job *>(lua_touserdata(L, 1));
+		lua_settop(L, 0);
+
+		lua_getglobal(L, job->Function.c_str()); // stack: fn
+		if (lua_type(L, 1) != LUA_TFUNCTION) {
+			return luaL_error(L, "Worker function '%s' does not exist", job->Function.c_str());
+		}
+
+		DeserializeValue(L, job->Arguments.data(), job->Arguments.size()); // stack: fn, args
+		lua_getfield(L, 2, "n"); // stack: fn, args, n
+		auto numArgs = (int)lua_tointeger(L, -1);
+		lua_pop(L, 1); // stack: fn, args
+		luaL_checkstack(L, numArgs, "Too many job arguments");
+		for (int i = 1; i <= numArgs; i++) {
+			lua_rawgeti(L, 2, i); // stack: fn, args, arg1 ... argn
+		}
+
+		lua_remove(L, 2); // stack: fn, arg1 ... argn
+		lua_call(L, numArgs, LUA_MULTRET); // stack: ret1 ... retn
+
+		auto numResults = lua_gettop(L);
+		lua_createtable(L, numResults, 1); // stack: ret1 ... retn, results
+		lua_insert(L, 1); // stack: results, ret1 ... retn
+		for (int i = numResults; i >= 1; i--) {
+			lua_rawseti(L, 1, i); // stack: results, ret1 ... ret(i-1)
+		}
+
+		push(L, numResults);
+		lua_setfield(L, 1, "n"); // stack: results
+
+		try {
+			SerializeValue(L, 1, job->Results);
+		} catch (std::runtime_error & e) {
+			return luaL_error(L, "Unable to serialize job results: %s", e.what());
+		}
+
+		return 0;
+	}
+
+	void WorkerPool::RunJob(lua_State * L, WorkerContext & context, Job & job)
+	{
+		context.JobStart = Clock::now();
+		lua_pushcfunction(L, &WorkerTraceback); // stack: traceback
+		lua_pushcfunction(L, &RunJobInWorker); // stack: traceback, fn
+		lua_pushlightuserdata(L, &job); // stack: traceback, fn, job
+		if (lua_pcall(L, 1, 0, 1) == LUA_OK) {
+			job.Succeeded = true;
+		} else {
+			job.Succeeded = false;
+			job.Results.clear();
+			auto error = lua_tostring(L, -1);
+			job.Error = error ? error : "Unknown error";
+		}
+
+		lua_settop(L, 0); // stack: -
+		// Keep memory usage of idle workers low
+		lua_gc(L, LUA_GCSTEP, 0);
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <GameDefinitions/BaseTypes.h>
+#include <Lua/LuaHelpers.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dse::lua
+{
+	// Runs jobs on worker threads, each with its own sandboxed Lua state (see Ext.SubmitJob).
+	// Worker states only have access to the scripts added with AddScript() and to a
+	// restricted Ext library without game or Osiris access; arguments and results are
+	// passed between states in the Ext.Serialize format.
+	class WorkerPool
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+		// Jobs (and worker script loads) running longer than this are aborted
+		static constexpr std::chrono::seconds MaxJobTime{ 30 };
+		// Number of VM instructions between checks for job timeouts and pool shutdown
+		static constexpr int InterruptCheckInterval = 10000;
+
+		struct Job
+		{
+			uint32_t Id;
+			// Name of the global function to call in the worker state
+			STDString Function;
+			// Serialized argument table ({n = <count>, ...})
+			std::string Arguments;
+			// Registry reference to the completion callback in the main state
+			int CallbackRef{ LUA_NOREF };
+			bool Succeeded{ false };
+			// Serialized result table ({n = <count>, ...})
+			std::string Results;
+			STDString Error;
+		};
+
+		~WorkerPool();
+
+		inline bool IsStarted() const
+		{
+			return !threads_.empty();
+		}
+
+		// Adds a script that is loaded into each worker state; only allowed before the workers are started
+		void AddScript(STDString const & name, STDString const & source);
+		// Queues a job; the worker threads are started on the first call
+		uint32_t Submit(Job && job);
+		// Moves jobs that finished since the last call to `jobs`
+		void TakeCompletedJobs(std::vector<Job> & jobs);
+		// Aborts running jobs, cancels pending jobs and stops the worker threads
+		void Stop();
+
+	private:
+		struct Script
+		{
+			STDString Name;
+			STDString Source;
+		};
+
+		// Stored in the extra space of worker Lua states
+		struct WorkerContext
+		{
+			WorkerPool * Pool;
+			Clock::time_point JobStart;
+		};
+
+		std::vector<Script> scripts_;
+		std::vector<std::thread> threads_;
+		uint32_t nextJobId_{ 1 };
+
+		std::mutex mutex_;
+		std::condition_variable jobAvailable_;
+		std::deque<Job> pendingJobs_;
+		// Checked by the instruction count hook of workers without holding mutex_
+		std::atomic<bool> stopping_{ false };
+
+		std::mutex completedMutex_;
+		std::vector<Job> completedJobs_;
+
+		void Start();
+		void WorkerMain();
+		lua_State * CreateWorkerState(WorkerContext & context);
+		void RunJob(lua_State * L, WorkerContext & context, Job & job);
+		static void InterruptHook(lua_State * L, lua_Debug * ar);
+	};
+}
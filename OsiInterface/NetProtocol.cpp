@@ -2,6 +2,8 @@
 #include <NetProtocol.h>
 #include <GameDefinitions/Symbols.h>
 #include <OsirisProxy.h>
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 
 namespace dse
@@ -24,6 +26,8 @@ namespace dse
 		if (Msg->MsgId == ScriptExtenderMessage::MessageId) {
 			auto msg = static_cast<ScriptExtenderMessage *>(Msg);
 			if (msg->IsValid()) {
+				gOsirisProxy->GetNetworkManager().GetStatistics().RecordMessage(NetStatistics::Direction::Received,
+					GetSourcePeerId(*Context), msg->GetMessage(), msg->GetSerializedSize());
 				ProcessExtenderMessage(*Context, msg->GetMessage());
 			}
 			return net::MessageStatus::Handled;
@@ -59,6 +63,35 @@ namespace dse
 		return nullptr;
 	}
 
+	int ExtenderProtocolClient::PostUpdate(void * Unknown)
+	{
+		gOsirisProxy->GetNetworkManager().FlushClientLuaMessages();
+		gOsirisProxy->GetNetworkManager().UpdateClientTransfers();
+		gOsirisProxy->GetNetworkManager().GetStatistics().Update();
+		gOsirisProxy->OnClientUpdate();
+		return 0;
+	}
+
+	int ExtenderProtocolServer::PostUpdate(void * Unknown)
+	{
+		gOsirisProxy->GetNetworkManager().FlushServerLuaMessages();
+		gOsirisProxy->GetNetworkManager().UpdateServerTransfers();
+		gOsirisProxy->GetNetworkManager().GetStatistics().Update();
+		gOsirisProxy->OnServerUpdate();
+		return 0;
+	}
+
+	int32_t ExtenderProtocolClient::GetSourcePeerId(net::MessageContext& context) const
+	{
+		return NetStatistics::ServerPeerId;
+	}
+
+	int32_t ExtenderProtocolServer::GetSourcePeerId(net::MessageContext& context) const
+	{
+		// User IDs store the peer ID in the upper 16 bits
+		return (int32_t)(context.UserId >> 16);
+	}
+
 	void ExtenderProtocolClient::SyncNetworkStrings(MsgS2CSyncNetworkFixedStrings const& msg)
 	{
 		auto fixedStrings = GetStaticSymbols().NetworkFixedStrings;
@@ -67,16 +100,9 @@ namespace dse
 			return;
 		}
 
-		std::vector<FixedString> strings;
-		auto numStrings = msg.network_string_size();
-		strings.reserve(numStrings);
-		for (auto i = 0; i < numStrings; i++) {
-			auto& str = msg.network_string(i);
-			strings.push_back(MakeFixedString(str.c_str()));
+		if (gOsirisProxy->NetworkFixedStringSync().ApplyServerStrings(msg)) {
+			gOsirisProxy->NetworkFixedStringSync().UpdateFromServer();
 		}
-
-		gOsirisProxy->NetworkFixedStringSync().SetServerNetworkFixedStrings(strings);
-		gOsirisProxy->NetworkFixedStringSync().UpdateFromServer();
 	}
 
 	void ExtenderProtocolClient::ProcessExtenderMessage(net::MessageContext& context, MessageWrapper & msg)
@@ -92,6 +118,34 @@ namespace dse
 			break;
 		}
 
+		case MessageWrapper::kPostLuaBatch:
+		{
+			auto & batchMsg = msg.post_lua_batch();
+			LuaClientPin pin(ExtensionStateClient::Get());
+			if (pin) {
+				for (auto const & postMsg : batchMsg.messages()) {
+					pin->OnNetMessageReceived(STDString(postMsg.channel_name()), STDString(postMsg.payload()));
+				}
+			}
+			break;
+		}
+
+		case MessageWrapper::kPostLuaChunk:
+		{
+			auto & networkMgr = gOsirisProxy->GetNetworkManager();
+			auto peerId = GetSourcePeerId(context);
+			auto message = networkMgr.GetClientReassembler().AddChunk(peerId, msg.post_lua_chunk());
+			if (message) {
+				networkMgr.GetStatistics().RecordLuaMessage(NetStatistics::Direction::Received, peerId,
+					message->Channel, message->Channel.size() + message->Payload.size());
+				LuaClientPin pin(ExtensionStateClient::Get());
+				if (pin) {
+					pin->OnNetMessageReceived(STDString(message->Channel), STDString(message->Payload));
+				}
+			}
+			break;
+		}
+
 		case MessageWrapper::kS2CResetLua:
 		{
 			auto & resetMsg = msg.s2c_reset_lua();
@@ -109,6 +163,12 @@ namespace dse
 			break;
 		}
 
+		case MessageWrapper::kS2CProtocolVersion:
+		{
+			gOsirisProxy->GetNetworkManager().ClientSetServerProtocolVersion(msg.s2c_protocol_version().protocol_version());
+			break;
+		}
+
 		default:
 			OsiErrorS("Unknown extension message type received!");
 		}
@@ -127,11 +187,44 @@ namespace dse
 			break;
 		}
 
+		case MessageWrapper::kPostLuaBatch:
+		{
+			auto & batchMsg = msg.post_lua_batch();
+			LuaServerPin pin(ExtensionStateServer::Get());
+			if (pin) {
+				for (auto const & postMsg : batchMsg.messages()) {
+					pin->OnNetMessageReceived(STDString(postMsg.channel_name()), STDString(postMsg.payload()));
+				}
+			}
+			break;
+		}
+
+		case MessageWrapper::kPostLuaChunk:
+		{
+			auto & networkMgr = gOsirisProxy->GetNetworkManager();
+			auto peerId = GetSourcePeerId(context);
+			auto message = networkMgr.GetServerReassembler().AddChunk(peerId, msg.post_lua_chunk());
+			if (message) {
+				networkMgr.GetStatistics().RecordLuaMessage(NetStatistics::Direction::Received, peerId,
+					message->Channel, message->Channel.size() + message->Payload.size());
+				LuaServerPin pin(ExtensionStateServer::Get());
+				if (pin) {
+					pin->OnNetMessageReceived(STDString(message->Channel), STDString(message->Payload));
+				}
+			}
+			break;
+		}
+
+		case MessageWrapper::kC2SSubscribeChannels:
+		{
+			gOsirisProxy->GetNetworkManager().ServerUpdateSubscriptions(GetSourcePeerId(context), msg.c2s_subscribe_channels());
+			break;
+		}
+
 		case MessageWrapper::kC2SRequestStrings:
 		{
-			// FIXME - send to peer only!
 			if (gOsirisProxy->GetConfig().SyncNetworkStrings) {
-				gOsirisProxy->NetworkFixedStringSync().SendToPeer((int32_t)context.UserId);
+				gOsirisProxy->NetworkFixedStringSync().SendToPeer(GetSourcePeerId(context), msg.c2s_request_strings());
 			}
 			break;
 		}
@@ -150,17 +243,39 @@ namespace dse
 
 	ScriptExtenderMessage::~ScriptExtenderMessage() {}
 
+	// The bitstream only supports copying whole buffers in and out, so messages are encoded into
+	// a scratch buffer that is reused between messages instead of a fresh allocation for each one.
+	// Messages are serialized on multiple network threads, hence the per-thread buffer.
+	static uint8_t * GetSerializationBuffer(uint32_t size)
+	{
+		static thread_local std::vector<uint8_t> buffer;
+		if (buffer.size() < size) {
+			buffer.resize(size);
+		}
+
+		return buffer.data();
+	}
+
 	void ScriptExtenderMessage::Serialize(net::BitstreamSerializer & serializer)
 	{
 		auto& msg = GetMessage();
+		auto& stats = gOsirisProxy->GetNetworkManager().GetStatistics();
 		if (serializer.IsWriting) {
-			uint32_t size = (uint32_t)msg.ByteSizeLong();
+			auto startTime = std::chrono::high_resolution_clock::now();
+			// NetworkManager calculates the size (and caches the sizes of submessages) when the message is sent,
+			// so it doesn't need to be recalculated for each peer the message is serialized for
+			uint32_t size = (uint32_t)msg.GetCachedSize();
+			if (size == 0) {
+				size = (uint32_t)msg.ByteSizeLong();
+			}
+
 			if (size <= MaxPayloadLength) {
 				serializer.WriteBytes(&size, sizeof(size));
-				void * buf = GameAllocRaw(size);
-				msg.SerializeToArray(buf, size);
+				auto buf = GetSerializationBuffer(size);
+				msg.SerializeWithCachedSizesToArray(buf);
 				serializer.WriteBytes(buf, size);
-				GameFree(buf);
+				stats.RecordSerialize(std::chrono::duration_cast<std::chrono::microseconds>(
+					std::chrono::high_resolution_clock::now() - startTime).count());
 			} else {
 				// Zero length indicates that a packet failed to serialize
 				uint32_t dummy = 0;
@@ -171,13 +286,16 @@ namespace dse
 			uint32_t size = 0;
 			valid_ = false;
 			serializer.ReadBytes(&size, sizeof(size));
+			serializedSize_ = size;
 			if (size > MaxPayloadLength) {
 				OsiError("Tried to read packet of size " << size << ", max size is " << MaxPayloadLength);
 			} else if (size > 0) {
-				void * buf = GameAllocRaw(size);
+				auto startTime = std::chrono::high_resolution_clock::now();
+				auto buf = GetSerializationBuffer(size);
 				serializer.ReadBytes(buf, size);
 				valid_ = msg.ParseFromArray(buf, size);
-				GameFree(buf);
+				stats.RecordParse(std::chrono::duration_cast<std::chrono::microseconds>(
+					std::chrono::high_resolution_clock::now() - startTime).count());
 			}
 		}
 	}
@@ -197,6 +315,7 @@ namespace dse
 		GetMessage().Clear();
 #endif
 		valid_ = false;
+		serializedSize_ = 0;
 	}
 
 
@@ -291,36 +410,63 @@ namespace dse
 	}
 
 	void NetworkManager::ClientSend(ScriptExtenderMessage * msg)
+	{
+		FlushClientLuaMessages();
+		ClientSendImmediate(msg);
+	}
+
+	void NetworkManager::RecordSent(ScriptExtenderMessage * msg, ObjectSet<int32_t> const & peerIds, int32_t excludePeerId)
+	{
+		// Also caches the size for Serialize()
+		auto size = msg->GetMessage().ByteSizeLong();
+		for (uint32_t i = 0; i < peerIds.Set.Size; i++) {
+			if (peerIds[i] != excludePeerId) {
+				statistics_.RecordMessage(NetStatistics::Direction::Sent, peerIds[i], msg->GetMessage(), size);
+			}
+		}
+	}
+
+	void NetworkManager::ClientSendImmediate(ScriptExtenderMessage * msg)
 	{
 		auto client = GetClient();
 		if (client != nullptr) {
+			statistics_.RecordMessage(NetStatistics::Direction::Sent, NetStatistics::ServerPeerId,
+				msg->GetMessage(), msg->GetMessage().ByteSizeLong());
 			client->VMT->ClientSend(client, client->ClientPeerId, msg);
 		}
 	}
 
 	void NetworkManager::ServerSend(ScriptExtenderMessage * msg, int32_t peerId)
+	{
+		FlushServerLuaMessages();
+		ServerSendImmediate(msg, peerId);
+	}
+
+	void NetworkManager::ServerSendImmediate(ScriptExtenderMessage * msg, int32_t peerId)
 	{
 		auto server = GetServer();
 		if (server != nullptr) {
+			statistics_.RecordMessage(NetStatistics::Direction::Sent, peerId,
+				msg->GetMessage(), msg->GetMessage().ByteSizeLong());
 			server->VMT->SendToPeer(server, &peerId, msg);
 		}
 	}
 
 	void NetworkManager::ServerBroadcast(ScriptExtenderMessage * msg, int32_t excludePeerId)
 	{
+		FlushServerLuaMessages();
 		auto server = GetServer();
 		if (server != nullptr) {
-			ObjectSet<int32_t> peerIds;
-			peerIds.Set.Reallocate(server->ActivePeerIds.Set.Size);
-			for (uint32_t i = 0; i < server->ActivePeerIds.Set.Size; i++) {
-				peerIds.Set.Add(server->ActivePeerIds[i]);
-			}
-			server->VMT->SendToMultiplePeers(server, &peerIds, msg, excludePeerId);
+			std::lock_guard<std::mutex> lock(subscriptionMutex_);
+			UpdateActivePeers(server);
+			RecordSent(msg, activePeers_, excludePeerId);
+			server->VMT->SendToMultiplePeers(server, &activePeers_, msg, excludePeerId);
 		}
 	}
 
 	void NetworkManager::ServerBroadcastToConnectedPeers(ScriptExtenderMessage* msg, int32_t excludePeerId)
 	{
+		FlushServerLuaMessages();
 		auto server = GetServer();
 		if (server != nullptr) {
 			ObjectSet<int32_t> peerIds;
@@ -328,11 +474,670 @@ namespace dse
 			for (uint32_t i = 0; i < server->ConnectedPeerIds.Set.Size; i++) {
 				peerIds.Set.Add(server->ConnectedPeerIds[i]);
 			}
+			RecordSent(msg, peerIds, excludePeerId);
 			server->VMT->SendToMultiplePeers(server, &peerIds, msg, excludePeerId);
 		}
 	}
 
 
+	bool NetworkManager::BatchingEnabled() const
+	{
+		return gOsirisProxy->GetConfig().BatchNetMessages;
+	}
+
+	uint32_t NetworkManager::GetServerProtocolVersion()
+	{
+		std::lock_guard<std::mutex> lock(batchMutex_);
+		return serverProtocolVersion_;
+	}
+
+	uint32_t NetworkManager::GetPeerProtocolVersion(int32_t peerId)
+	{
+		auto server = GetServer();
+		if (server == nullptr) return 0;
+
+		std::lock_guard<std::mutex> lock(subscriptionMutex_);
+		// Drops the versions of peers that left, in case the peer ID is reused by an older client
+		UpdateActivePeers(server);
+		auto it = peerProtocolVersions_.find(peerId);
+		return it != peerProtocolVersions_.end() ? it->second : 0;
+	}
+
+	bool NetworkManager::ClientBatchingEnabled()
+	{
+		return BatchingEnabled() && GetServerProtocolVersion() >= LuaProtocolVersion;
+	}
+
+	bool NetworkManager::PeerBatchingEnabled(int32_t peerId)
+	{
+		return BatchingEnabled() && GetPeerProtocolVersion(peerId) >= LuaProtocolVersion;
+	}
+
+	std::size_t NetworkManager::GetLuaMessageSize(std::string_view channel, std::string_view payload)
+	{
+		// Payload + protobuf tags and length varints
+		return channel.size() + payload.size() + 16;
+	}
+
+	bool NetworkManager::CanSendLuaMessage(std::string_view channel, std::string_view payload, uint32_t peerProtocolVersion)
+	{
+		if (payload.size() > LuaMessageReassembler::MaxMessageSize) {
+			OsiError("Lua message on channel '" << channel << "' is too large (" << payload.size()
+				<< " bytes); max size is " << LuaMessageReassembler::MaxMessageSize);
+			return false;
+		}
+
+		if (GetLuaMessageSize(channel, payload) > ScriptExtenderMessage::MaxPayloadLength
+			&& peerProtocolVersion < LuaProtocolVersion) {
+			OsiError("Lua message on channel '" << channel << "' is too large (" << payload.size()
+				<< " bytes) for a peer that doesn't support chunked messages");
+			return false;
+		}
+
+		return true;
+	}
+
+	bool NetworkManager::AddToBatch(LuaMessageBatch & batch, std::string_view channel, std::string_view payload)
+	{
+		auto entrySize = GetLuaMessageSize(channel, payload);
+		if (!batch.Messages.empty() && batch.Size + entrySize > ScriptExtenderMessage::MaxPayloadLength) {
+			return false;
+		}
+
+		batch.Messages.push_back(std::make_pair(std::string(channel), std::string(payload)));
+		batch.Size += entrySize;
+		return true;
+	}
+
+	void NetworkManager::FillLuaMessage(ScriptExtenderMessage * msg, LuaMessageBatch const & batch)
+	{
+		// Single messages are sent in the unbatched format
+		if (batch.Messages.size() == 1) {
+			auto postMsg = msg->GetMessage().mutable_post_lua();
+			postMsg->set_channel_name(batch.Messages[0].first);
+			postMsg->set_payload(batch.Messages[0].second);
+		} else {
+			auto batchMsg = msg->GetMessage().mutable_post_lua_batch();
+			batchMsg->mutable_messages()->Reserve((int)batch.Messages.size());
+			for (auto const & entry : batch.Messages) {
+				auto postMsg = batchMsg->add_messages();
+				postMsg->set_channel_name(entry.first);
+				postMsg->set_payload(entry.second);
+			}
+		}
+	}
+
+	void NetworkManager::SendClientBatch(LuaMessageBatch & batch)
+	{
+		if (batch.Messages.empty()) return;
+
+		auto msg = GetFreeClientMessage();
+		if (msg != nullptr) {
+			FillLuaMessage(msg, batch);
+			ClientSendImmediate(msg);
+		} else {
+			OsiErrorS("Could not get free message!");
+		}
+
+		batch.Messages.clear();
+		batch.Size = 0;
+	}
+
+	void NetworkManager::SendServerBatch(int32_t peerId, LuaMessageBatch & batch)
+	{
+		if (batch.Messages.empty()) return;
+
+		auto msg = GetFreeServerMessage();
+		if (msg != nullptr) {
+			FillLuaMessage(msg, batch);
+			ServerSendImmediate(msg, peerId);
+		} else {
+			OsiErrorS("Could not get free message!");
+		}
+
+		batch.Messages.clear();
+		batch.Size = 0;
+	}
+
+	void NetworkManager::ClientPostLuaMessage(std::string_view channel, std::string_view payload)
+	{
+		if (!CanSendLuaMessage(channel, payload, GetServerProtocolVersion())) return;
+
+		statistics_.RecordLuaMessage(NetStatistics::Direction::Sent, NetStatistics::ServerPeerId,
+			channel, channel.size() + payload.size());
+
+		if (GetLuaMessageSize(channel, payload) > ScriptExtenderMessage::MaxPayloadLength) {
+			std::lock_guard<std::mutex> lock(batchMutex_);
+			clientTransfers_.push_back(MakeTransfer(channel, std::make_shared<std::string const>(payload)));
+			return;
+		}
+
+		if (!ClientBatchingEnabled()) {
+			auto msg = GetFreeClientMessage();
+			if (msg != nullptr) {
+				auto postMsg = msg->GetMessage().mutable_post_lua();
+				postMsg->set_channel_name(channel.data(), channel.size());
+				postMsg->set_payload(payload.data(), payload.size());
+				ClientSend(msg);
+			} else {
+				OsiErrorS("Could not get free message!");
+			}
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(batchMutex_);
+		if (!AddToBatch(clientBatch_, channel, payload)) {
+			SendClientBatch(clientBatch_);
+			AddToBatch(clientBatch_, channel, payload);
+		}
+	}
+
+	void NetworkManager::QueueServerLuaMessage(int32_t peerId, std::string_view channel, std::string_view payload)
+	{
+		auto & batch = serverBatches_[peerId];
+		if (!AddToBatch(batch, channel, payload)) {
+			SendServerBatch(peerId, batch);
+			AddToBatch(batch, channel, payload);
+		}
+	}
+
+	void NetworkManager::ServerPostLuaMessage(int32_t peerId, std::string_view channel, std::string_view payload)
+	{
+		if (!CanSendLuaMessage(channel, payload, GetPeerProtocolVersion(peerId))) return;
+
+		statistics_.RecordLuaMessage(NetStatistics::Direction::Sent, peerId, channel, channel.size() + payload.size());
+
+		if (GetLuaMessageSize(channel, payload) > ScriptExtenderMessage::MaxPayloadLength) {
+			std::lock_guard<std::mutex> lock(batchMutex_);
+			serverTransfers_[peerId].push_back(MakeTransfer(channel, std::make_shared<std::string const>(payload)));
+			return;
+		}
+
+		if (!PeerBatchingEnabled(peerId)) {
+			auto msg = GetFreeServerMessage();
+			if (msg != nullptr) {
+				auto postMsg = msg->GetMessage().mutable_post_lua();
+				postMsg->set_channel_name(channel.data(), channel.size());
+				postMsg->set_payload(payload.data(), payload.size());
+				ServerSend(msg, peerId);
+			} else {
+				OsiErrorS("Could not get free message!");
+			}
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(batchMutex_);
+		QueueServerLuaMessage(peerId, channel, payload);
+	}
+
+	void NetworkManager::ServerBroadcastLuaMessage(std::string_view channel, std::string_view payload, int32_t excludePeerId)
+	{
+		auto server = GetServer();
+		if (server == nullptr) return;
+
+		std::vector<int32_t> recipients;
+		{
+			std::lock_guard<std::mutex> lock(subscriptionMutex_);
+			for (auto peerId : GetChannelRecipients(server, channel)) {
+				if (peerId != excludePeerId) {
+					recipients.push_back(peerId);
+				}
+			}
+		}
+
+		// Checks the size limit once instead of for each peer
+		if (!CanSendLuaMessage(channel, payload, LuaProtocolVersion)) return;
+
+		// Peers that can't receive the message are skipped (with an error)
+		recipients.erase(std::remove_if(recipients.begin(), recipients.end(), [this, channel, payload](int32_t peerId) {
+			return !CanSendLuaMessage(channel, payload, GetPeerProtocolVersion(peerId));
+		}), recipients.end());
+
+		for (auto peerId : recipients) {
+			statistics_.RecordLuaMessage(NetStatistics::Direction::Sent, peerId, channel, channel.size() + payload.size());
+		}
+
+		if (recipients.empty()) return;
+
+		if (GetLuaMessageSize(channel, payload) > ScriptExtenderMessage::MaxPayloadLength) {
+			auto sharedPayload = std::make_shared<std::string const>(payload);
+			std::lock_guard<std::mutex> lock(batchMutex_);
+			for (auto peerId : recipients) {
+				serverTransfers_[peerId].push_back(MakeTransfer(channel, sharedPayload));
+			}
+			return;
+		}
+
+		// Peers that can't decode batches get a single message that is sent to all of them
+		std::vector<int32_t> batchedRecipients, unbatchedRecipients;
+		for (auto peerId : recipients) {
+			if (PeerBatchingEnabled(peerId)) {
+				batchedRecipients.push_back(peerId);
+			} else {
+				unbatchedRecipients.push_back(peerId);
+			}
+		}
+
+		if (!unbatchedRecipients.empty()) {
+			auto msg = GetFreeServerMessage();
+			if (msg != nullptr) {
+				auto postMsg = msg->GetMessage().mutable_post_lua();
+				postMsg->set_channel_name(channel.data(), channel.size());
+				postMsg->set_payload(payload.data(), payload.size());
+
+				FlushServerLuaMessages();
+				std::lock_guard<std::mutex> lock(subscriptionMutex_);
+				recipientSet_.Set.Clear();
+				for (auto peerId : unbatchedRecipients) {
+					recipientSet_.Set.Add(peerId);
+				}
+
+				RecordSent(msg, recipientSet_, -1);
+				server->VMT->SendToMultiplePeers(server, &recipientSet_, msg, -1);
+			} else {
+				OsiErrorS("Could not get free message!");
+			}
+		}
+
+		// Broadcasts are queued for each peer separately, so that the order of
+		// broadcast and peer-specific messages is preserved on each client
+		std::lock_guard<std::mutex> lock(batchMutex_);
+		for (auto peerId : batchedRecipients) {
+			QueueServerLuaMessage(peerId, channel, payload);
+		}
+	}
+
+	void NetworkManager::ClientSubscribe(std::string_view channel)
+	{
+		std::lock_guard<std::mutex> lock(batchMutex_);
+		auto inserted = clientSubscriptions_.insert(std::string(channel));
+		if (inserted.second) {
+			pendingSubscriptions_.push_back(std::string(channel));
+		}
+	}
+
+	void NetworkManager::ClientResetSubscriptions()
+	{
+		std::lock_guard<std::mutex> lock(batchMutex_);
+		clientSubscriptions_.clear();
+		pendingSubscriptions_.clear();
+		pendingSubscriptionReset_ = true;
+	}
+
+	void NetworkManager::ClientResubscribe()
+	{
+		std::lock_guard<std::mutex> lock(batchMutex_);
+		pendingSubscriptions_.assign(clientSubscriptions_.begin(), clientSubscriptions_.end());
+		pendingSubscriptionReset_ = true;
+	}
+
+	void NetworkManager::SendClientSubscriptions()
+	{
+		if (!pendingSubscriptionReset_ && pendingSubscriptions_.empty()) return;
+		// Keep the subscriptions until we're connected
+		if (GetClient() == nullptr) return;
+
+		auto msg = GetFreeClientMessage();
+		if (msg != nullptr) {
+			auto subscribeMsg = msg->GetMessage().mutable_c2s_subscribe_channels();
+			subscribeMsg->set_reset(pendingSubscriptionReset_);
+			subscribeMsg->set_protocol_version(LuaProtocolVersion);
+			for (auto const & channel : pendingSubscriptions_) {
+				subscribeMsg->add_channels(channel);
+			}
+
+			ClientSendImmediate(msg);
+			pendingSubscriptions_.clear();
+			pendingSubscriptionReset_ = false;
+		} else {
+			OsiErrorS("Could not get free message!");
+		}
+	}
+
+	void NetworkManager::ServerUpdateSubscriptions(int32_t peerId, MsgC2SSubscribeNetChannels const & msg)
+	{
+		{
+			std::lock_guard<std::mutex> lock(subscriptionMutex_);
+			auto & subscriptions = peerSubscriptions_[peerId];
+			if (msg.reset()) {
+				subscriptions.clear();
+			}
+
+			for (auto const & channel : msg.channels()) {
+				subscriptions.insert(channel);
+			}
+
+			peerProtocolVersions_[peerId] = msg.protocol_version();
+			channelRecipients_.clear();
+		}
+
+		// Clients send a reset when connecting; older clients don't announce a version and wouldn't understand the reply
+		if (msg.reset() && msg.protocol_version() > 0) {
+			auto reply = GetFreeServerMessage();
+			if (reply != nullptr) {
+				reply->GetMessage().mutable_s2c_protocol_version()->set_protocol_version(LuaProtocolVersion);
+				ServerSend(reply, peerId);
+			} else {
+				OsiErrorS("Could not get free message!");
+			}
+		}
+	}
+
+	void NetworkManager::ClientSetServerProtocolVersion(uint32_t version)
+	{
+		std::lock_guard<std::mutex> lock(batchMutex_);
+		serverProtocolVersion_ = version;
+	}
+
+	void NetworkManager::ClientDisconnected()
+	{
+		std::lock_guard<std::mutex> lock(batchMutex_);
+		serverProtocolVersion_ = 0;
+		clientBatch_.Messages.clear();
+		clientBatch_.Size = 0;
+		clientTransfers_.clear();
+	}
+
+	void NetworkManager::UpdateActivePeers(net::GameServer * server)
+	{
+		auto const & peers = server->ActivePeerIds.Set;
+		bool changed = peers.Size != activePeers_.Set.Size;
+		for (uint32_t i = 0; i < peers.Size && !changed; i++) {
+			changed = peers[i] != activePeers_[i];
+		}
+
+		if (!changed) return;
+
+		activePeers_.Set.Clear();
+		for (uint32_t i = 0; i < peers.Size; i++) {
+			activePeers_.Set.Add(peers[i]);
+		}
+
+		auto removeInactive = [&peers](auto & peerMap) {
+			for (auto it = peerMap.begin(); it != peerMap.end(); ) {
+				bool active = false;
+				for (uint32_t i = 0; i < peers.Size; i++) {
+					if (peers[i] == it->first) {
+						active = true;
+						break;
+					}
+				}
+
+				if (active) {
+					it++;
+				} else {
+					it = peerMap.erase(it);
+				}
+			}
+		};
+
+		// Forget the subscriptions and protocol versions of peers that left; if the peer ID is reused,
+		// the new client will receive all broadcasts (without batching) until it subscribes
+		removeInactive(peerSubscriptions_);
+		removeInactive(peerProtocolVersions_);
+
+		channelRecipients_.clear();
+	}
+
+	std::vector<int32_t> const & NetworkManager::GetChannelRecipients(net::GameServer * server, std::string_view channel)
+	{
+		UpdateActivePeers(server);
+
+		std::string channelName(channel);
+		auto it = channelRecipients_.find(channelName);
+		if (it != channelRecipients_.end()) {
+			return it->second;
+		}
+
+		auto & recipients = channelRecipients_[channelName];
+		for (uint32_t i = 0; i < activePeers_.Set.Size; i++) {
+			auto peerId = activePeers_[i];
+			auto subscriptions = peerSubscriptions_.find(peerId);
+			if (subscriptions == peerSubscriptions_.end()
+				|| subscriptions->second.find(channelName) != subscriptions->second.end()) {
+				recipients.push_back(peerId);
+			}
+		}
+
+		return recipients;
+	}
+
+	void NetworkManager::FlushClientLuaMessages()
+	{
+		std::lock_guard<std::mutex> lock(batchMutex_);
+		SendClientSubscriptions();
+		SendClientBatch(clientBatch_);
+	}
+
+	void NetworkManager::FlushServerLuaMessages()
+	{
+		std::lock_guard<std::mutex> lock(batchMutex_);
+		for (auto & batch : serverBatches_) {
+			SendServerBatch(batch.first, batch.second);
+		}
+
+		serverBatches_.clear();
+	}
+
+
+	NetworkManager::OutgoingTransfer NetworkManager::MakeTransfer(std::string_view channel, std::shared_ptr<std::string const> payload)
+	{
+		OutgoingTransfer transfer;
+		transfer.Id = nextTransferId_++;
+		transfer.Channel = channel;
+		transfer.NumChunks = (uint32_t)((payload->size() + ChunkSize - 1) / ChunkSize);
+		transfer.Payload = std::move(payload);
+		return transfer;
+	}
+
+	bool NetworkManager::FillChunk(ScriptExtenderMessage * msg, OutgoingTransfer & transfer)
+	{
+		auto chunk = msg->GetMessage().mutable_post_lua_chunk();
+		chunk->set_transfer_id(transfer.Id);
+		chunk->set_chunk_index(transfer.NextChunk);
+		chunk->set_num_chunks(transfer.NumChunks);
+		if (transfer.NextChunk == 0) {
+			chunk->set_channel_name(transfer.Channel);
+			chunk->set_total_size(transfer.Payload->size());
+		}
+
+		auto offset = transfer.NextChunk * ChunkSize;
+		auto size = std::min(ChunkSize, transfer.Payload->size() - offset);
+		chunk->set_data(transfer.Payload->data() + offset, size);
+		return ++transfer.NextChunk == transfer.NumChunks;
+	}
+
+	void NetworkManager::UpdateClientTransfers()
+	{
+		std::lock_guard<std::mutex> lock(batchMutex_);
+		// Transfers take turns sending a chunk, so a large transfer doesn't hold up the ones queued after it
+		for (unsigned i = 0; i < ChunksPerUpdate && !clientTransfers_.empty(); i++) {
+			auto msg = GetFreeClientMessage();
+			if (msg == nullptr) {
+				OsiErrorS("Could not get free message!");
+				return;
+			}
+
+			auto transfer = std::move(clientTransfers_.front());
+			clientTransfers_.pop_front();
+			if (!FillChunk(msg, transfer)) {
+				clientTransfers_.push_back(std::move(transfer));
+			}
+
+			ClientSendImmediate(msg);
+		}
+	}
+
+	void NetworkManager::UpdateServerTransfers()
+	{
+		std::lock_guard<std::mutex> lock(batchMutex_);
+		auto server = GetServer();
+		if (server == nullptr) {
+			serverTransfers_.clear();
+			serverReassembler_.Reset();
+			return;
+		}
+
+		serverReassembler_.RemoveInactivePeers(server->ActivePeerIds);
+
+		for (auto it = serverTransfers_.begin(); it != serverTransfers_.end(); ) {
+			auto peerId = it->first;
+			auto & transfers = it->second;
+
+			// Drop transfers to peers that disconnected
+			bool active = false;
+			for (uint32_t i = 0; i < server->ActivePeerIds.Set.Size; i++) {
+				if (server->ActivePeerIds[i] == peerId) {
+					active = true;
+					break;
+				}
+			}
+
+			if (!active) {
+				transfers.clear();
+			}
+
+			for (unsigned i = 0; i < ChunksPerUpdate && !transfers.empty(); i++) {
+				auto msg = GetFreeServerMessage();
+				if (msg == nullptr) {
+					OsiErrorS("Could not get free message!");
+					return;
+				}
+
+				auto transfer = std::move(transfers.front());
+				transfers.pop_front();
+				if (!FillChunk(msg, transfer)) {
+					transfers.push_back(std::move(transfer));
+				}
+
+				ServerSendImmediate(msg, peerId);
+			}
+
+			if (transfers.empty()) {
+				it = serverTransfers_.erase(it);
+			} else {
+				it++;
+			}
+		}
+	}
+
+
+	std::optional<LuaMessageReassembler::Message> LuaMessageReassembler::AddChunk(int32_t peerId, MsgPostLuaMessageChunk const & chunk)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto now = std::chrono::steady_clock::now();
+		for (auto it = transfers_.begin(); it != transfers_.end(); ) {
+			if (now - it->second.LastUpdate > Timeout) {
+				WARN("Discarding incomplete Lua message transfer %d from peer %d", it->first.second, it->first.first);
+				it = transfers_.erase(it);
+			} else {
+				it++;
+			}
+		}
+
+		auto key = std::make_pair(peerId, chunk.transfer_id());
+		if (chunk.chunk_index() == 0) {
+			if (chunk.num_chunks() == 0 || chunk.total_size() > MaxMessageSize) {
+				OsiError("Lua message transfer " << chunk.transfer_id() << " is too large or malformed");
+				return {};
+			}
+
+			// A restarted transfer replaces the previous one with the same ID
+			transfers_.erase(key);
+
+			std::size_t numTransfers, bufferedBytes;
+			GetPeerUsage(peerId, numTransfers, bufferedBytes);
+			if (numTransfers >= MaxTransfersPerPeer) {
+				OsiError("Too many concurrent Lua message transfers from peer " << peerId << "; discarding transfer " << chunk.transfer_id());
+				return {};
+			}
+
+			// The payload is not preallocated, as total_size comes from the peer
+			auto & transfer = transfers_[key];
+			transfer.Channel = chunk.channel_name();
+			transfer.NextChunk = 0;
+			transfer.NumChunks = chunk.num_chunks();
+			transfer.TotalSize = chunk.total_size();
+		}
+
+		auto it = transfers_.find(key);
+		if (it == transfers_.end()) {
+			OsiError("Received chunk of unknown Lua message transfer " << chunk.transfer_id());
+			return {};
+		}
+
+		auto & transfer = it->second;
+		if (chunk.chunk_index() != transfer.NextChunk) {
+			OsiError("Lua message transfer " << chunk.transfer_id() << " received out of order chunk");
+			transfers_.erase(it);
+			return {};
+		}
+
+		std::size_t numTransfers, bufferedBytes;
+		GetPeerUsage(peerId, numTransfers, bufferedBytes);
+		if (transfer.Payload.size() + chunk.data().size() > transfer.TotalSize
+			|| bufferedBytes + chunk.data().size() > MaxBufferedBytesPerPeer) {
+			OsiError("Lua message transfer " << chunk.transfer_id() << " from peer " << peerId << " exceeds its size limit");
+			transfers_.erase(it);
+			return {};
+		}
+
+		transfer.Payload += chunk.data();
+		transfer.LastUpdate = now;
+		if (++transfer.NextChunk < transfer.NumChunks) {
+			return {};
+		}
+
+		if (transfer.Payload.size() != transfer.TotalSize) {
+			OsiError("Lua message transfer " << chunk.transfer_id() << " size mismatch: expected "
+				<< transfer.TotalSize << " bytes, received " << transfer.Payload.size());
+			transfers_.erase(it);
+			return {};
+		}
+
+		Message message{ std::move(transfer.Channel), std::move(transfer.Payload) };
+		transfers_.erase(it);
+		return message;
+	}
+
+	void LuaMessageReassembler::GetPeerUsage(int32_t peerId, std::size_t & numTransfers, std::size_t & bufferedBytes) const
+	{
+		numTransfers = 0;
+		bufferedBytes = 0;
+		auto it = transfers_.lower_bound(std::make_pair(peerId, 0u));
+		for (; it != transfers_.end() && it->first.first == peerId; it++) {
+			numTransfers++;
+			bufferedBytes += it->second.Payload.size();
+		}
+	}
+
+	void LuaMessageReassembler::RemoveInactivePeers(ObjectSet<int> const & activePeers)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		for (auto it = transfers_.begin(); it != transfers_.end(); ) {
+			bool active = false;
+			for (uint32_t i = 0; i < activePeers.Set.Size; i++) {
+				if (activePeers[i] == it->first.first) {
+					active = true;
+					break;
+				}
+			}
+
+			if (active) {
+				it++;
+			} else {
+				it = transfers_.erase(it);
+			}
+		}
+	}
+
+	void LuaMessageReassembler::Reset()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		transfers_.clear();
+	}
+
+
 	void NetworkFixedStringSynchronizer::Dump()
 	{
 		auto nfs = GetStaticSymbols().NetworkFixedStrings;
@@ -352,13 +1157,127 @@ namespace dse
 		}
 	}
 
+	namespace
+	{
+		void WriteVarint(std::string& buf, uint32_t value)
+		{
+			while (value >= 0x80) {
+				buf += (char)((value & 0x7f) | 0x80);
+				value >>= 7;
+			}
+
+			buf += (char)value;
+		}
+
+		bool ReadVarint(std::string const& buf, std::size_t& pos, uint32_t& value)
+		{
+			value = 0;
+			for (unsigned shift = 0; shift < 32 && pos < buf.size(); shift += 7) {
+				auto byte = (uint8_t)buf[pos++];
+				value |= (uint32_t)(byte & 0x7f) << shift;
+				if ((byte & 0x80) == 0) {
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		// Most fixed strings share a prefix with the previous one (same mod or object type),
+		// so only the differing suffix of each string is stored
+		std::string EncodeStringChunk(FixedString const* strings, uint32_t count)
+		{
+			std::string buf;
+			std::string_view prev;
+			for (uint32_t i = 0; i < count; i++) {
+				std::string_view str(strings[i].Str != nullptr ? strings[i].Str : "");
+				std::size_t shared = 0;
+				auto maxShared = std::min(prev.size(), str.size());
+				while (shared < maxShared && prev[shared] == str[shared]) shared++;
+
+				WriteVarint(buf, (uint32_t)shared);
+				WriteVarint(buf, (uint32_t)(str.size() - shared));
+				buf.append(str.data() + shared, str.size() - shared);
+				prev = str;
+			}
+
+			return buf;
+		}
+
+		bool DecodeStringChunk(std::string const& buf, FixedString* strings, uint32_t count)
+		{
+			std::string prev;
+			std::size_t pos = 0;
+			for (uint32_t i = 0; i < count; i++) {
+				uint32_t shared, suffixLength;
+				if (!ReadVarint(buf, pos, shared)
+					|| !ReadVarint(buf, pos, suffixLength)
+					|| shared > prev.size()
+					|| suffixLength > buf.size() - pos) {
+					return false;
+				}
+
+				prev.resize(shared);
+				prev.append(buf, pos, suffixLength);
+				pos += suffixLength;
+				strings[i] = MakeFixedString(prev.c_str());
+			}
+
+			return pos == buf.size();
+		}
+	}
+
+	std::vector<FixedString> NetworkFixedStringSynchronizer::GetLocalStrings()
+	{
+		std::vector<FixedString> strings;
+		auto fixedStrs = GetStaticSymbols().NetworkFixedStrings;
+		if (fixedStrs == nullptr || *fixedStrs == nullptr) {
+			return strings;
+		}
+
+		auto& fs = (*fixedStrs)->FixedStrSet.Set;
+		if (fs.Size > 1) {
+			strings.reserve(fs.Size - 1);
+			for (uint32_t i = 1; i < fs.Size; i++) {
+				strings.push_back(fs[i]);
+			}
+		}
+
+		return strings;
+	}
+
+	uint64_t NetworkFixedStringSynchronizer::HashChunk(FixedString const* strings, uint32_t count)
+	{
+		// 64-bit FNV-1a over the null-terminated strings
+		uint64_t hash = 0xcbf29ce484222325ull;
+		for (uint32_t i = 0; i < count; i++) {
+			auto str = strings[i].Str != nullptr ? strings[i].Str : "";
+			do {
+				hash ^= (uint8_t)*str;
+				hash *= 0x100000001b3ull;
+			} while (*str++);
+		}
+
+		return hash;
+	}
+
 	void NetworkFixedStringSynchronizer::RequestFromServer()
 	{
 		DEBUG("Requesting NetworkFixedStrings from server");
+		requestedStrings_ = GetLocalStrings();
+
 		auto& networkMgr = gOsirisProxy->GetNetworkManager();
 		auto msg = networkMgr.GetFreeClientMessage();
 		if (msg != nullptr) {
-			msg->GetMessage().mutable_c2s_request_strings();
+			auto requestMsg = msg->GetMessage().mutable_c2s_request_strings();
+			auto numStrings = (uint32_t)requestedStrings_.size();
+			requestMsg->set_num_strings(numStrings);
+			requestMsg->set_chunk_size(ChunkSize);
+			for (uint32_t begin = 0; begin < numStrings; begin += ChunkSize) {
+				auto count = std::min(ChunkSize, numStrings - begin);
+				requestMsg->add_chunk_hashes(HashChunk(requestedStrings_.data() + begin, count));
+			}
+
 			networkMgr.ClientSend(msg);
 		}
 		else {
@@ -366,31 +1285,124 @@ namespace dse
 		}
 	}
 
-	void NetworkFixedStringSynchronizer::SendToPeer(int32_t peerId)
+	void NetworkFixedStringSynchronizer::SendToPeer(int32_t peerId, MsgC2SRequestNetworkFixedStrings const& request)
 	{
 		auto fixedStrs = GetStaticSymbols().NetworkFixedStrings;
 		if (fixedStrs == nullptr || *fixedStrs == nullptr) {
 			return;
 		}
 
-		auto& nfs = **fixedStrs;
+		auto strings = GetLocalStrings();
+		auto numStrings = (uint32_t)strings.size();
+		// Client hashes are only usable if they were calculated using the same chunk size
+		bool canDiff = request.chunk_size() == ChunkSize;
 
 		auto& networkMgr = gOsirisProxy->GetNetworkManager();
 		auto msg = networkMgr.GetFreeServerMessage();
 		if (msg != nullptr) {
 			auto syncMsg = msg->GetMessage().mutable_s2c_sync_strings();
-			auto numStrings = nfs.FixedStrSet.Set.Size;
-			for (uint32_t i = 1; i < numStrings; i++) {
-				syncMsg->add_network_string(nfs.FixedStrSet[i].Str);
+			if (request.chunk_size() == 0) {
+				// Clients that predate chunked sync only understand the full string list
+				for (auto const& str : strings) {
+					syncMsg->add_network_string(str.Str != nullptr ? str.Str : "");
+				}
+
+				DEBUG("Sending %d NetworkFixedStrings to legacy peer %d", numStrings, peerId);
+				networkMgr.ServerSend(msg, peerId);
+				return;
 			}
 
-			networkMgr.ServerBroadcastToConnectedPeers(msg, -1);
+			syncMsg->set_num_strings(numStrings);
+			syncMsg->set_chunk_size(ChunkSize);
+
+			uint32_t chunkIndex = 0, chunksSent = 0;
+			for (uint32_t begin = 0; begin < numStrings; begin += ChunkSize, chunkIndex++) {
+				auto count = std::min(ChunkSize, numStrings - begin);
+				auto clientCount = request.num_strings() > begin
+					? std::min(ChunkSize, request.num_strings() - begin)
+					: 0;
+
+				if (canDiff
+					&& count == clientCount
+					&& (int)chunkIndex < request.chunk_hashes_size()
+					&& request.chunk_hashes(chunkIndex) == HashChunk(strings.data() + begin, count)) {
+					continue;
+				}
+
+				auto chunk = syncMsg->add_chunks();
+				chunk->set_index(chunkIndex);
+				chunk->set_strings(EncodeStringChunk(strings.data() + begin, count));
+				chunksSent++;
+			}
+
+			DEBUG("Sending %d of %d NetworkFixedString chunks to peer %d", chunksSent, chunkIndex, peerId);
+			networkMgr.ServerSend(msg, peerId);
 		}
 		else {
 			OsiErrorS("Could not get free message!");
 		}
 	}
 
+	bool NetworkFixedStringSynchronizer::ApplyServerStrings(MsgS2CSyncNetworkFixedStrings const& msg)
+	{
+		std::vector<FixedString> strings;
+
+		if (msg.network_string_size() > 0) {
+			auto numStrings = msg.network_string_size();
+			strings.reserve(numStrings);
+			for (auto i = 0; i < numStrings; i++) {
+				auto& str = msg.network_string(i);
+				strings.push_back(MakeFixedString(str.c_str()));
+			}
+
+			updatedStrings_ = strings;
+			return true;
+		}
+
+		auto numStrings = msg.num_strings();
+		auto chunkSize = msg.chunk_size();
+		if (chunkSize == 0) {
+			ERR("NetworkFixedStrings sync failed - invalid chunk size");
+			return false;
+		}
+
+		strings.resize(numStrings);
+		std::vector<bool> received((numStrings + chunkSize - 1) / chunkSize, false);
+		for (auto const& chunk : msg.chunks()) {
+			auto begin = (uint64_t)chunk.index() * chunkSize;
+			if (begin >= numStrings) {
+				ERR("NetworkFixedStrings sync failed - chunk %d out of range", chunk.index());
+				return false;
+			}
+
+			auto count = std::min(chunkSize, numStrings - (uint32_t)begin);
+			if (!DecodeStringChunk(chunk.strings(), strings.data() + begin, count)) {
+				ERR("NetworkFixedStrings sync failed - chunk %d is malformed", chunk.index());
+				return false;
+			}
+
+			received[chunk.index()] = true;
+		}
+
+		// Chunks that weren't sent are identical to our table at the time of the request
+		for (uint32_t chunkIndex = 0; chunkIndex < received.size(); chunkIndex++) {
+			if (received[chunkIndex]) continue;
+
+			auto begin = chunkIndex * chunkSize;
+			auto count = std::min(chunkSize, numStrings - begin);
+			if (chunkSize != ChunkSize || begin + count > requestedStrings_.size()) {
+				ERR("NetworkFixedStrings sync failed - chunk %d missing", chunkIndex);
+				return false;
+			}
+
+			std::copy(requestedStrings_.begin() + begin, requestedStrings_.begin() + begin + count, strings.begin() + begin);
+		}
+
+		DEBUG("Received %d of %d NetworkFixedString chunks from server", msg.chunks_size(), (uint32_t)received.size());
+		updatedStrings_ = strings;
+		return true;
+	}
+
 	void NetworkFixedStringSynchronizer::UpdateFromServer()
 	{
 		auto fixedStrs = GetStaticSymbols().NetworkFixedStrings;
@@ -448,6 +1460,7 @@ namespace dse
 	void NetworkFixedStringSynchronizer::ClientReset()
 	{
 		updatedStrings_.clear();
+		requestedStrings_.clear();
 		notInSync_ = false;
 		syncWarningShown_ = false;
 	}
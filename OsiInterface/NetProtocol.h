@@ -2,6 +2,16 @@
 
 #include <GameDefinitions/Net.h>
 #include "ScriptExtensions.pb.h"
+#include "NetStatistics.h"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace dse
 {
@@ -33,6 +43,12 @@ namespace dse
 			return valid_;
 		}
 
+		// Size of the message payload when it was last read from the network
+		inline uint32_t GetSerializedSize() const
+		{
+			return serializedSize_;
+		}
+
 	private:
 #if defined(_DEBUG)
 		MessageWrapper* message_{ nullptr };
@@ -40,6 +56,7 @@ namespace dse
 		MessageWrapper message_;
 #endif
 		bool valid_{ false };
+		uint32_t serializedSize_{ 0 };
 	};
 
 	class ExtenderProtocol : public net::Protocol
@@ -57,12 +74,17 @@ namespace dse
 
 	protected:
 		virtual void ProcessExtenderMessage(net::MessageContext& context, MessageWrapper & msg) = 0;
+		virtual int32_t GetSourcePeerId(net::MessageContext& context) const = 0;
 	};
 
 	class ExtenderProtocolClient : public ExtenderProtocol
 	{
+	public:
+		int PostUpdate(void * Unknown) override;
+
 	protected:
 		void ProcessExtenderMessage(net::MessageContext& context, MessageWrapper & msg) override;
+		int32_t GetSourcePeerId(net::MessageContext& context) const override;
 
 	private:
 		void SyncNetworkStrings(MsgS2CSyncNetworkFixedStrings const& msg);
@@ -70,39 +92,204 @@ namespace dse
 
 	class ExtenderProtocolServer : public ExtenderProtocol
 	{
+	public:
+		int PostUpdate(void * Unknown) override;
+
 	protected:
 		void ProcessExtenderMessage(net::MessageContext& context, MessageWrapper & msg) override;
+		int32_t GetSourcePeerId(net::MessageContext& context) const override;
+	};
+
+
+	// Reassembles Lua messages that were split into multiple chunks by the sender
+	class LuaMessageReassembler
+	{
+	public:
+		static constexpr std::size_t MaxMessageSize = 64 * 1024 * 1024;
+		// Limits on incomplete transfers from a single peer, so a peer can't make us buffer unbounded amounts of data
+		static constexpr std::size_t MaxTransfersPerPeer = 4;
+		static constexpr std::size_t MaxBufferedBytesPerPeer = MaxMessageSize;
+		// Incomplete transfers are discarded if no chunk was received for this long (eg. sender disconnected)
+		static constexpr std::chrono::seconds Timeout{ 60 };
+
+		struct Message
+		{
+			std::string Channel;
+			std::string Payload;
+		};
+
+		// Returns the reassembled message when the last chunk of a transfer arrives
+		std::optional<Message> AddChunk(int32_t peerId, MsgPostLuaMessageChunk const & chunk);
+		// Discards the incomplete transfers of peers that are no longer connected
+		void RemoveInactivePeers(ObjectSet<int> const & activePeers);
+		void Reset();
+
+	private:
+		struct Transfer
+		{
+			std::string Channel;
+			std::string Payload;
+			uint32_t NextChunk{ 0 };
+			uint32_t NumChunks{ 0 };
+			std::size_t TotalSize{ 0 };
+			std::chrono::steady_clock::time_point LastUpdate;
+		};
+
+		std::mutex mutex_;
+		std::map<std::pair<int32_t, uint32_t>, Transfer> transfers_;
+
+		void GetPeerUsage(int32_t peerId, std::size_t & numTransfers, std::size_t & bufferedBytes) const;
 	};
 
 
 	class NetworkManager
 	{
 	public:
+		// Lua messages that don't fit in a single ScriptExtenderMessage are split into chunks of this size
+		static constexpr std::size_t ChunkSize = 64 * 1024;
+		// Number of chunks sent to each peer per network update
+		static constexpr unsigned ChunksPerUpdate = 4;
+		// Version of the Lua message protocol; peers are only sent batched or chunked messages
+		// if they announced (for clients) or replied with (for the server) at least this version
+		static constexpr uint32_t LuaProtocolVersion = 1;
+
 		void ExtendNetworkingClient();
 		void ExtendNetworkingServer();
 
 		ScriptExtenderMessage * GetFreeClientMessage();
 		ScriptExtenderMessage * GetFreeServerMessage();
 
+		// Sending a message flushes pending Lua messages first, so the receiver sees them in posting order
 		void ClientSend(ScriptExtenderMessage * msg);
 		void ServerSend(ScriptExtenderMessage * msg, int32_t peerId);
 		void ServerBroadcast(ScriptExtenderMessage * msg, int32_t excludePeerId);
 		void ServerBroadcastToConnectedPeers(ScriptExtenderMessage* msg, int32_t excludePeerId);
 
+		// Posts a Lua net message. If batching is enabled, messages are queued per peer
+		// and sent as a single batch message on the next network update.
+		void ClientPostLuaMessage(std::string_view channel, std::string_view payload);
+		void ServerPostLuaMessage(int32_t peerId, std::string_view channel, std::string_view payload);
+		void ServerBroadcastLuaMessage(std::string_view channel, std::string_view payload, int32_t excludePeerId);
+
+		void FlushClientLuaMessages();
+		void FlushServerLuaMessages();
+		// Sends the next chunks of large Lua messages; called once per network update
+		void UpdateClientTransfers();
+		void UpdateServerTransfers();
+
+		// Announces to the server that the client has a listener for the channel
+		void ClientSubscribe(std::string_view channel);
+		// Clears the subscriptions of the client (eg. when the client Lua state is reset)
+		void ClientResetSubscriptions();
+		// Sends all subscriptions again after connecting to a server
+		void ClientResubscribe();
+		void ServerUpdateSubscriptions(int32_t peerId, MsgC2SSubscribeNetChannels const & msg);
+		void ClientSetServerProtocolVersion(uint32_t version);
+		// Discards messages and transfers queued for the server and forgets its protocol version
+		void ClientDisconnected();
+
+		inline LuaMessageReassembler & GetClientReassembler()
+		{
+			return clientReassembler_;
+		}
+
+		inline LuaMessageReassembler & GetServerReassembler()
+		{
+			return serverReassembler_;
+		}
+
+		inline NetStatistics & GetStatistics()
+		{
+			return statistics_;
+		}
+
 	private:
+		struct LuaMessageBatch
+		{
+			std::vector<std::pair<std::string, std::string>> Messages;
+			std::size_t Size{ 0 };
+		};
+
+		struct OutgoingTransfer
+		{
+			uint32_t Id;
+			std::string Channel;
+			// Shared between the transfers of a broadcast message
+			std::shared_ptr<std::string const> Payload;
+			uint32_t NextChunk{ 0 };
+			uint32_t NumChunks{ 0 };
+		};
+
 		ExtenderProtocolClient * clientProtocol_{ nullptr };
 		ExtenderProtocolServer * serverProtocol_{ nullptr };
 
+		std::mutex batchMutex_;
+		LuaMessageBatch clientBatch_;
+		std::unordered_map<int32_t, LuaMessageBatch> serverBatches_;
+		NetStatistics statistics_;
+		std::atomic<uint32_t> nextTransferId_{ 1 };
+		std::deque<OutgoingTransfer> clientTransfers_;
+		std::unordered_map<int32_t, std::deque<OutgoingTransfer>> serverTransfers_;
+		LuaMessageReassembler clientReassembler_;
+		LuaMessageReassembler serverReassembler_;
+
+		std::set<std::string> clientSubscriptions_;
+		std::vector<std::string> pendingSubscriptions_;
+		bool pendingSubscriptionReset_{ false };
+		uint32_t serverProtocolVersion_{ 0 };
+
+		std::mutex subscriptionMutex_;
+		// Channels each peer is subscribed to; peers without an entry receive all broadcasts
+		std::unordered_map<int32_t, std::set<std::string>> peerSubscriptions_;
+		// Lua message protocol version announced by each peer; peers without an entry are version 0
+		std::unordered_map<int32_t, uint32_t> peerProtocolVersions_;
+		// Active peers at the time the subscription caches were built
+		ObjectSet<int32_t> activePeers_;
+		// Recipients of broadcasts on each channel; rebuilt when subscriptions or peers change
+		std::unordered_map<std::string, std::vector<int32_t>> channelRecipients_;
+		ObjectSet<int32_t> recipientSet_;
+
 		net::GameServer * GetServer() const;
 		net::Client * GetClient() const;
+
+		bool BatchingEnabled() const;
+		uint32_t GetServerProtocolVersion();
+		uint32_t GetPeerProtocolVersion(int32_t peerId);
+		bool ClientBatchingEnabled();
+		bool PeerBatchingEnabled(int32_t peerId);
+		// Upper bound of the encoded size of a Lua message
+		static std::size_t GetLuaMessageSize(std::string_view channel, std::string_view payload);
+		// Checks the size limits of the message; messages that don't fit in a single message can only be sent to peers that support chunking
+		bool CanSendLuaMessage(std::string_view channel, std::string_view payload, uint32_t peerProtocolVersion);
+		bool AddToBatch(LuaMessageBatch & batch, std::string_view channel, std::string_view payload);
+		void FillLuaMessage(ScriptExtenderMessage * msg, LuaMessageBatch const & batch);
+		void SendClientBatch(LuaMessageBatch & batch);
+		void SendServerBatch(int32_t peerId, LuaMessageBatch & batch);
+		void QueueServerLuaMessage(int32_t peerId, std::string_view channel, std::string_view payload);
+		OutgoingTransfer MakeTransfer(std::string_view channel, std::shared_ptr<std::string const> payload);
+		// Fills the next chunk of the transfer; returns true if it was the last chunk
+		bool FillChunk(ScriptExtenderMessage * msg, OutgoingTransfer & transfer);
+
+		void RecordSent(ScriptExtenderMessage * msg, ObjectSet<int32_t> const & peerIds, int32_t excludePeerId);
+		void SendClientSubscriptions();
+		void UpdateActivePeers(net::GameServer * server);
+		std::vector<int32_t> const & GetChannelRecipients(net::GameServer * server, std::string_view channel);
+		void ClientSendImmediate(ScriptExtenderMessage * msg);
+		void ServerSendImmediate(ScriptExtenderMessage * msg, int32_t peerId);
 	};
 
 
+	// Synchronizes the NetworkFixedString table of the client with the server.
+	// The client sends a hash of each ChunkSize-string chunk of its own table, and the server
+	// only replies with the chunks that are missing or different on the client.
 	class NetworkFixedStringSynchronizer
 	{
 	public:
-		void SendToPeer(int32_t peerId);
+		static constexpr uint32_t ChunkSize = 256;
+
+		void SendToPeer(int32_t peerId, MsgC2SRequestNetworkFixedStrings const& request);
 		void RequestFromServer();
+		bool ApplyServerStrings(MsgS2CSyncNetworkFixedStrings const& msg);
 		void UpdateFromServer();
 		void ClientReset();
 		void ClientLoaded();
@@ -115,8 +302,13 @@ namespace dse
 
 	private:
 		std::vector<FixedString> updatedStrings_;
+		// Client table at the time of the request; chunks not sent by the server are taken from here
+		std::vector<FixedString> requestedStrings_;
 		bool notInSync_{ false };
 		bool syncWarningShown_{ false };
 		FixedString conflictingString_;
+
+		static std::vector<FixedString> GetLocalStrings();
+		static uint64_t HashChunk(FixedString const* strings, uint32_t count);
 	};
 }
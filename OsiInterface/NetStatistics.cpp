@@ -0,0 +1,150 @@
+#include <stdafx.h>
+#include <NetStatistics.h>
+#include <OsirisProxy.h>
+
+#include <algorithm>
+
+namespace dse
+{
+	char const * NetStatistics::GetMessageTypeName(MessageWrapper::MsgCase type)
+	{
+		switch (type) {
+		case MessageWrapper::kPostLua: return "PostLua";
+		case MessageWrapper::kPostLuaBatch: return "PostLuaBatch";
+		case MessageWrapper::kPostLuaChunk: return "PostLuaChunk";
+		case MessageWrapper::kS2CResetLua: return "ResetLua";
+		case MessageWrapper::kS2CSyncStrings: return "SyncNetworkStrings";
+		case MessageWrapper::kC2SRequestStrings: return "RequestNetworkStrings";
+		case MessageWrapper::kC2SSubscribeChannels: return "SubscribeNetChannels";
+		case MessageWrapper::kS2CProtocolVersion: return "NetProtocolVersion";
+		default: return "Unknown";
+		}
+	}
+
+	char const * NetStatistics::GetDirectionName(Direction dir)
+	{
+		return dir == Direction::Sent ? "Sent" : "Received";
+	}
+
+	void NetStatistics::RecordMessage(Direction dir, int32_t peerId, MessageWrapper const & msg, std::size_t size)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto & counter = messageTypes_[Key{ dir, peerId, GetMessageTypeName(msg.msg_case()) }];
+		counter.Messages++;
+		counter.Bytes += size;
+
+		std::size_t bucket = 0;
+		while (bucket < NumSizeBuckets - 1 && size >= SizeBucketLimits[bucket]) bucket++;
+		sizeHistogram_[(int)dir][bucket]++;
+
+		// Sent Lua messages are recorded when they're posted, as the peer and channel are known there
+		if (dir == Direction::Received) {
+			if (msg.msg_case() == MessageWrapper::kPostLua) {
+				auto const & postMsg = msg.post_lua();
+				AddChannel(dir, peerId, postMsg.channel_name(), postMsg.channel_name().size() + postMsg.payload().size());
+			} else if (msg.msg_case() == MessageWrapper::kPostLuaBatch) {
+				for (auto const & postMsg : msg.post_lua_batch().messages()) {
+					AddChannel(dir, peerId, postMsg.channel_name(), postMsg.channel_name().size() + postMsg.payload().size());
+				}
+			}
+		}
+	}
+
+	void NetStatistics::RecordLuaMessage(Direction dir, int32_t peerId, std::string_view channel, std::size_t size)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		AddChannel(dir, peerId, channel, size);
+	}
+
+	void NetStatistics::AddChannel(Direction dir, int32_t peerId, std::string_view channel, std::size_t size)
+	{
+		auto & counter = channels_[Key{ dir, peerId, STDString(channel) }];
+		counter.Messages++;
+		counter.Bytes += size;
+	}
+
+	void NetStatistics::RecordTiming(TimingStats & stats, uint64_t microseconds)
+	{
+		stats.Count++;
+		stats.TotalMicroseconds += microseconds;
+		stats.MaxMicroseconds = std::max(stats.MaxMicroseconds, microseconds);
+	}
+
+	void NetStatistics::RecordSerialize(uint64_t microseconds)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		RecordTiming(serialize_, microseconds);
+	}
+
+	void NetStatistics::RecordParse(uint64_t microseconds)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		RecordTiming(parse_, microseconds);
+	}
+
+	NetStatistics::Snapshot NetStatistics::GetSnapshot() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		Snapshot snapshot;
+		snapshot.MessageTypes = messageTypes_;
+		snapshot.Channels = channels_;
+		memcpy(snapshot.SizeHistogram, sizeHistogram_, sizeof(sizeHistogram_));
+		snapshot.Serialize = serialize_;
+		snapshot.Parse = parse_;
+		return snapshot;
+	}
+
+	void NetStatistics::Reset()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		messageTypes_.clear();
+		channels_.clear();
+		memset(sizeHistogram_, 0, sizeof(sizeHistogram_));
+		serialize_ = TimingStats{};
+		parse_ = TimingStats{};
+	}
+
+	void NetStatistics::Update()
+	{
+		auto interval = gOsirisProxy->GetConfig().NetStatsLogInterval;
+		if (interval == 0) return;
+
+		auto now = std::chrono::steady_clock::now();
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (now - lastDump_ < std::chrono::seconds(interval)) return;
+			lastDump_ = now;
+		}
+
+		DumpToLog();
+	}
+
+	void NetStatistics::DumpToLog() const
+	{
+		auto stats = GetSnapshot();
+
+		INFO("Extender network statistics:");
+		for (auto const & type : stats.MessageTypes) {
+			INFO("    %s %s, peer %d: %lld messages, %lld bytes", GetDirectionName(type.first.Dir),
+				type.first.Name.c_str(), type.first.PeerId, type.second.Messages, type.second.Bytes);
+		}
+
+		// Only list the channels with the most traffic to keep the log readable
+		std::vector<std::pair<Key, Counter>> channels(stats.Channels.begin(), stats.Channels.end());
+		std::sort(channels.begin(), channels.end(), [](auto const & a, auto const & b) {
+			return a.second.Bytes > b.second.Bytes;
+		});
+
+		auto numChannels = std::min(channels.size(), (std::size_t)10);
+		for (std::size_t i = 0; i < numChannels; i++) {
+			auto const & channel = channels[i];
+			INFO("    %s channel '%s', peer %d: %lld messages, %lld bytes", GetDirectionName(channel.first.Dir),
+				channel.first.Name.c_str(), channel.first.PeerId, channel.second.Messages, channel.second.Bytes);
+		}
+
+		INFO("    Serialize: %lld messages, %lld us total, %lld us max",
+			stats.Serialize.Count, stats.Serialize.TotalMicroseconds, stats.Serialize.MaxMicroseconds);
+		INFO("    Parse: %lld messages, %lld us total, %lld us max",
+			stats.Parse.Count, stats.Parse.TotalMicroseconds, stats.Parse.MaxMicroseconds);
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <GameDefinitions/BaseTypes.h>
+#include "ScriptExtensions.pb.h"
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string_view>
+
+namespace dse
+{
+	// Traffic statistics of extender messages, broken down by message type and Lua channel
+	class NetStatistics
+	{
+	public:
+		// Peer ID used for messages sent to/received from the server
+		static constexpr int32_t ServerPeerId = -1;
+		static constexpr std::size_t NumSizeBuckets = 8;
+		// Upper bound (exclusive) of each payload size bucket; the last bucket is unbounded
+		static constexpr std::size_t SizeBucketLimits[NumSizeBuckets - 1] = {
+			64, 256, 1024, 4096, 16384, 65536, 262144
+		};
+
+		enum class Direction : int
+		{
+			Sent = 0,
+			Received = 1
+		};
+
+		struct Key
+		{
+			Direction Dir;
+			int32_t PeerId;
+			STDString Name;
+
+			inline bool operator < (Key const & o) const
+			{
+				if (Dir != o.Dir) return Dir < o.Dir;
+				if (PeerId != o.PeerId) return PeerId < o.PeerId;
+				return Name < o.Name;
+			}
+		};
+
+		struct Counter
+		{
+			uint64_t Messages{ 0 };
+			uint64_t Bytes{ 0 };
+		};
+
+		struct TimingStats
+		{
+			uint64_t Count{ 0 };
+			uint64_t TotalMicroseconds{ 0 };
+			uint64_t MaxMicroseconds{ 0 };
+		};
+
+		struct Snapshot
+		{
+			std::map<Key, Counter> MessageTypes;
+			std::map<Key, Counter> Channels;
+			uint64_t SizeHistogram[2][NumSizeBuckets];
+			TimingStats Serialize;
+			TimingStats Parse;
+		};
+
+		static char const * GetMessageTypeName(MessageWrapper::MsgCase type);
+		static char const * GetDirectionName(Direction dir);
+
+		// Records an extender message; for received messages, the Lua channels in it are recorded as well
+		void RecordMessage(Direction dir, int32_t peerId, MessageWrapper const & msg, std::size_t size);
+		void RecordLuaMessage(Direction dir, int32_t peerId, std::string_view channel, std::size_t size);
+		void RecordSerialize(uint64_t microseconds);
+		void RecordParse(uint64_t microseconds);
+
+		Snapshot GetSnapshot() const;
+		void Reset();
+
+		// Writes the statistics to the log if the configured log interval has elapsed
+		void Update();
+		void DumpToLog() const;
+
+	private:
+		mutable std::mutex mutex_;
+		std::map<Key, Counter> messageTypes_;
+		std::map<Key, Counter> channels_;
+		uint64_t sizeHistogram_[2][NumSizeBuckets]{};
+		TimingStats serialize_;
+		TimingStats parse_;
+		std::chrono::steady_clock::time_point lastDump_{ std::chrono::steady_clock::now() };
+
+		void AddChannel(Direction dir, int32_t peerId, std::string_view channel, std::size_t size);
+		static void RecordTiming(TimingStats & stats, uint64_t microseconds);
+	};
+}
@@ -61,6 +61,7 @@ void OsirisProxy::Initialize()
 	Wrappers.RegisterDivFunctions.AddPreHook(std::bind(&OsirisProxy::OnRegisterDIVFunctions, this, _1, _2));
 	Wrappers.InitGame.AddPreHook(std::bind(&OsirisProxy::OnInitGame, this, _1));
 	Wrappers.DeleteAllData.AddPreHook(std::bind(&OsirisProxy::OnDeleteAllData, this, _1, _2));
+	Wrappers.DeleteAllData.AddPostHook(std::bind(&OsirisProxy::OnAfterDeleteAllData, this, _1, _2, _3));
 	Wrappers.Error.AddPreHook(std::bind(&OsirisProxy::OnError, this, _1));
 	Wrappers.Assert.AddPreHook(std::bind(&OsirisProxy::OnAssert, this, _1, _2, _3));
 	Wrappers.Compile.SetWrapper(std::bind(&OsirisProxy::CompileWrapper, this, _1, _2, _3, _4));
@@ -298,6 +299,12 @@ void OsirisProxy::OnDeleteAllData(void * Osiris, bool DeleteTypes)
 #endif
 }
 
+void OsirisProxy::OnAfterDeleteAllData(void * Osiris, bool DeleteTypes, int retval)
+{
+	// Databases no longer reference strings inserted from Lua
+	osiStringPool_.Clear();
+}
+
 void OsirisProxy::OnError(char const * Message)
 {
 	ERR("Osiris Error: %s", Message);
@@ -808,6 +815,7 @@ void OsirisProxy::OnClientGameStateChanged(void * self, ClientGameState fromStat
 	case ClientGameState::InitConnection:
 		networkManager_.ExtendNetworkingClient();
 		networkFixedStrings_.RequestFromServer();
+		networkManager_.ClientResubscribe();
 		break;
 	}
 
@@ -827,11 +835,14 @@ void OsirisProxy::OnClientGameStateChanged(void * self, ClientGameState fromStat
 		// Clear stored NetworkFixedString updates from previous session
 		// Server will send a new list when it enters LoadModule state
 		networkFixedStrings_.ClientReset();
+		networkManager_.GetClientReassembler().Reset();
+		networkManager_.ClientDisconnected();
 		break;
 
 	case ClientGameState::UnloadSession:
 		INFO("OsirisProxy::OnClientGameStateChanged(): Unloading session");
 		ResetExtensionStateClient();
+		networkManager_.GetClientReassembler().Reset();
 		break;
 
 	case ClientGameState::LoadGMCampaign:
@@ -858,6 +869,15 @@ void OsirisProxy::OnClientGameStateChanged(void * self, ClientGameState fromStat
 			networkFixedStrings_.ClientLoaded();
 		}
 		break;
+
+	case ClientGameState::LoadLevel:
+		// Characters (and the stats pointers in the cache keys) are recreated for the new level
+		lua::DescriptionParamCache::InvalidateAll();
+		break;
+	}
+
+	if (ClientExtState) {
+		ClientExtState->OnIdle();
 	}
 }
 
@@ -889,6 +909,7 @@ void OsirisProxy::OnServerGameStateChanged(void * self, ServerGameState fromStat
 	case ServerGameState::UnloadSession:
 		INFO("OsirisProxy::OnServerGameStateChanged(): Unloading session");
 		ResetExtensionStateServer();
+		networkManager_.GetServerReassembler().Reset();
 		break;
 
 	case ServerGameState::LoadModule:
@@ -911,6 +932,10 @@ void OsirisProxy::OnServerGameStateChanged(void * self, ServerGameState fromStat
 		break;
 
 	}
+
+	if (ServerExtState) {
+		ServerExtState->OnIdle();
+	}
 }
 
 void OsirisProxy::AddClientThread(DWORD threadId)
@@ -950,15 +975,49 @@ void OsirisProxy::AddServerThread(DWORD threadId)
 void OsirisProxy::OnClientGameStateWorkerStart(void * self)
 {
 	AddClientThread(GetCurrentThreadId());
+
+	// Don't hold up the worker if the extension state is being reloaded
+	std::unique_lock lock(globalStateLock_, std::try_to_lock);
+	if (lock && ClientExtState) {
+		ClientExtState->OnIdle();
+	}
 }
 
 void OsirisProxy::OnServerGameStateWorkerStart(void * self)
 {
 	AddServerThread(GetCurrentThreadId());
+
+	std::unique_lock lock(globalStateLock_, std::try_to_lock);
+	if (lock && ServerExtState) {
+		ServerExtState->OnIdle();
+	}
+}
+
+void OsirisProxy::OnClientUpdate()
+{
+	if (!extensionsEnabled_) return;
+
+	std::unique_lock lock(globalStateLock_, std::try_to_lock);
+	if (lock && ClientExtState) {
+		ClientExtState->OnUpdate();
+	}
+}
+
+void OsirisProxy::OnServerUpdate()
+{
+	if (!extensionsEnabled_) return;
+
+	std::unique_lock lock(globalStateLock_, std::try_to_lock);
+	if (lock && ServerExtState) {
+		ServerExtState->OnUpdate();
+	}
 }
 
 void OsirisProxy::OnSkillPrototypeManagerInit(void * self)
 {
+	// Skill prototypes are initialized after the stats were (re)loaded
+	ResetModifierFSSetIndex();
+
 	if (!extensionsEnabled_) return;
 
 	std::lock_guard _(globalStateLock_);
@@ -87,7 +87,12 @@ struct ToolConfig
 
 	bool DumpNetworkStrings{ false };
 	bool SyncNetworkStrings{ false };
+	bool BatchNetMessages{ true };
+	bool CompareNativeGameMath{ false };
 	uint16_t DebuggerPort{ 9999 };
+	uint32_t NetStatsLogInterval{ 0 };
+	uint32_t LuaTaskBudget{ 2 };
+	uint32_t LuaWorkerThreads{ 2 };
 	uint32_t DebugFlags{ 0 };
 	std::wstring LogDirectory;
 };
@@ -159,6 +164,10 @@ public:
 
 	bool HasFeatureFlag(char const *) const;
 
+	// Called from the extender network protocol once per client/server tick
+	void OnClientUpdate();
+	void OnServerUpdate();
+
 	inline void * GetOsirisDllStart() const
 	{
 		return Wrappers.OsirisDllStart;
@@ -184,6 +193,11 @@ public:
 		return networkFixedStrings_;
 	}
 
+	inline lua::OsiStringPool & GetOsiStringPool()
+	{
+		return osiStringPool_;
+	}
+
 	void ClearPathOverrides();
 	void AddPathOverride(STDString const & path, STDString const & overriddenPath);
 
@@ -211,6 +225,7 @@ private:
 	std::shared_mutex pathOverrideMutex_;
 	std::unordered_map<STDString, STDString> pathOverrides_;
 	NetworkFixedStringSynchronizer networkFixedStrings_;
+	lua::OsiStringPool osiStringPool_;
 
 	NodeVMT * NodeVMTs[(unsigned)NodeType::Max + 1];
 	bool ResolvedNodeVMTs{ false };
@@ -218,6 +233,7 @@ private:
 	void OnRegisterDIVFunctions(void *, DivFunctions *);
 	void OnInitGame(void *);
 	void OnDeleteAllData(void *, bool);
+	void OnAfterDeleteAllData(void *, bool, int);
 
 	void OnError(char const * Message);
 	void OnAssert(bool Successful, char const * Message, bool Unknown2);
@@ -41,10 +41,12 @@ void LoadConfig(std::wstring const & configPath, dse::ToolConfig & config)
 	ConfigGetBool(root, "SendCrashReports", config.SendCrashReports);
 	ConfigGetBool(root, "DumpNetworkStrings", config.DumpNetworkStrings);
 	ConfigGetBool(root, "SyncNetworkStrings", config.SyncNetworkStrings);
+	ConfigGetBool(root, "BatchNetMessages", config.BatchNetMessages);
 	ConfigGetBool(root, "EnableDebugger", config.EnableDebugger);
 	ConfigGetBool(root, "DisableModValidation", config.DisableModValidation);
 	ConfigGetBool(root, "DeveloperMode", config.DeveloperMode);
 	ConfigGetBool(root, "EnableAchievements", config.EnableAchievements);
+	ConfigGetBool(root, "CompareNativeGameMath", config.CompareNativeGameMath);
 
 	auto debuggerPort = root["DebuggerPort"];
 	if (!debuggerPort.isNull()) {
@@ -55,6 +57,33 @@ void LoadConfig(std::wstring const & configPath, dse::ToolConfig & config)
 		}
 	}
 
+	auto netStatsInterval = root["NetStatsLogInterval"];
+	if (!netStatsInterval.isNull()) {
+		if (netStatsInterval.isUInt()) {
+			config.NetStatsLogInterval = netStatsInterval.asUInt();
+		} else {
+			Fail("Config option 'NetStatsLogInterval' should be an integer.");
+		}
+	}
+
+	auto taskBudget = root["LuaTaskBudget"];
+	if (!taskBudget.isNull()) {
+		if (taskBudget.isUInt()) {
+			config.LuaTaskBudget = taskBudget.asUInt();
+		} else {
+			Fail("Config option 'LuaTaskBudget' should be an integer.");
+		}
+	}
+
+	auto workerThreads = root["LuaWorkerThreads"];
+	if (!workerThreads.isNull()) {
+		if (workerThreads.isUInt()) {
+			config.LuaWorkerThreads = workerThreads.asUInt();
+		} else {
+			Fail("Config option 'LuaWorkerThreads' should be an integer.");
+		}
+	}
+
 	auto flags = root["DebugFlags"];
 	if (!flags.isNull()) {
 		if (flags.isUInt()) {